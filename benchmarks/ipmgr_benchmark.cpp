@@ -0,0 +1,659 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+/** \file
+ * \brief Benchmark of the zone generation.
+ *
+ * This tool synthesizes a tree of zone configuration files in a
+ * temporary directory and times each phase of the zone generation
+ * separately:
+ *
+ * \li read_zones() -- find the files and group them by domain
+ * \li retrieve_fields() -- parse the files and retrieve the zone fields
+ * \li generate -- generate the zone (header and body) and PTR files
+ * \li conf -- generate the bind9 .conf and includes files
+ * \li save -- stage and commit the bind9 .conf and includes files
+ *
+ * With `--full`, it also times a complete process_zones() run. That run
+ * verifies each zone with named-checkzone so the bind9 utilities must be
+ * installed.
+ *
+ * For each phase, it reports the time it took and the number of memory
+ * allocations that happened.
+ *
+ * Everything happens under the temporary directory (see `--root-dir`
+ * in ipmgr) so the benchmark does not need to be run as root.
+ */
+
+
+// self
+//
+#include    "ipmgr.h"
+#include    "version.h"
+
+
+// advgetopt
+//
+#include    <advgetopt/exception.h>
+
+
+// snapdev
+//
+#include    <snapdev/file_contents.h>
+#include    <snapdev/mkdir_p.h>
+#include    <snapdev/not_used.h>
+#include    <snapdev/stringize.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <chrono>
+#include    <cstdlib>
+#include    <filesystem>
+#include    <iomanip>
+#include    <iostream>
+#include    <new>
+#include    <sstream>
+#include    <vector>
+
+
+// C
+//
+#include    <stdlib.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+std::atomic<std::size_t>    g_allocations(0);
+std::atomic<std::size_t>    g_allocated_bytes(0);
+
+
+
+advgetopt::option const g_options[] =
+{
+    advgetopt::define_option(
+          advgetopt::Name("domains")
+        , advgetopt::Flags(advgetopt::command_flags<
+              advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("100")
+        , advgetopt::Help("number of domains to generate.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("full")
+        , advgetopt::Flags(advgetopt::standalone_command_flags<>())
+        , advgetopt::Help("also time a full process_zones() run; this requires named-checkzone.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("keep")
+        , advgetopt::Flags(advgetopt::standalone_command_flags<>())
+        , advgetopt::Help("keep the temporary directory with the generated files.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("layers")
+        , advgetopt::Flags(advgetopt::command_flags<
+              advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("1")
+        , advgetopt::Help("number of configuration files defining each domain; each additional layer overrides a few parameters of the previous layers.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("mail")
+        , advgetopt::Flags(advgetopt::command_flags<
+              advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("4")
+        , advgetopt::Help("one domain out of that many gets a mail section (0 for none).")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("ptr")
+        , advgetopt::Flags(advgetopt::command_flags<
+              advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("10")
+        , advgetopt::Help("one domain out of that many gets a PTR (0 for none).")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("subdomains")
+        , advgetopt::Flags(advgetopt::command_flags<
+              advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("10")
+        , advgetopt::Help("number of subdomains defined in each domain.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("tmp-dir")
+        , advgetopt::Flags(advgetopt::command_flags<
+              advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("/tmp")
+        , advgetopt::Help("directory where the temporary directory gets created.")
+    ),
+    advgetopt::end_options()
+};
+
+
+
+// until we have C++20 remove warnings this way
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+advgetopt::options_environment const g_options_environment =
+{
+    .f_project_name = "ipmgr-benchmark",
+    .f_group_name = nullptr,
+    .f_options = g_options,
+    .f_options_files_directory = nullptr,
+    .f_environment_variable_name = nullptr,
+    .f_environment_variable_intro = nullptr,
+    .f_section_variables_name = nullptr,
+    .f_configuration_files = nullptr,
+    .f_configuration_filename = nullptr,
+    .f_configuration_directories = nullptr,
+    .f_environment_flags = 0,
+    .f_help_header = "Usage: %p [-<opt>] ...\n"
+                     "Benchmark the zone generation of the IP Manager.\n"
+                     "where -<opt> is one or more of:",
+    .f_help_footer = "%c",
+    .f_version = IPMGR_VERSION_STRING,
+    .f_license = "This software is licensed under the GPL v3",
+    .f_copyright = "Copyright (c) 2025-"
+                   SNAPDEV_STRINGIZE(UTC_BUILD_YEAR)
+                   " by Made to Order Software Corporation -- All Rights Reserved",
+};
+#pragma GCC diagnostic pop
+
+
+
+} // no name namespace
+
+
+
+void * operator new(std::size_t size)
+{
+    ++g_allocations;
+    g_allocated_bytes += size;
+    void * ptr(malloc(size == 0 ? 1 : size));
+    if(ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+
+void operator delete(void * ptr) noexcept
+{
+    free(ptr);
+}
+
+
+void operator delete(void * ptr, std::size_t) noexcept
+{
+    free(ptr);
+}
+
+
+
+class ipmgr_benchmark
+{
+public:
+                            ipmgr_benchmark(int argc, char * argv[]);
+                            ~ipmgr_benchmark();
+
+    int                     run();
+
+private:
+    struct phase_t
+    {
+        std::chrono::steady_clock::time_point
+                                f_start = std::chrono::steady_clock::time_point();
+        std::size_t             f_allocations = 0;
+        std::size_t             f_allocated_bytes = 0;
+    };
+
+    int                     create_zones();
+    std::vector<std::string>
+                            ipmgr_arguments() const;
+    int                     run_phases();
+    int                     run_full();
+    void                    start_phase(phase_t & phase);
+    void                    end_phase(phase_t const & phase, char const * name);
+
+    advgetopt::getopt       f_opt;
+    std::string             f_root = std::string();
+    std::int64_t            f_domains = 100;
+    std::int64_t            f_subdomains = 10;
+    std::int64_t            f_layers = 1;
+    std::int64_t            f_mail = 4;
+    std::int64_t            f_ptr = 10;
+    bool                    f_full = false;
+    bool                    f_keep = false;
+};
+
+
+ipmgr_benchmark::ipmgr_benchmark(int argc, char * argv[])
+    : f_opt(g_options_environment, argc, argv)
+{
+    f_domains = f_opt.get_long("domains", 0, 1, 1'000'000);
+    f_subdomains = f_opt.get_long("subdomains", 0, 0, 100'000);
+    f_layers = f_opt.get_long("layers", 0, 1, 100);
+    f_mail = f_opt.get_long("mail", 0, 0, 1'000'000);
+    f_ptr = f_opt.get_long("ptr", 0, 0, 1'000'000);
+    f_full = f_opt.is_defined("full");
+    f_keep = f_opt.is_defined("keep");
+}
+
+
+ipmgr_benchmark::~ipmgr_benchmark()
+{
+    if(!f_root.empty()
+    && !f_keep)
+    {
+        std::error_code ec;
+        snapdev::NOT_USED(std::filesystem::remove_all(f_root, ec));
+    }
+}
+
+
+/** \brief Create the zone configuration files.
+ *
+ * Each domain gets one file per layer. The first layer defines the whole
+ * zone. The other layers override the TTL of the zone and the IPs of
+ * one subdomain section, which is how administrators tweak the zones
+ * installed by packages.
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr_benchmark::create_zones()
+{
+    std::string tmpl(f_opt.get_string("tmp-dir") + "/ipmgr-benchmark-XXXXXX");
+    if(mkdtemp(tmpl.data()) == nullptr)
+    {
+        std::cerr
+            << "error: could not create temporary directory \""
+            << tmpl
+            << "\".\n";
+        return 1;
+    }
+    f_root = tmpl;
+
+    for(std::int64_t layer(0); layer < f_layers; ++layer)
+    {
+        std::string const dir(f_root + "/zones/layer-" + std::to_string(layer));
+        if(snapdev::mkdir_p(dir) != 0)
+        {
+            std::cerr
+                << "error: could not create directory \""
+                << dir
+                << "\".\n";
+            return 1;
+        }
+
+        for(std::int64_t d(0); d < f_domains; ++d)
+        {
+            std::string const domain("domain" + std::to_string(d) + ".com");
+            std::stringstream zone;
+
+            zone << "domain=" << domain << '\n';
+            if(layer == 0)
+            {
+                zone
+                    << "hostmaster=hostmaster@" << domain << '\n'
+                    << "ips=10." << (d >> 16 & 255) << '.' << (d >> 8 & 255) << '.' << (d & 255) << '\n'
+                    << "nameservers=\"ns1." << domain << " ns2." << domain << "\"\n"
+                    << "ttl=1h\n";
+                if(f_ptr != 0
+                && d % f_ptr == 0)
+                {
+                    zone << "ptr=10." << (d >> 16 & 255) << '.' << (d >> 8 & 255) << '.' << (d & 255) << '\n';
+                }
+                if(f_mail != 0
+                && d % f_mail == 0)
+                {
+                    zone
+                        << "mail=mail\n"
+                        << "\n"
+                        << "[mail]\n"
+                        << "subdomains=mail\n"
+                        << "ips=10.200.0.1\n"
+                        << "key_ttl=30m\n";
+                }
+                zone
+                    << "\n"
+                    << "[nameservers]\n"
+                    << "subdomains=ns1\n"
+                    << "ips=10.100.0.1\n"
+                    << "\n"
+                    << "[nameservers2]\n"
+                    << "subdomains=ns2\n"
+                    << "ips=10.100.0.2\n"
+                    << "\n"
+                    << "[global-txt]\n"
+                    << "txt=benchmark=" << d << '\n';
+                for(std::int64_t s(0); s < f_subdomains; ++s)
+                {
+                    zone
+                        << "\n"
+                        << "[section" << s << "]\n";
+                    switch(s % 3)
+                    {
+                    case 0:
+                        zone
+                            << "subdomains=sub" << s << " www" << s << '\n'
+                            << "ips=10.1.0." << (s & 255) << " 10.2.0." << (s & 255) << " fd00::" << std::hex << s << std::dec << '\n';
+                        break;
+
+                    case 1:
+                        zone
+                            << "subdomains=alias" << s << '\n'
+                            << "cname=sub" << s - 1 << '\n';
+                        break;
+
+                    case 2:
+                        zone
+                            << "subdomains=info" << s << '\n'
+                            << "txt=info " << s << " +++ more info " << s << '\n'
+                            << "ttl=5m\n";
+                        break;
+
+                    }
+                }
+            }
+            else
+            {
+                zone
+                    << "ttl=" << layer + 1 << "h\n"
+                    << "\n"
+                    << "[section0]\n"
+                    << "ips=10.3." << layer << ".1\n";
+            }
+
+            snapdev::file_contents file(dir + '/' + domain + ".conf");
+            file.contents(zone.str());
+            if(!file.write_all())
+            {
+                std::cerr
+                    << "error: could not write zone \""
+                    << domain
+                    << "\".\n";
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+void ipmgr_benchmark::start_phase(phase_t & phase)
+{
+    phase.f_allocations = g_allocations;
+    phase.f_allocated_bytes = g_allocated_bytes;
+    phase.f_start = std::chrono::steady_clock::now();
+}
+
+
+void ipmgr_benchmark::end_phase(phase_t const & phase, char const * name)
+{
+    std::chrono::steady_clock::duration const duration(std::chrono::steady_clock::now() - phase.f_start);
+    double const ms(std::chrono::duration<double, std::milli>(duration).count());
+    std::size_t const allocations(g_allocations - phase.f_allocations);
+    std::size_t const bytes(g_allocated_bytes - phase.f_allocated_bytes);
+
+    std::cout
+        << std::left << std::setw(24) << name << std::right
+        << std::fixed << std::setprecision(3)
+        << std::setw(12) << ms << " ms"
+        << std::setw(12) << ms * 1000.0 / f_domains << " us/zone"
+        << std::setw(12) << allocations << " allocs"
+        << std::setw(12) << allocations / f_domains << " allocs/zone"
+        << std::setw(14) << bytes << " bytes"
+        << '\n';
+}
+
+
+/** \brief Generate the command line arguments of ipmgr.
+ *
+ * The ipmgr instances work under the temporary directory (`--root-dir`)
+ * and in dry-run mode which prevents them from running external commands
+ * other than named-checkzone.
+ *
+ * \return The list of arguments, including the program name.
+ */
+std::vector<std::string> ipmgr_benchmark::ipmgr_arguments() const
+{
+    std::string zone_directories("--zone-directories=");
+    for(std::int64_t layer(0); layer < f_layers; ++layer)
+    {
+        if(layer != 0)
+        {
+            zone_directories += ' ';
+        }
+        zone_directories += "/zones/layer-" + std::to_string(layer);
+    }
+
+    return std::vector<std::string>{
+        "ipmgr",
+        "--root-dir=" + f_root,
+        zone_directories,
+        "--dry-run",
+        "--quiet",
+        "--force-severity=ERROR",
+    };
+}
+
+
+int ipmgr_benchmark::run_phases()
+{
+    std::vector<std::string> args(ipmgr_arguments());
+    std::vector<char *> argv;
+    for(auto & a : args)
+    {
+        argv.push_back(const_cast<char *>(a.c_str()));
+    }
+    argv.push_back(nullptr);
+    ipmgr l(static_cast<int>(args.size()), argv.data());
+    if(!paths(f_root).create_directories())
+    {
+        return 1;
+    }
+
+    phase_t phase;
+
+    start_phase(phase);
+    int r(l.read_zones());
+    end_phase(phase, "read_zones");
+    if(r != 0)
+    {
+        return r;
+    }
+
+    start_phase(phase);
+    for(auto & z : l.get_zone_files())
+    {
+        if(!z.second->retrieve_fields())
+        {
+            std::cerr
+                << "error: could not retrieve the fields of \""
+                << z.first
+                << "\".\n";
+            return 1;
+        }
+    }
+    end_phase(phase, "retrieve_fields");
+
+    std::size_t size(0);
+    start_phase(phase);
+    for(auto & z : l.get_zone_files())
+    {
+        std::string const body(z.second->generate_zone_body());
+        if(body.empty())
+        {
+            std::cerr
+                << "error: could not generate zone \""
+                << z.first
+                << "\".\n";
+            return 1;
+        }
+        size += z.second->generate_zone_header(1).length() + body.length();
+        if(!z.second->get_ptr().empty())
+        {
+            size += z.second->generate_ptr_header(1).length()
+                  + z.second->generate_ptr_body().length();
+        }
+    }
+    end_phase(phase, "generate");
+
+    start_phase(phase);
+    r = l.generate_conf_files();
+    end_phase(phase, "conf");
+    if(r != 0)
+    {
+        return r;
+    }
+
+    start_phase(phase);
+    r = l.save_conf_files();
+    if(r == 0)
+    {
+        r = l.commit_output();
+    }
+    end_phase(phase, "save");
+    if(r != 0)
+    {
+        return r;
+    }
+
+    std::cout
+        << "info: generated "
+        << size
+        << " bytes of zones.\n";
+
+    return 0;
+}
+
+
+/** \brief Time complete runs of the zone pipeline.
+ *
+ * The first run generates all the zones. The second run finds all the
+ * zones in the cache, which is what a run of the daemon sees when only
+ * a few zones change.
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr_benchmark::run_full()
+{
+    std::vector<std::string> args(ipmgr_arguments());
+    std::vector<char *> argv;
+    for(auto & a : args)
+    {
+        argv.push_back(const_cast<char *>(a.c_str()));
+    }
+    argv.push_back(nullptr);
+    ipmgr l(static_cast<int>(args.size()), argv.data());
+
+    phase_t phase;
+
+    start_phase(phase);
+    int r(l.process_zones());
+    end_phase(phase, "process_zones");
+    if(r != 0)
+    {
+        return r;
+    }
+
+    l.reset_state();
+
+    start_phase(phase);
+    r = l.process_zones();
+    end_phase(phase, "process_zones (cached)");
+    if(r != 0)
+    {
+        return r;
+    }
+
+    return 0;
+}
+
+
+int ipmgr_benchmark::run()
+{
+    int r(create_zones());
+    if(r != 0)
+    {
+        return r;
+    }
+
+    std::cout
+        << "info: "
+        << f_domains
+        << " domains, "
+        << f_subdomains
+        << " subdomains, "
+        << f_layers
+        << " layer(s) in \""
+        << f_root
+        << "\".\n";
+
+    r = run_phases();
+    if(r != 0)
+    {
+        return r;
+    }
+
+    if(f_full)
+    {
+        r = run_full();
+        if(r != 0)
+        {
+            return r;
+        }
+    }
+
+    return 0;
+}
+
+
+
+int main(int argc, char * argv[])
+{
+    try
+    {
+        ipmgr_benchmark b(argc, argv);
+        return b.run();
+    }
+    catch(advgetopt::getopt_exit const & e)
+    {
+        return e.code();
+    }
+    catch(std::exception const & e)
+    {
+        std::cerr << "error:ipmgr-benchmark: an exception occurred: " << e.what() << std::endl;
+    }
+
+    return 1;
+}
+
+
+// vim: ts=4 sw=4 et
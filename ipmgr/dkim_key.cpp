@@ -0,0 +1,299 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the OpenDKIM key generator.
+ *
+ * The private key is saved in PEM format (PKCS#8) which OpenDKIM reads
+ * for both key types. The public key is published in the TXT record of
+ * the selector:
+ *
+ * \li RSA -- the DER encoded SubjectPublicKeyInfo, as `opendkim-genkey`
+ * does;
+ * \li Ed25519 -- the raw 32 byte public key (RFC 8463).
+ */
+
+
+// self
+//
+#include    "dkim_key.h"
+
+
+// OpenSSL
+//
+#include    <openssl/err.h>
+#include    <openssl/evp.h>
+#include    <openssl/pem.h>
+#include    <openssl/x509.h>
+
+
+// C++
+//
+#include    <memory>
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+typedef std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)>    pkey_ctx_t;
+typedef std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)>            pkey_t;
+typedef std::unique_ptr<BIO, decltype(&BIO_free)>                      bio_t;
+
+
+/** \brief Maximum length of one string in a TXT record.
+ *
+ * A TXT record is a list of strings of at most 255 characters each.
+ * Like `opendkim-genkey`, we use a slightly smaller size.
+ */
+constexpr std::size_t const g_txt_string_length = 250;
+
+
+std::string openssl_error(char const * message)
+{
+    std::string result(message);
+    unsigned long const code(ERR_get_error());
+    if(code != 0)
+    {
+        char buf[256];
+        ERR_error_string_n(code, buf, sizeof(buf));
+        result += " (";
+        result += buf;
+        result += ')';
+    }
+    ERR_clear_error();
+    return result;
+}
+
+
+std::string base64(unsigned char const * data, std::size_t size)
+{
+    std::vector<unsigned char> buf((size + 2) / 3 * 4 + 1);
+    int const len(EVP_EncodeBlock(buf.data(), data, static_cast<int>(size)));
+    return std::string(reinterpret_cast<char const *>(buf.data()), len);
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Convert a key type name to a DKIM key type.
+ *
+ * The supported names are "rsa" and "ed25519".
+ *
+ * \param[in] name  The name of the key type.
+ * \param[out] type  The corresponding key type.
+ *
+ * \return true if \p name is a valid key type name.
+ */
+bool string_to_dkim_key_type(std::string const & name, dkim_key_type_t & type)
+{
+    if(name == "rsa")
+    {
+        type = dkim_key_type_t::DKIM_KEY_TYPE_RSA;
+        return true;
+    }
+    if(name == "ed25519")
+    {
+        type = dkim_key_type_t::DKIM_KEY_TYPE_ED25519;
+        return true;
+    }
+
+    return false;
+}
+
+
+/** \brief Generate a new key pair.
+ *
+ * This function generates a new private key and its public key. The
+ * function is thread safe so keys of different domains can be
+ * generated in parallel.
+ *
+ * \param[in] type  The type of key to generate.
+ * \param[in] bits  The size of RSA keys in bits (ignored for Ed25519).
+ *
+ * \return true if the key was generated, false otherwise (see
+ * last_error()).
+ */
+bool dkim_key::generate(dkim_key_type_t type, int bits)
+{
+    f_type = type;
+    f_private_key.clear();
+    f_public_key.clear();
+    f_last_error.clear();
+
+    int const id(type == dkim_key_type_t::DKIM_KEY_TYPE_RSA
+                    ? EVP_PKEY_RSA
+                    : EVP_PKEY_ED25519);
+    pkey_ctx_t ctx(EVP_PKEY_CTX_new_id(id, nullptr), &EVP_PKEY_CTX_free);
+    if(ctx == nullptr
+    || EVP_PKEY_keygen_init(ctx.get()) <= 0)
+    {
+        f_last_error = openssl_error("could not initialize the key generator");
+        return false;
+    }
+
+    if(type == dkim_key_type_t::DKIM_KEY_TYPE_RSA
+    && EVP_PKEY_CTX_set_rsa_keygen_bits(ctx.get(), bits) <= 0)
+    {
+        f_last_error = openssl_error("invalid RSA key size");
+        return false;
+    }
+
+    EVP_PKEY * raw_key(nullptr);
+    if(EVP_PKEY_keygen(ctx.get(), &raw_key) <= 0)
+    {
+        f_last_error = openssl_error("could not generate the key");
+        return false;
+    }
+    pkey_t key(raw_key, &EVP_PKEY_free);
+
+    // private key
+    //
+    bio_t bio(BIO_new(BIO_s_mem()), &BIO_free);
+    if(bio == nullptr
+    || PEM_write_bio_PrivateKey(bio.get(), key.get(), nullptr, nullptr, 0, nullptr, nullptr) != 1)
+    {
+        f_last_error = openssl_error("could not convert the private key to PEM");
+        return false;
+    }
+    char * pem(nullptr);
+    long const pem_size(BIO_get_mem_data(bio.get(), &pem));
+    f_private_key.assign(pem, pem_size);
+
+    // public key
+    //
+    std::vector<unsigned char> pub;
+    if(type == dkim_key_type_t::DKIM_KEY_TYPE_RSA)
+    {
+        int const size(i2d_PUBKEY(key.get(), nullptr));
+        if(size <= 0)
+        {
+            f_last_error = openssl_error("could not convert the public key to DER");
+            return false;
+        }
+        pub.resize(size);
+        unsigned char * p(pub.data());
+        i2d_PUBKEY(key.get(), &p);
+    }
+    else
+    {
+        std::size_t size(0);
+        if(EVP_PKEY_get_raw_public_key(key.get(), nullptr, &size) != 1)
+        {
+            f_last_error = openssl_error("could not retrieve the public key");
+            return false;
+        }
+        pub.resize(size);
+        EVP_PKEY_get_raw_public_key(key.get(), pub.data(), &size);
+    }
+    f_public_key = base64(pub.data(), pub.size());
+
+    return true;
+}
+
+
+/** \brief Get the private key in PEM format.
+ *
+ * \return The private key or an empty string if generate() failed.
+ */
+std::string const & dkim_key::private_key() const
+{
+    return f_private_key;
+}
+
+
+/** \brief Get the public key encoded in base64.
+ *
+ * \return The public key or an empty string if generate() failed.
+ */
+std::string const & dkim_key::public_key() const
+{
+    return f_public_key;
+}
+
+
+/** \brief Generate the DNS record of the key.
+ *
+ * The output uses the same format as the `.txt` file generated by
+ * `opendkim-genkey`:
+ *
+ * \code
+ *     mail._domainkey	IN	TXT	( "v=DKIM1; h=sha256; k=rsa; "
+ *     	  "p=MIIBIjANBgkqhkiG9w0BAQEFAAOCAQ8AMIIBCgKCAQEA..."
+ *     	  "..." )  ; ----- DKIM key mail for example.com
+ * \endcode
+ *
+ * \param[in] selector  The DKIM selector.
+ * \param[in] domain  The domain name.
+ *
+ * \return The DNS record.
+ */
+std::string dkim_key::txt_record(std::string const & selector, std::string const & domain) const
+{
+    std::string result(selector);
+    result += "._domainkey\tIN\tTXT\t( \"v=DKIM1; ";
+    if(f_type == dkim_key_type_t::DKIM_KEY_TYPE_RSA)
+    {
+        result += "h=sha256; k=rsa; \"";
+    }
+    else
+    {
+        result += "k=ed25519; \"";
+    }
+
+    std::string const p("p=" + f_public_key);
+    for(std::size_t pos(0); pos < p.length(); pos += g_txt_string_length)
+    {
+        result += "\n\t  \"";
+        result += p.substr(pos, g_txt_string_length);
+        result += '"';
+    }
+
+    result += " )  ; ----- DKIM key ";
+    result += selector;
+    result += " for ";
+    result += domain;
+    result += '\n';
+
+    return result;
+}
+
+
+/** \brief Get the last error.
+ *
+ * \return The error message of the last generate() failure.
+ */
+std::string const & dkim_key::last_error() const
+{
+    return f_last_error;
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,67 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+/** \file
+ * \brief Generation of OpenDKIM keys.
+ *
+ * The dkim_key class generates the private key and the DNS record of a
+ * DKIM selector in process (using OpenSSL) instead of running the
+ * `opendkim-genkey` tool. The resulting files are compatible with the
+ * ones generated by that tool.
+ */
+
+
+// C++
+//
+#include    <string>
+
+
+
+enum class dkim_key_type_t
+{
+    DKIM_KEY_TYPE_RSA,
+    DKIM_KEY_TYPE_ED25519,
+};
+
+
+bool                        string_to_dkim_key_type(std::string const & name, dkim_key_type_t & type);
+
+
+class dkim_key
+{
+public:
+    static constexpr int const  DEFAULT_RSA_BITS = 2048;
+
+    bool                    generate(dkim_key_type_t type, int bits = DEFAULT_RSA_BITS);
+    std::string const &     private_key() const;
+    std::string const &     public_key() const;
+    std::string             txt_record(std::string const & selector, std::string const & domain) const;
+    std::string const &     last_error() const;
+
+private:
+    dkim_key_type_t         f_type = dkim_key_type_t::DKIM_KEY_TYPE_RSA;
+    std::string             f_private_key = std::string();
+    std::string             f_public_key = std::string();
+    std::string             f_last_error = std::string();
+};
+
+
+
+// vim: ts=4 sw=4 et
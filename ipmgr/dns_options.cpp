@@ -0,0 +1,2551 @@
+// Copyright (c) 2018-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+/** \file
+ * \brief Implementation of the named.conf editor.
+ *
+ * The lexer tokenizes the file in place: the tokens reference the
+ * input buffer. The parser creates a tree of keywords allocated in one
+ * arena. The matcher resolves the expressions against that tree and
+ * edits the buffer, parsing again only the statements that changed.
+ */
+
+
+// self
+//
+#include    "dns_options.h"
+
+
+// snapdev
+//
+#include    <snapdev/file_contents.h>
+#include    <snapdev/not_reached.h>
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+void dns_options::token::set_input(std::string const * input)
+{
+    f_input = input;
+}
+
+
+void dns_options::token::set_type(token_type_t type)
+{
+    f_type = type;
+}
+
+
+/** \brief Define the word of this token.
+ *
+ * The word is not copied. It is defined by its position in the input
+ * buffer so it remains valid when the buffer is edited (the edits move
+ * the tokens with shift()).
+ *
+ * \param[in] start  The position of the word in the input.
+ * \param[in] size  The number of characters in the word.
+ */
+void dns_options::token::set_word(int start, int size)
+{
+    f_word_start = start;
+    f_word_size = size;
+}
+
+
+void dns_options::token::set_start(int start)
+{
+    f_start = start;
+}
+
+
+void dns_options::token::set_end(int end)
+{
+    f_end = end;
+}
+
+
+void dns_options::token::set_line(int line)
+{
+    f_line = line;
+}
+
+
+void dns_options::token:: set_block_level(int level)
+{
+    f_block_level = level;
+}
+
+
+bool dns_options::token::is_null() const
+{
+    return f_type == token_type_t::TOKEN_KEYWORD
+        && get_word() == "null";
+}
+
+
+dns_options::token_type_t dns_options::token::get_type() const
+{
+    return f_type;
+}
+
+
+/** \brief Get the word of this token.
+ *
+ * For a quoted string, the word is the raw content between the quotes.
+ * The escape sequences are kept as is.
+ *
+ * \return A view of the word in the input buffer.
+ */
+std::string_view dns_options::token::get_word() const
+{
+    if(f_input == nullptr)
+    {
+        return std::string_view();
+    }
+    return std::string_view(f_input->data() + f_word_start, f_word_size);
+}
+
+
+int dns_options::token::get_start() const
+{
+    return f_start;
+}
+
+
+int dns_options::token::get_end() const
+{
+    return f_end;
+}
+
+
+int dns_options::token::get_line() const
+{
+    return f_line;
+}
+
+
+int dns_options::token::get_block_level() const
+{
+    return f_block_level;
+}
+
+
+void dns_options::token::set_end_of_value(int end)
+{
+    f_end_of_value = end;
+}
+
+
+int dns_options::token::get_end_of_value() const
+{
+    return f_end_of_value;
+}
+
+
+/** \brief Move the token in the input data.
+ *
+ * When the data before this token gets edited, its positions have to
+ * be moved by the number of characters added or removed.
+ *
+ * \param[in] offset  The number of characters to move this token by.
+ */
+void dns_options::token::shift(int offset)
+{
+    f_word_start += offset;
+    if(f_start != -1)
+    {
+        f_start += offset;
+    }
+    if(f_end != -1)
+    {
+        f_end += offset;
+    }
+    if(f_end_of_value != -1)
+    {
+        f_end_of_value += offset;
+    }
+}
+
+
+std::string dns_options::token::to_string() const
+{
+    switch(f_type)
+    {
+    case token_type_t::TOKEN_UNKNOWN:              // unknown token
+        return std::string("--unknown--");
+
+    case token_type_t::TOKEN_EOT:                  // end of tokens
+        return std::string("--end of tokens--");
+
+    case token_type_t::TOKEN_KEYWORD:              // option names & values
+        if(f_word_size == 0)
+        {
+            return std::string("--?empty keyword?--");
+        }
+        return std::string(get_word());
+
+    case token_type_t::TOKEN_STRING:               // "..."
+        return '"' + std::string(get_word()) + '"';
+
+    case token_type_t::TOKEN_OPEN_BLOCK:           // "{"
+        return std::string("{");
+
+    case token_type_t::TOKEN_CLOSE_BLOCK:          // "}"
+        return std::string("}");
+
+    case token_type_t::TOKEN_END_OF_DEFINITION:    // ";"
+        return std::string(";");
+
+    case token_type_t::TOKEN_OPEN_INDEX:           // "["
+        return std::string("[");
+
+    case token_type_t::TOKEN_CLOSE_INDEX:          // "]"
+        return std::string("]");
+
+    case token_type_t::TOKEN_FIELD:                // "."
+        return std::string(".");
+
+    case token_type_t::TOKEN_ASSIGN:               // "="
+        return std::string("=");
+
+    case token_type_t::TOKEN_UPDATE:               // "+="
+        return std::string("+=");
+
+    case token_type_t::TOKEN_CREATE:               // "?="
+        return std::string("?=");
+
+    case token_type_t::TOKEN_REMOVE:               // "=" "null"
+        return std::string("--REMOVE--");
+
+    case token_type_t::TOKEN_GET:                  // no "=", no value
+        return std::string("--GET--");
+
+    case token_type_t::TOKEN_ERROR:                // an error occurred
+        return std::string("--ERROR--");
+
+    }
+    snapdev::NOT_REACHED();
+    return std::string();
+}
+
+
+
+
+
+
+
+
+dns_options::keyword::keyword(token const & t)
+    : f_token(t)
+{
+}
+
+
+dns_options::token const & dns_options::keyword::get_token() const
+{
+    return f_token;
+}
+
+
+dns_options::token & dns_options::keyword::get_token()
+{
+    return f_token;
+}
+
+
+void dns_options::keyword::set_command(token_type_t command)
+{
+    f_command = command;
+}
+
+
+dns_options::token_type_t dns_options::keyword::get_command() const
+{
+    return f_command;
+}
+
+
+dns_options::keyword_id_t dns_options::keyword::get_parent() const
+{
+    return f_parent;
+}
+
+
+dns_options::keyword_id_t dns_options::keyword::get_next() const
+{
+    return f_next;
+}
+
+
+dns_options::keyword_id_t dns_options::keyword::first_index() const
+{
+    return f_index.f_first;
+}
+
+
+dns_options::keyword_id_t dns_options::keyword::first_field() const
+{
+    return f_fields.f_first;
+}
+
+
+dns_options::keyword_id_t dns_options::keyword::last_field() const
+{
+    return f_fields.f_last;
+}
+
+
+dns_options::keyword_id_t dns_options::keyword::first_value() const
+{
+    return f_value.f_first;
+}
+
+
+dns_options::keyword_id_t dns_options::keyword::last_value() const
+{
+    return f_value.f_last;
+}
+
+
+
+
+
+
+
+
+/** \brief Reserve space for keywords.
+ *
+ * This avoids growing the arena many times while parsing a large file.
+ *
+ * \param[in] size  The number of keywords expected.
+ */
+void dns_options::keyword_tree::reserve(std::size_t size)
+{
+    f_keywords.reserve(size);
+}
+
+
+/** \brief Create a new keyword.
+ *
+ * \warning
+ * Creating a keyword may move the other keywords in memory. References
+ * returned by operator [] are not valid after a call to this function.
+ *
+ * \param[in] t  The token of the new keyword.
+ *
+ * \return The identifier of the new keyword.
+ */
+dns_options::keyword_id_t dns_options::keyword_tree::create(token const & t)
+{
+    f_keywords.emplace_back(t);
+    return static_cast<keyword_id_t>(f_keywords.size() - 1);
+}
+
+
+dns_options::keyword & dns_options::keyword_tree::operator [] (keyword_id_t id)
+{
+    return f_keywords[id];
+}
+
+
+dns_options::keyword const & dns_options::keyword_tree::operator [] (keyword_id_t id) const
+{
+    return f_keywords[id];
+}
+
+
+void dns_options::keyword_tree::append(keyword_id_t k, keyword::list_t keyword::*list, keyword_id_t child)
+{
+    keyword::list_t & l(f_keywords[k].*list);
+    if(l.f_last == NO_KEYWORD)
+    {
+        l.f_first = child;
+    }
+    else
+    {
+        f_keywords[l.f_last].f_next = child;
+    }
+    l.f_last = child;
+    f_keywords[child].f_parent = k;
+}
+
+
+void dns_options::keyword_tree::add_index(keyword_id_t k, keyword_id_t index)
+{
+    append(k, &keyword::f_index, index);
+}
+
+
+void dns_options::keyword_tree::add_field(keyword_id_t k, keyword_id_t field)
+{
+    append(k, &keyword::f_fields, field);
+}
+
+
+void dns_options::keyword_tree::add_value(keyword_id_t k, keyword_id_t value)
+{
+    append(k, &keyword::f_value, value);
+}
+
+
+/** \brief Replace a range of values with new values.
+ *
+ * This function is used after an edit to replace the values that were
+ * parsed again. The values of \p k found between \p previous and \p next
+ * (both excluded) are replaced by the values of the \p values keyword.
+ *
+ * The old values must first be removed from the lookup table of \p k
+ * with unindex_values(). The new values get added to that table.
+ *
+ * \param[in] k  The keyword whose values get replaced.
+ * \param[in] previous  The value before the replaced values or NO_KEYWORD.
+ * \param[in] next  The value after the replaced values or NO_KEYWORD.
+ * \param[in] values  The keyword holding the new values.
+ */
+void dns_options::keyword_tree::replace_values(keyword_id_t k, keyword_id_t previous, keyword_id_t next, keyword_id_t values)
+{
+    keyword::list_t & l(f_keywords[k].f_value);
+    keyword::list_t const & n(f_keywords[values].f_value);
+
+    keyword_id_t first(next);
+    if(n.f_first != NO_KEYWORD)
+    {
+        first = n.f_first;
+        for(keyword_id_t v(n.f_first); v != NO_KEYWORD; v = f_keywords[v].f_next)
+        {
+            f_keywords[v].f_parent = k;
+        }
+        f_keywords[n.f_last].f_next = next;
+    }
+
+    if(previous == NO_KEYWORD)
+    {
+        l.f_first = first;
+    }
+    else
+    {
+        f_keywords[previous].f_next = first;
+    }
+
+    if(next == NO_KEYWORD)
+    {
+        l.f_last = n.f_last != NO_KEYWORD ? n.f_last : previous;
+    }
+
+    auto it(f_lookup.find(k));
+    if(it != f_lookup.end())
+    {
+        for(keyword_id_t v(first); v != next; v = f_keywords[v].f_next)
+        {
+            add_lookup(it->second, v);
+        }
+    }
+}
+
+
+/** \brief Remove a range of values from the lookup table of a block.
+ *
+ * The words of the values are read from the input, so this function
+ * must be called before the input gets edited. The values of \p k
+ * found between \p previous and \p next (both excluded) are removed.
+ *
+ * \param[in] k  The keyword whose values are about to be replaced.
+ * \param[in] previous  The value before the replaced values or NO_KEYWORD.
+ * \param[in] next  The value after the replaced values or NO_KEYWORD.
+ */
+void dns_options::keyword_tree::unindex_values(keyword_id_t k, keyword_id_t previous, keyword_id_t next)
+{
+    auto it(f_lookup.find(k));
+    for(keyword_id_t v(previous == NO_KEYWORD ? f_keywords[k].f_value.f_first : f_keywords[previous].f_next);
+        v != next;
+        v = f_keywords[v].f_next)
+    {
+        // the blocks being removed will never be searched again
+        //
+        f_lookup.erase(v);
+
+        if(it == f_lookup.end())
+        {
+            continue;
+        }
+        keyword const & kw(f_keywords[v]);
+        std::string_view const word(kw.f_token.get_word());
+        remove_lookup(it->second, lookup_hash(word, std::string_view()), v);
+        if(kw.f_fields.f_first != NO_KEYWORD)
+        {
+            std::string_view const index(f_keywords[kw.f_fields.f_first].f_token.get_word());
+            if(!index.empty())
+            {
+                remove_lookup(it->second, lookup_hash(word, index), v);
+            }
+        }
+    }
+}
+
+
+/** \brief Move a keyword and all of its children.
+ *
+ * \param[in] k  The keyword to move.
+ * \param[in] offset  The number of characters to move the tokens by.
+ */
+void dns_options::keyword_tree::shift(keyword_id_t k, int offset)
+{
+    keyword & kw(f_keywords[k]);
+    kw.f_token.shift(offset);
+    for(keyword_id_t i(kw.f_index.f_first); i != NO_KEYWORD; i = f_keywords[i].f_next)
+    {
+        shift(i, offset);
+    }
+    for(keyword_id_t f(kw.f_fields.f_first); f != NO_KEYWORD; f = f_keywords[f].f_next)
+    {
+        shift(f, offset);
+    }
+    for(keyword_id_t v(kw.f_value.f_first); v != NO_KEYWORD; v = f_keywords[v].f_next)
+    {
+        shift(v, offset);
+    }
+}
+
+
+int dns_options::keyword_tree::value_start(keyword_id_t k) const
+{
+    keyword const & kw(f_keywords[k]);
+    if(kw.f_value.f_first != NO_KEYWORD)
+    {
+        return f_keywords[kw.f_value.f_first].f_token.get_start();
+    }
+
+    return -1;
+}
+
+
+int dns_options::keyword_tree::value_end(keyword_id_t k) const
+{
+    keyword const & kw(f_keywords[k]);
+    if(kw.f_value.f_last != NO_KEYWORD)
+    {
+        return f_keywords[kw.f_value.f_last].f_token.get_end();
+    }
+
+    return -1;
+}
+
+
+int dns_options::keyword_tree::field_value_start(keyword_id_t k) const
+{
+    keyword const & kw(f_keywords[k]);
+    if(kw.f_fields.f_first != NO_KEYWORD)
+    {
+        return f_keywords[kw.f_fields.f_first].f_token.get_start();
+    }
+
+    if(kw.f_value.f_first != NO_KEYWORD)
+    {
+        return f_keywords[kw.f_value.f_first].f_token.get_start();
+    }
+
+    return -1;
+}
+
+
+int dns_options::keyword_tree::field_value_end(keyword_id_t k) const
+{
+    keyword const & kw(f_keywords[k]);
+    if(kw.f_value.f_last != NO_KEYWORD)
+    {
+        return f_keywords[kw.f_value.f_last].f_token.get_end();
+    }
+
+    if(kw.f_fields.f_last != NO_KEYWORD)
+    {
+        return f_keywords[kw.f_fields.f_last].f_token.get_end();
+    }
+
+    return -1;
+}
+
+
+/** \brief Search the values of a block by name.
+ *
+ * This function returns the values of \p k named \p name, in the order
+ * they appear in the file. When \p index is not empty, only the values
+ * with a first field equal to \p index are returned. This is how a
+ * `zone "example.com"` is found among thousands of zones.
+ *
+ * The table uses hashes only, so the caller still has to compare the
+ * words, the types and the other fields of each candidate.
+ *
+ * \param[in] k  The block to search.
+ * \param[in] name  The name of the values to search.
+ * \param[in] index  The first field of the values or an empty string.
+ *
+ * \return The list of candidates, possibly empty.
+ */
+dns_options::keyword_tree::candidates_t const & dns_options::keyword_tree::find(
+      keyword_id_t k
+    , std::string_view name
+    , std::string_view index)
+{
+    auto it(f_lookup.find(k));
+    if(it == f_lookup.end())
+    {
+        it = f_lookup.emplace(k, lookup_t()).first;
+        for(keyword_id_t v(f_keywords[k].f_value.f_first); v != NO_KEYWORD; v = f_keywords[v].f_next)
+        {
+            add_lookup(it->second, v);
+        }
+    }
+
+    auto const c(it->second.find(lookup_hash(name, index)));
+    if(c == it->second.end())
+    {
+        static candidates_t const g_none = candidates_t();
+        return g_none;
+    }
+
+    return c->second;
+}
+
+
+/** \brief Add a value to a lookup table.
+ *
+ * The candidates are kept in the order they appear in the file, which
+ * is the order in which match() has to try them.
+ *
+ * \param[in,out] lookup  The lookup table of the parent of \p v.
+ * \param[in] v  The value to add.
+ */
+void dns_options::keyword_tree::add_lookup(lookup_t & lookup, keyword_id_t v)
+{
+    keyword const & kw(f_keywords[v]);
+    int const start(kw.f_token.get_start());
+    auto const insert([this, start, v](candidates_t & c)
+        {
+            c.insert(std::upper_bound(
+                      c.begin()
+                    , c.end()
+                    , start
+                    , [this](int s, keyword_id_t id)
+                        {
+                            return s < f_keywords[id].f_token.get_start();
+                        })
+                , v);
+        });
+
+    std::string_view const word(kw.f_token.get_word());
+    insert(lookup[lookup_hash(word, std::string_view())]);
+    if(kw.f_fields.f_first != NO_KEYWORD)
+    {
+        std::string_view const index(f_keywords[kw.f_fields.f_first].f_token.get_word());
+        if(!index.empty())
+        {
+            insert(lookup[lookup_hash(word, index)]);
+        }
+    }
+}
+
+
+void dns_options::keyword_tree::remove_lookup(lookup_t & lookup, std::size_t hash, keyword_id_t v)
+{
+    auto it(lookup.find(hash));
+    if(it == lookup.end())
+    {
+        return;
+    }
+
+    candidates_t & c(it->second);
+    c.erase(std::remove(c.begin(), c.end(), v), c.end());
+    if(c.empty())
+    {
+        lookup.erase(it);
+    }
+}
+
+
+std::size_t dns_options::keyword_tree::lookup_hash(std::string_view name, std::string_view index)
+{
+    std::size_t h(std::hash<std::string_view>()(name));
+    if(!index.empty())
+    {
+        h ^= std::hash<std::string_view>()(index) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
+
+std::string dns_options::keyword_tree::to_string(keyword_id_t k) const
+{
+    keyword const & kw(f_keywords[k]);
+    std::string result(kw.f_token.to_string());
+
+    for(keyword_id_t i(kw.f_index.f_first); i != NO_KEYWORD; i = f_keywords[i].f_next)
+    {
+        result += '[';
+        result += to_string(i);
+        result += ']';
+    }
+
+    for(keyword_id_t f(kw.f_fields.f_first); f != NO_KEYWORD; f = f_keywords[f].f_next)
+    {
+        result += '.';
+        result += to_string(f);
+    }
+
+    if(kw.f_command != token_type_t::TOKEN_GET)
+    {
+        result += ' ';
+        switch(kw.f_command)
+        {
+        case token_type_t::TOKEN_CREATE:
+            result += "?=";
+            break;
+
+        case token_type_t::TOKEN_UPDATE:
+            result += '+';
+            [[fallthrough]];
+        case token_type_t::TOKEN_ASSIGN:
+        case token_type_t::TOKEN_REMOVE:
+            result += '=';
+            break;
+
+        default:
+            result += "--UNKNOWN COMMAND--";
+            break;
+
+        }
+
+        for(keyword_id_t v(kw.f_value.f_first); v != NO_KEYWORD; v = f_keywords[v].f_next)
+        {
+            result += ' ';
+            result += to_string(v);
+        }
+    }
+
+    return result;
+}
+
+
+
+/** \brief Change the stream receiving the error messages.
+ *
+ * By default, the errors are written to std::cerr. A daemon such as
+ * ipmgr can capture them in a string stream and log them instead.
+ *
+ * \param[in] out  The stream receiving the error messages.
+ */
+void dns_options::set_error_stream(std::ostream & out)
+{
+    f_errors = &out;
+}
+
+
+std::ostream & dns_options::errors()
+{
+    return *f_errors;
+}
+
+
+/** \brief Load a named option file in memory.
+ *
+ * This function loads an option file in memory in its entirety and
+ * parses it. We work on the file in memory and once done the caller
+ * can save the new version with save().
+ *
+ * \param[in] filename  The name of the file to load.
+ *
+ * \return true if the file could be loaded and parsed, false otherwise.
+ */
+bool dns_options::load(std::string const & filename)
+{
+    f_filename = filename;
+
+    snapdev::file_contents file(f_filename);
+    if(!file.read_all())
+    {
+        // could not open file for reading
+        //
+        errors() << "dns_options:error: can't open file \""
+                 << f_filename
+                 << "\" for reading."
+                 << std::endl;
+        return false;
+    }
+
+    return set_data(file.contents());
+}
+
+
+/** \brief Parse options from memory.
+ *
+ * This function replaces the current data with \p data and parses it.
+ * It is used by load() and can be used directly when the options do
+ * not come from a file.
+ *
+ * \param[in] data  The options to parse.
+ *
+ * \return true if the data was parsed successfully.
+ */
+bool dns_options::set_data(std::string const & data)
+{
+    f_data = data;
+    f_modified = false;
+
+    return edit_option() == 0;
+}
+
+
+/** \brief Get the current options.
+ *
+ * This function returns the options including all the edits applied
+ * so far.
+ *
+ * \return A reference to the options buffer.
+ */
+std::string const & dns_options::get_data() const
+{
+    return f_data;
+}
+
+
+/** \brief Check whether an expression modified the options.
+ *
+ * \return true if the options need to be saved.
+ */
+bool dns_options::is_modified() const
+{
+    return f_modified;
+}
+
+
+/** \brief Save the updated file.
+ *
+ * This function saves the f_data buffer back to the file it was loaded
+ * from. It is expected that the f_data was modified before re-saving.
+ *
+ * \attention
+ * This class is not responsible to create backups. You may want to write
+ * a script that does that first:
+ *
+ * \code
+ *      cp /etc/bind/named.conf.options /etc/bind/named.conf.options.bak
+ *      dns_options --execute 'options.version = "none"' /etc/bind/named.conf.options
+ * \endcode
+ *
+ * \par
+ * One reason for not having an auto-backup is because you are very likely
+ * to update multiple fields and then the very first version would be lost
+ * anyway. Letting you create one backup with `cp` first is likely way
+ * cleaner.
+ *
+ * \return true if no error occurred, false otherwise.
+ */
+bool dns_options::save()
+{
+    snapdev::file_contents file(f_filename);
+    file.contents(f_data);
+    if(!file.write_all())
+    {
+        errors() << "dns_options:error: can't save file \""
+                 << f_filename
+                 << "\"."
+                 << std::endl;
+        return false;
+    }
+
+    f_modified = false;
+    return true;
+}
+
+
+/** \brief Add an expression to execute.
+ *
+ * The expression is parsed immediately so errors are reported before
+ * anything gets edited. It runs on the next call to execute().
+ *
+ * \param[in] expression  The expression to add.
+ *
+ * \return true if the expression is valid.
+ */
+bool dns_options::add_expression(std::string const & expression)
+{
+    // the tokens reference the expression so it must not move
+    //
+    f_expressions.push_back({ expression, NO_KEYWORD });
+    expression_t & e(f_expressions.back());
+    if(parse_command_line(e.f_execute) != 0)
+    {
+        f_expressions.pop_back();
+        return false;
+    }
+    e.f_keyword = f_keyword;
+
+    return true;
+}
+
+
+/** \brief Execute the expressions.
+ *
+ * This function applies the expressions added with add_expression()
+ * one after the other against the loaded options. Each edit updates
+ * the tree in memory so the following expressions see the result.
+ *
+ * The list of expressions is empty once this function returns. The
+ * values of the GET expressions are appended to the list of values.
+ *
+ * \return true if all the expressions were applied successfully.
+ */
+bool dns_options::execute()
+{
+    expression_list_t expressions;
+    expressions.swap(f_expressions);
+
+    if(f_options == NO_KEYWORD)
+    {
+        errors() << "dns_options:error: no options were loaded."
+                 << std::endl;
+        return false;
+    }
+
+    for(auto const & e : expressions)
+    {
+        f_execute = e.f_execute;
+        f_keyword = e.f_keyword;
+        if(match() != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Add and execute one expression.
+ *
+ * \param[in] expression  The expression to execute.
+ *
+ * \return true if the expression is valid and was applied successfully.
+ */
+bool dns_options::execute(std::string const & expression)
+{
+    return add_expression(expression)
+        && execute();
+}
+
+
+/** \brief Get the values found by the GET expressions.
+ *
+ * \return The values in the order the expressions were executed.
+ */
+dns_options::string_list_t const & dns_options::get_values() const
+{
+    return f_values;
+}
+
+
+void dns_options::clear_values()
+{
+    f_values.clear();
+}
+
+
+/** \brief Define the buffer to tokenize.
+ *
+ * The lexer reads the \p input buffer directly. The tokens it returns
+ * reference that buffer, so it must remain valid as long as the tokens
+ * are in use.
+ *
+ * \param[in] input  The buffer to tokenize.
+ * \param[in] pos  The position where the lexer starts.
+ * \param[in] line  The line number at \p pos.
+ */
+void dns_options::set_input(std::string const & input, int pos, int line)
+{
+    f_input = &input;
+    f_pos = pos;
+    f_line = line;
+    f_block_level = 0;
+}
+
+
+/** \brief Count the lines found in a part of the input.
+ *
+ * A "\r\n" sequence counts as one line as does a lone '\r'.
+ *
+ * \param[in] start  The start of the input to check.
+ * \param[in] end  The end of the input to check.
+ */
+void dns_options::count_lines(int start, int end)
+{
+    char const * s(f_input->data() + start);
+    char const * const e(f_input->data() + end);
+    for(;;)
+    {
+        s = std::find_if(s, e, [](char c) { return c == '\n' || c == '\r'; });
+        if(s == e)
+        {
+            return;
+        }
+        ++f_line;
+        if(*s == '\r'
+        && s + 1 < e
+        && s[1] == '\n')
+        {
+            ++s;
+        }
+        ++s;
+    }
+}
+
+
+/** \brief Get the next token.
+ *
+ * This function reads the next token from the input buffer. The blanks
+ * and comments are skipped. The word of the token references the input
+ * buffer (nothing gets copied).
+ *
+ * \param[in] extensions  Whether the function accepts our extensions.
+ *
+ * \return The token, TOKEN_EOT at the end of the input and TOKEN_ERROR
+ * if the input is invalid.
+ */
+dns_options::token dns_options::get_token(bool extensions)
+{
+    char const * const data(f_input->data());
+    int const size(f_input->length());
+
+    for(;;)
+    {
+        // ignore "noise"
+        //
+        while(f_pos < size)
+        {
+            char const c(data[f_pos]);
+            if(c == '\n')
+            {
+                ++f_line;
+            }
+            else if(c == '\r')
+            {
+                ++f_line;
+                if(f_pos + 1 < size
+                && data[f_pos + 1] == '\n')
+                {
+                    ++f_pos;
+                }
+            }
+            else if(c != ' '
+                 && c != '\t'
+                 && c != '\f')
+            {
+                break;
+            }
+            ++f_pos;
+        }
+
+        token result;
+        result.set_input(f_input);
+        result.set_start(f_pos);
+        result.set_line(f_line);
+        result.set_block_level(f_block_level);
+
+        if(f_pos >= size)
+        {
+            result.set_type(token_type_t::TOKEN_EOT);
+            result.set_end(f_pos);
+            return result;
+        }
+
+        auto single_character = [&](token_type_t type)
+            {
+                ++f_pos;
+                result.set_type(type);
+                result.set_end(f_pos);
+                return result;
+            };
+
+        char const c(data[f_pos]);
+        char const next(f_pos + 1 < size ? data[f_pos + 1] : '\0');
+        switch(c)
+        {
+        case '#':   // comment introducer
+            f_pos = std::find_if(data + f_pos, data + size, [](char n) { return n == '\n' || n == '\r'; }) - data;
+            continue;
+
+        case '/':   // probably a comment
+            if(next == '/')
+            {
+                // C++ like comment, similar to the '#...'
+                //
+                f_pos = std::find_if(data + f_pos, data + size, [](char n) { return n == '\n' || n == '\r'; }) - data;
+                continue;
+            }
+            if(next == '*')
+            {
+                // C like comment, search for "*/"
+                // BIND does not accept a comment within a comment
+                //
+                std::string_view::size_type const end(std::string_view(data, size).find("*/", f_pos + 2));
+                if(end == std::string_view::npos)
+                {
+                    count_lines(f_pos, size);
+                    f_pos = size;
+                    errors() << "dns_options:error:"
+                             << f_filename
+                             << ":"
+                             << f_line
+                             << ": end of C-like comment not found before EOF."
+                             << std::endl;
+                    result.set_type(token_type_t::TOKEN_ERROR);
+                    result.set_end(f_pos);
+                    return result;
+                }
+                count_lines(f_pos, end);
+                f_pos = end + 2;
+                continue;
+            }
+
+            // this is a "lone" '/' character, it is part of a keyword
+            //
+            break;
+
+        case '"':
+            // WARNING: no single quote string support in BIND
+            //
+            for(int p(f_pos + 1); p < size; ++p)
+            {
+                switch(data[p])
+                {
+                case '"':
+                    result.set_type(token_type_t::TOKEN_STRING);
+                    result.set_word(f_pos + 1, p - f_pos - 1);
+                    f_pos = p + 1;
+                    result.set_end(f_pos);
+                    return result;
+
+                case '\\':
+                    // the bind lexer allows for escaped characters like in
+                    // most languages (although no hex or octal support);
+                    // the escape sequence is kept as is in the word
+                    //
+                    if(p + 1 < size)
+                    {
+                        count_lines(p + 1, p + 2);
+                        if(data[p + 1] == '\r'
+                        && p + 2 < size
+                        && data[p + 2] == '\n')
+                        {
+                            ++p;
+                        }
+                    }
+                    ++p;
+                    break;
+
+                case '\n':
+                case '\r':
+                    // a newline in a string is not allow without
+                    // being escaped; so the following would be valid:
+                    //
+                    // "start...\x5C
+                    // ...end"
+                    //
+                    count_lines(p, p + 1);
+                    f_pos = p;
+                    errors() << "dns_options:error:"
+                             << f_filename
+                             << ":"
+                             << f_line
+                             << ": quoted string includes a non-escaped newline."
+                             << std::endl;
+                    result.set_type(token_type_t::TOKEN_ERROR);
+                    result.set_end(f_pos);
+                    return result;
+
+                }
+            }
+            f_pos = size;
+            errors() << "dns_options:error:"
+                     << f_filename
+                     << ":"
+                     << f_line
+                     << ": quoted string was never closed."
+                     << std::endl;
+            result.set_type(token_type_t::TOKEN_ERROR);
+            result.set_end(f_pos);
+            return result;
+
+        case ';':
+            return single_character(token_type_t::TOKEN_END_OF_DEFINITION);
+
+        case '{':
+            ++f_block_level;
+            result.set_block_level(f_block_level);
+            return single_character(token_type_t::TOKEN_OPEN_BLOCK);
+
+        case '}':
+            if(f_block_level <= 0)
+            {
+                errors() << "dns_options:error:"
+                         << f_filename
+                         << ":"
+                         << f_line
+                         << ": '}' mismatch, '{' missing for this one."
+                         << std::endl;
+                return single_character(token_type_t::TOKEN_ERROR);
+            }
+            --f_block_level;
+            result.set_block_level(f_block_level);
+            return single_character(token_type_t::TOKEN_CLOSE_BLOCK);
+
+        case '[':
+            if(extensions)
+            {
+                return single_character(token_type_t::TOKEN_OPEN_INDEX);
+            }
+            break;
+
+        case ']':
+            if(extensions)
+            {
+                return single_character(token_type_t::TOKEN_CLOSE_INDEX);
+            }
+            break;
+
+        case '.':
+            if(extensions)
+            {
+                return single_character(token_type_t::TOKEN_FIELD);
+            }
+            break;
+
+        case '=':
+            if(extensions)
+            {
+                return single_character(token_type_t::TOKEN_ASSIGN);
+            }
+            break;
+
+        case '+':
+            if(extensions
+            && next == '=')
+            {
+                ++f_pos;
+                return single_character(token_type_t::TOKEN_UPDATE);
+            }
+            break;
+
+        case '?':
+            if(extensions
+            && next == '=')
+            {
+                ++f_pos;
+                return single_character(token_type_t::TOKEN_CREATE);
+            }
+            break;
+
+        }
+
+        // anything else is a keyword which ends with a blank or the
+        // start of another token
+        //
+        int p(f_pos + 1);
+        int end(-1);
+        for(; p < size && end == -1; ++p)
+        {
+            switch(data[p])
+            {
+            case ' ':
+            case '\t':
+            case '\f':
+            case '\n':
+                // the blank is included in the token
+                //
+                end = p + 1;
+                break;
+
+            case '\r':
+                end = p + 1;
+                if(end < size
+                && data[end] == '\n')
+                {
+                    ++end;
+                }
+                break;
+
+            case '{':
+            case '}':
+            case '"':
+            case ';':
+            case '#':
+                // that character is a token on its own
+                //
+                end = p;
+                break;
+
+            case '/':
+                // is that the start of a comment?
+                // if so we found the end of this token
+                //
+                if(p + 1 < size
+                && (data[p + 1] == '/' || data[p + 1] == '*'))
+                {
+                    end = p;
+                }
+                break;
+
+            case '[':
+            case ']':
+            case '=':
+            case '?':
+            case '+':
+            case '.':
+                if(extensions)
+                {
+                    end = p;
+                }
+                break;
+
+            }
+        }
+        if(end == -1)
+        {
+            // reached the end of the input
+            //
+            end = size;
+        }
+        else
+        {
+            // the loop increments p once more
+            //
+            --p;
+        }
+        count_lines(p, end);
+        result.set_type(token_type_t::TOKEN_KEYWORD);
+        result.set_word(f_pos, p - f_pos);
+        f_pos = end;
+        result.set_end(f_pos);
+        return result;
+    }
+}
+
+
+/** \brief Parse the command line.
+ *
+ * See the main() function documentation for the definition of the
+ * command line.
+ *
+ * \return 0 on success, 1 on error.
+ */
+int dns_options::parse_command_line(std::string const & execute)
+{
+    int r(0);
+
+    set_input(execute);
+
+    // the command line must start with a keyword
+    //
+    //     keyword
+    //
+    token t(get_token(true));
+    if(t.get_type() != token_type_t::TOKEN_KEYWORD)
+    {
+        if(t.get_type() != token_type_t::TOKEN_ERROR)
+        {
+            errors() << "dns_options:error:<execute>:"
+                     << f_line
+                     << ": we first expected a keyword on your command line."
+                     << std::endl;
+        }
+        return 1;
+    }
+
+    f_keyword = f_tree.create(t);
+
+    auto get_index = [&](keyword_id_t p)
+        {
+            for(;;)
+            {
+                t = get_token(true);
+                switch(t.get_type())
+                {
+                case token_type_t::TOKEN_ERROR:
+                    return 1;
+
+                case token_type_t::TOKEN_KEYWORD:
+                case token_type_t::TOKEN_STRING:
+                    {
+                        f_tree.add_index(p, f_tree.create(t));
+                    }
+                    break;
+
+                default:
+                    errors() << "dns_options:error:<execute>:"
+                             << f_line
+                             << ": we expected a keyword or a quoted string as an index."
+                             << std::endl;
+                    return 1;
+
+                }
+
+                // after that (keyword | "string") we expect the ']'
+                //
+                t = get_token(true);
+                if(t.get_type() != token_type_t::TOKEN_CLOSE_INDEX)
+                {
+                    errors() << "dns_options:error:<execute>:"
+                             << f_line
+                             << ": we expected a ']' to close an index."
+                             << std::endl;
+                    return 1;
+                }
+                // skip the ']'
+                //
+                t = get_token(true);
+
+                // if we do not have another '[' then we are done with indexes
+                //
+                if(t.get_type() != token_type_t::TOKEN_OPEN_INDEX)
+                {
+                    return 0;
+                }
+            }
+        };
+
+    t = get_token(true);
+    if(t.get_type() == token_type_t::TOKEN_OPEN_INDEX)
+    {
+        // the keyword can be followed by any number of indexes
+        //
+        //      keyword [ index1 ] [ index2 ] ...
+        //
+        r = get_index(f_keyword);
+        if(r != 0)
+        {
+            return r;
+        }
+    }
+
+    while(t.get_type() == token_type_t::TOKEN_FIELD)
+    {
+        // the keyword and indexes can be followed by a field
+        // and the field can be followed by indexes, any number
+        // of fields with indexes can be defined
+        //
+        //      keyword [ index1 ] [ index2 ] . field [ index1 ] [ index2 ] ...
+        //
+        t = get_token(true);
+
+        if(t.get_type() == token_type_t::TOKEN_ERROR)
+        {
+            return 1;
+        }
+
+        if(t.get_type() != token_type_t::TOKEN_KEYWORD
+        && t.get_type() != token_type_t::TOKEN_STRING)
+        {
+            errors() << "dns_options:error:<execute>:"
+                     << f_line
+                     << ": we expected a keyword or a quoted string as the field name."
+                     << std::endl;
+            return 1;
+        }
+
+        keyword_id_t const f(f_tree.create(t));
+        f_tree.add_field(f_keyword, f);
+
+        t = get_token(true);
+        if(t.get_type() == token_type_t::TOKEN_OPEN_INDEX)
+        {
+            r = get_index(f);
+            if(r != 0)
+            {
+                return r;
+            }
+        }
+    }
+
+    // if that's it (i.e. EOT), we have a GET
+    //
+    switch(t.get_type())
+    {
+    case token_type_t::TOKEN_EOT:
+        // it worked, we have a GET
+        //
+        return 0;
+
+    case token_type_t::TOKEN_END_OF_DEFINITION:
+        t = get_token(true);
+        if(t.get_type() != token_type_t::TOKEN_EOT)
+        {
+            errors() << "dns_options:error:<execute>:"
+                     << f_line
+                     << ": nothing was expected after the ';'."
+                     << std::endl;
+            return 1;
+        }
+
+        // it worked, we have a GET (totally ignore the ';')
+        //
+        return 0;
+
+    case token_type_t::TOKEN_ASSIGN:
+    case token_type_t::TOKEN_UPDATE:
+    case token_type_t::TOKEN_CREATE:
+        // here we have a SET, CREATE, UPDATE or a REMOVE depending on
+        // the assignment token and the value; the assignment operator
+        // is called the command which by default is set to GET
+        //
+        //      keyword [ index1 ] . field [ index1 ] ( = | += | ?= ) ...
+        //
+        f_tree[f_keyword].set_command(t.get_type());
+        break;
+
+    default:
+        errors() << "dns_options:error:<execute>:"
+                 << f_line
+                 << ": end of line or an assignment operator (=, ?=, +=) was expected."
+                 << std::endl;
+        return 1;
+
+    }
+
+    // we have an assignment, read the value
+    //
+    t = get_token(false);
+
+    if(t.is_null())
+    {
+        if(f_tree[f_keyword].get_command() != token_type_t::TOKEN_ASSIGN)
+        {
+            errors() << "dns_options:error:<execute>:"
+                     << f_line
+                     << ": an assignment to null only works with the '=' operator."
+                     << std::endl;
+            return 1;
+        }
+        f_tree[f_keyword].set_command(token_type_t::TOKEN_REMOVE);
+
+        t = get_token(false);
+        if(t.get_type() == token_type_t::TOKEN_END_OF_DEFINITION)
+        {
+            t = get_token(false);
+        }
+        if(t.get_type() != token_type_t::TOKEN_EOT)
+        {
+            errors() << "dns_options:error:<execute>:"
+                     << f_line
+                     << ": an assignment to null cannot include anything else."
+                     << std::endl;
+            return 1;
+        }
+
+        // it worked, we have a REMOVE
+        //
+        return 0;
+    }
+
+    // read the value to be assigned
+    //
+    for(;; t = get_token(false))
+    {
+        switch(t.get_type())
+        {
+        case token_type_t::TOKEN_EOT:
+            return 0;
+
+        case token_type_t::TOKEN_END_OF_DEFINITION:
+            t = get_token(false);
+            if(t.get_type() != token_type_t::TOKEN_EOT)
+            {
+                errors() << "dns_options:error:<execute>:"
+                         << f_line
+                         << ": nothing was expected after the ';'."
+                         << std::endl;
+                return 1;
+            }
+            return 0;
+
+        case token_type_t::TOKEN_KEYWORD:
+        case token_type_t::TOKEN_STRING:
+            {
+                f_tree.add_value(f_keyword, f_tree.create(t));
+            }
+            break;
+
+        default:
+            errors() << "dns_options:error:<execute>:"
+                     << f_line
+                     << ": the command line value cannot include a block."
+                     << std::endl;
+            return 1;
+
+        }
+    }
+}
+
+
+/** \brief Search for an option, if not present, add it.
+ *
+ * This function parses the options file transforming it into tokens.
+ *
+ * The function checks those tokens against the option being edited.
+ * First, the function searches for the blocks (blocks start with `{`
+ * where the option is expected to be defined
+ * (i.e. `\<name> { block-with-option }`).
+ *
+ * Note that at each new option we save the current parser position.
+ * This is used to remove the option entirely in case the command
+ * was `--remove`.
+ *
+ * Similarly, once an option name was parsed, we save the beginning
+ * and end positions of the value of that option. This gives us the
+ * ability to edit that value.
+ *
+ * Finally, if the option is not found in the block expected to hold
+ * it, the save the position before the closing curvly brace (}) so
+ * we can insert  the option there if the command asks us to do so.
+ *
+ * If the block is not even found, then the function can still add
+ * the option by creating the whole block along the way.
+ *
+ * \return 0 on success, 1 on error, 2 if the option already exists.
+ */
+int dns_options::edit_option()
+{
+    // a keyword is at least two characters ("x;", "x " ...); most are
+    // much longer so this is a good upper bound
+    //
+    f_tree.reserve(f_data.length() / 8);
+    f_options = f_tree.create(token());
+
+    set_input(f_data);
+    return parse_options(f_options, f_data.length());
+}
+
+
+/** \brief Parse top level options.
+ *
+ * This function reads the options found between the current position
+ * and \p end and adds them to the \p in keyword.
+ *
+ * \param[in] in  The keyword receiving the options.
+ * \param[in] end  The position where the parser stops.
+ *
+ * \return 0 on success, 1 on error.
+ */
+int dns_options::parse_options(keyword_id_t in, int end)
+{
+    int r(0);
+    for(;;)
+    {
+        token t(get_token());
+        if(t.get_type() == token_type_t::TOKEN_EOT
+        || t.get_start() >= end)
+        {
+            // done?
+            //
+            break;
+        }
+        if(t.get_type() == token_type_t::TOKEN_ERROR)
+        {
+            // got an error while reading input file
+            //
+            return 1;
+        }
+
+        // got a keyword
+        //
+        keyword_id_t const k(f_tree.create(t));
+
+        // read until we find an end of definition (a.k.a. ';')
+        //
+        bool more(true);
+        do
+        {
+            t = get_token();
+            switch(t.get_type())
+            {
+            case token_type_t::TOKEN_EOT:
+                errors() << "dns_options:error: found EOT, expected a ';' before the end of the file."
+                         << std::endl;
+                return 1;
+
+            case token_type_t::TOKEN_ERROR:
+                return 1;
+
+            case token_type_t::TOKEN_END_OF_DEFINITION:
+                more = false;
+                break;
+
+            case token_type_t::TOKEN_OPEN_BLOCK:
+                r = recursive_option(k);
+                if(r != 0)
+                {
+                    return r;
+                }
+                break;
+
+            case token_type_t::TOKEN_CLOSE_BLOCK:
+                errors() << "dns_options:error: found '}' without first finding a '{'."
+                         << std::endl;
+                return 1;
+
+            case token_type_t::TOKEN_KEYWORD:
+            case token_type_t::TOKEN_STRING:
+                f_tree.add_field(k, f_tree.create(t));
+                break;
+
+            default:
+                errors() << "dns_options:error: unexpected token "
+                         << static_cast<int>(t.get_type())
+                         << "."
+                         << std::endl;
+                return 1;
+
+            }
+        }
+        while(more);
+
+        f_tree[k].get_token().set_end_of_value(f_pos);
+        f_tree.add_value(in, k);
+    }
+
+    return 0;
+}
+
+
+/** \brief Read the content of a block recursively
+ *
+ * This function reads the contents of one block ('{ ... }').
+ *
+ * Each line is added as a value of the \p in keyword which you pass as
+ * a parameter.
+ *
+ * \note
+ * When an error happens at any level of recursivity, it will unwind the
+ * whole stack at once and return 1.
+ *
+ * \param[in] in  The keyword that will hold the block value.
+ *
+ * \return 0 when the block was read successfully, 1 otherwise
+ */
+int dns_options::recursive_option(keyword_id_t in)
+{
+    int r(0);
+    for(;;)
+    {
+        token t(get_token());
+        if(t.get_type() == token_type_t::TOKEN_EOT)
+        {
+            // done?
+            //
+            errors() << "dns_options:error: found end of input before '}'."
+                     << std::endl;
+            return 1;
+        }
+        if(t.get_type() == token_type_t::TOKEN_ERROR)
+        {
+            // got an error while reading input file
+            //
+            return 1;
+        }
+        if(t.get_type() == token_type_t::TOKEN_CLOSE_BLOCK)
+        {
+            // proper end of block, return now
+            //
+            return 0;
+        }
+
+        // got a keyword
+        //
+        keyword_id_t const k(f_tree.create(t));
+
+        // read until we find an end of definition (a.k.a. ';')
+        //
+        bool more(true);
+        do
+        {
+            t = get_token();
+            switch(t.get_type())
+            {
+            case token_type_t::TOKEN_EOT:
+                errors() << "dns_options:error: found EOT, expected a ';' before the end of the file."
+                         << std::endl;
+                return 1;
+
+            case token_type_t::TOKEN_ERROR:
+                return 1;
+
+            case token_type_t::TOKEN_END_OF_DEFINITION:
+                more = false;
+                break;
+
+            case token_type_t::TOKEN_OPEN_BLOCK:
+                r = recursive_option(k);
+                if(r != 0)
+                {
+                    return r;
+                }
+                break;
+
+            case token_type_t::TOKEN_CLOSE_BLOCK:
+                // end of block, return
+                //
+                errors() << "dns_options:warning: found '}' without a ';' to end the last line."
+                         << std::endl;
+                f_tree.add_value(in, k);
+                return 0;
+
+            case token_type_t::TOKEN_KEYWORD:
+            case token_type_t::TOKEN_STRING:
+                f_tree.add_field(k, f_tree.create(t));
+                break;
+
+            default:
+                errors() << "dns_options:error: unexpected token "
+                         << static_cast<int>(t.get_type())
+                         << "."
+                         << std::endl;
+                return 1;
+
+            }
+        }
+        while(more);
+
+        f_tree[k].get_token().set_end_of_value(f_pos);
+        f_tree.add_value(in, k);
+    }
+
+    snapdev::NOT_REACHED();
+    return 1;
+}
+
+
+
+/** \brief Replace part of the data and update the tree.
+ *
+ * This function replaces the data between \p start and \p end with
+ * \p replacement. Then it updates the tree of options so it matches
+ * the new data without parsing the whole file again: the top level
+ * options affected by the edit are parsed again and the options that
+ * follow are moved by the number of characters added or removed.
+ *
+ * \param[in] start  The start of the data to replace.
+ * \param[in] end  The end of the data to replace.
+ * \param[in] replacement  The new data.
+ *
+ * \return 0 on success, 1 if the new data could not be parsed.
+ */
+int dns_options::replace_data(int start, int end, std::string const & replacement)
+{
+    int const offset(static_cast<int>(replacement.length()) - (end - start));
+
+    // search the top level options affected by this edit
+    //
+    keyword_id_t previous(NO_KEYWORD);
+    keyword_id_t first(f_tree[f_options].first_value());
+    while(first != NO_KEYWORD
+       && f_tree[first].get_token().get_end_of_value() <= start)
+    {
+        previous = first;
+        first = f_tree[first].get_next();
+    }
+    keyword_id_t last(NO_KEYWORD);
+    keyword_id_t next(first);
+    while(next != NO_KEYWORD
+       && f_tree[next].get_token().get_start() < end)
+    {
+        last = next;
+        next = f_tree[next].get_next();
+    }
+
+    int parse_start(start);
+    int parse_end(start + replacement.length());
+    if(last != NO_KEYWORD)
+    {
+        parse_start = std::min(parse_start, f_tree[first].get_token().get_start());
+        parse_end = std::max(parse_end, f_tree[last].get_token().get_end_of_value() + offset);
+    }
+
+    // the words of the old options are not available after the edit
+    //
+    f_tree.unindex_values(f_options, previous, next);
+
+    f_data.replace(start, end - start, replacement);
+    f_modified = true;
+
+    // the options after the edit only move
+    //
+    for(keyword_id_t v(next); v != NO_KEYWORD; v = f_tree[v].get_next())
+    {
+        f_tree.shift(v, offset);
+    }
+
+    // parse the edited options again
+    //
+    set_input(f_data, parse_start, 1 + std::count(f_data.begin(), f_data.begin() + parse_start, '\n'));
+
+    keyword_id_t const edited(f_tree.create(token()));
+    int const r(parse_options(edited, parse_end));
+    if(r != 0)
+    {
+        errors() << "dns_options:error: the result of \""
+                 << f_execute
+                 << "\" could not be parsed; the file was not modified."
+                 << std::endl;
+        return r;
+    }
+    f_tree.replace_values(f_options, previous, next, edited);
+
+    return 0;
+}
+
+
+/** \brief Go through and apply the command line expression.
+ *
+ * This function attempts to match the command line expression to the
+ * file we just loaded and apply the command line operation as required.
+ *
+ * Supported operations are:
+ *
+ * \li GET (no assignment) -- retrieve a field's value; it gets printed in stdout
+ * \li ASSIGN (=) -- add or update a field's value; by default the file is
+ * modified with the change, use --stdout to get the result in the console
+ * \li UPDATE (?=) -- update a field's value; like ASSIGN except that the value
+ * must already exist, nothing happens otherwise
+ * \li CREATE (+=) -- add a field with its value; if the parameter already
+ * exists, leave it alone, otherwise add it at the end of the existing
+ * value like the ASSIGN would otherwise do
+ * \li REMOVE (= null) -- remove the field if it exists
+ *
+ * This currently works well for standalone fields. Fields for which you
+ * want to replace an entire block (the whole value between quotes) is
+ * likelyt to fail badly.
+ *
+ * \bug
+ * Test and correct as required this implementation so we can update
+ * any field including a whole block. At this time this does not work
+ * properly.
+ *
+ * \bug
+ * The creation is not recursive. So if you want to create `a { b { c 123; } }`
+ * where `a` or `b` do not yet exist, it will not work. If `a` and `b` exist,
+ * but `c` does not exist, then we create `c` as expected.
+ *
+ * \bug
+ * There are potential problems with the use of `"*"` and the creation of
+ * fields that end up being set to `"*"` instead of an actual index name.
+ */
+int dns_options::match()
+{
+    // the match is in f_keyword
+    //
+    // what to match (the files of options) is in f_options
+    //
+
+// 'options.version [+?]= "none"'
+// 'logging.channel["logs"].print-category [+?]= yes'
+// 'logging.channel["logs"].print-time = null'
+// 'logging.channel["*"].severity'
+//
+// sample data:
+//
+// options { version "1.2.3"; }
+// logging { channel "any-name" { severity 123 } }
+
+    auto const & k(f_tree[f_keyword].get_token());
+    auto const   type(k.get_type());
+    auto const   word(k.get_word());
+    token_type_t const command(f_tree[f_keyword].get_command());
+
+    // WARNING: the candidates get invalidated by replace_data(), so we
+    //          must leave this loop once the file was edited
+    //
+    for(keyword_id_t const v : f_tree.find(f_options, word, lookup_index(f_keyword)))
+    {
+        auto const & o(f_tree[v].get_token());
+        if(o.get_type() == type
+        && o.get_word() == word
+        && match_indexes(f_keyword, v))
+        {
+            // if f_keyword has further fields, then we need to go further
+            //
+            keyword_id_t previous_level(NO_KEYWORD);
+            keyword_id_t field(f_tree[f_keyword].first_field());
+            keyword_id_t const result(match_fields(field, v, previous_level));
+            if(result != NO_KEYWORD)
+            {
+                int const start(f_tree.field_value_start(result));
+                int const end(f_tree.field_value_end(result));
+
+                switch(command)
+                {
+                case token_type_t::TOKEN_ASSIGN:
+                case token_type_t::TOKEN_UPDATE:
+                    {
+                        keyword_id_t const last_field(f_tree[f_keyword].last_field());
+                        if(last_field != NO_KEYWORD)
+                        {
+                            if(f_tree[last_field].get_token().get_word() == "_")
+                            {
+                                // nothing to do, the unnamed value already exists
+                                //
+                                break;
+                            }
+                        }
+
+                        int const replacement_start(f_tree.value_start(f_keyword));
+                        int const replacement_end(f_tree.value_end(f_keyword));
+
+                        if(start == -1
+                        || end == -1
+                        || replacement_start == -1
+                        || replacement_end == -1)
+                        {
+                            errors() << "dns_options:error: start/end parameters not properly defined to SET/UPDATE this value."
+                                     << std::endl;
+                            return 1;
+                        }
+
+                        int const r(replace_data(
+                                  start
+                                , end
+                                , f_execute.substr(replacement_start, replacement_end - replacement_start)));
+                        if(r != 0)
+                        {
+                            return r;
+                        }
+                    }
+                    break;
+
+                case token_type_t::TOKEN_CREATE:
+                    // it exists, do not modify it in this case
+                    break;
+
+                case token_type_t::TOKEN_REMOVE:
+                    // we have to remove that entry, `result` represents
+                    // the value, so we have to get the parent and determine
+                    // the start end of the parent instead
+                    //
+                    {
+                        keyword_id_t const parent(f_tree[result].get_parent());
+                        if(parent == NO_KEYWORD)
+                        {
+                            errors() << "dns_options:error: no parent field found for a REMOVE."
+                                     << std::endl;
+                            return 1;
+                        }
+
+                        keyword_id_t vit(f_tree[parent].first_value());
+                        while(vit != NO_KEYWORD
+                           && vit != result)
+                        {
+                            vit = f_tree[vit].get_next();
+                        }
+                        if(vit == NO_KEYWORD)
+                        {
+                            errors() << "dns_options:error: invalid result, could not find it in the parent list of values."
+                                     << std::endl;
+                            return 1;
+                        }
+
+                        //int const remove_start(parent->field_value_start());
+                        int const remove_start(f_tree[result].get_token().get_start());
+
+                        int remove_end(remove_start);
+                        vit = f_tree[vit].get_next();
+                        if(vit == NO_KEYWORD)
+                        {
+                            // it was the last value, remove up to the end
+                            // of the parent value (spaces and ';' included)
+                            //
+                            remove_end = f_tree[parent].get_token().get_end_of_value();
+                        }
+                        else
+                        {
+                            // we have a following value, use its start point
+                            // as our end point
+                            //
+                            remove_end = f_tree[vit].get_token().get_start();
+                        }
+
+                        int const r(replace_data(remove_start, remove_end, std::string()));
+                        if(r != 0)
+                        {
+                            return r;
+                        }
+                    }
+                    break;
+
+                case token_type_t::TOKEN_GET:
+                    // print current value, so result->get_values()
+                    //
+                    if(start == -1
+                    || end == -1)
+                    {
+                        errors() << "dns_options:error: start/end parameters not properly defined to GET this value."
+                                 << std::endl;
+                        return 1;
+                    }
+
+                    f_values.push_back(f_data.substr(start, end - start));
+                    break;
+
+                default:
+                    errors() << "dns_options:fatal error: unknown command in match()."
+                             << std::endl;
+                    return 1;
+
+                }
+                return 0;
+            }
+            else if(previous_level != NO_KEYWORD)
+            {
+                switch(command)
+                {
+                case token_type_t::TOKEN_ASSIGN:
+                case token_type_t::TOKEN_CREATE:
+                    {
+                        int end(f_tree[previous_level].get_token().get_end_of_value());
+                        if(end > 0
+                        && f_data[end - 1] == ';')
+                        {
+                            --end;
+                            // TODO: skip spaces too
+                            if(end > 0
+                            && f_data[end - 1] == '}')
+                            {
+                                --end;
+                            }
+                        }
+                        int start(end);
+                        while(start > 0
+                           && f_data[start - 1] == '\n')
+                        {
+                            --start;
+                        }
+
+                        // here field is the first field that did not match,
+                        // we need its position to indent the new block
+                        //
+                        std::size_t idx(0);
+                        for(keyword_id_t f(f_tree[f_keyword].first_field()); f != field; f = f_tree[f].get_next())
+                        {
+                            ++idx;
+                        }
+                        std::string field_names;
+                        std::string end_field;
+                        for(; field != NO_KEYWORD; field = f_tree[field].get_next(), ++idx)
+                        {
+                            std::string_view const name(f_tree[field].get_token().get_word());
+
+                            // the special name "_" means that there is no
+                            // name for that field
+                            //
+                            if(name != "_")
+                            {
+                                field_names += name;
+                                for(keyword_id_t i(f_tree[field].first_index()); i != NO_KEYWORD; i = f_tree[i].get_next())
+                                {
+                                    field_names += ' ';
+                                    auto const & tok(f_tree[i].get_token());
+                                    if(tok.get_type() == token_type_t::TOKEN_STRING)
+                                    {
+                                        if(tok.get_word() == "*")
+                                        {
+                                            errors() << "dns_options:error: you cannot create or update a field using \"*\" as one of its indices."
+                                                     << std::endl;
+                                            return 1;
+                                        }
+                                        field_names += '"';
+                                        field_names += tok.get_word();
+                                        field_names += '"';
+                                    }
+                                    else
+                                    {
+                                        field_names += tok.get_word();
+                                    }
+                                }
+                                field_names += " ";
+
+                                if(f_tree[field].get_next() != NO_KEYWORD)
+                                {
+                                    field_names += "{\n\t";
+                                    for(size_t j(0); j < idx + 1; ++j)
+                                    {
+                                        field_names += '\t';
+                                        end_field += '\t';
+                                    }
+                                    end_field += "};\n";
+                                }
+                            }
+                        }
+
+                        int const replacement_start(f_tree.value_start(f_keyword));
+                        int const replacement_end(f_tree.value_end(f_keyword));
+
+                        if(start == -1
+                        || end == -1
+                        || replacement_start == -1
+                        || replacement_end == -1)
+                        {
+                            errors() << "dns_options:error: start/end parameters not properly defined to SET/CREATE this value."
+                                     << std::endl;
+                            return 1;
+                        }
+
+                        // here the added newlines and tab are quite arbitrary...
+                        //
+                        return replace_data(
+                                  start
+                                , end
+                                , "\n\t"
+                                    + field_names
+                                    + f_execute.substr(replacement_start, replacement_end - replacement_start)
+                                            + ";\n"
+                                    + end_field);
+                    }
+
+                case token_type_t::TOKEN_UPDATE:
+                case token_type_t::TOKEN_REMOVE:
+                    // these are silent ones, there is nothing to update
+                    // or remove but we do not tell anything to the user
+                    //
+                    return 0;
+
+                case token_type_t::TOKEN_GET:
+                    // error below: field not found
+                    break;
+
+                default:
+                    errors() << "dns_options:fatal error: unknown command in match()."
+                             << std::endl;
+                    return 1;
+
+                }
+            }
+
+            // if we reach here, we had a partial match
+            //
+            break;
+        }
+    }
+
+    switch(command)
+    {
+    case token_type_t::TOKEN_ASSIGN:
+    case token_type_t::TOKEN_CREATE:
+        {
+            // TODO: the following only supports one level
+            //       multiple levels require the '{' ... '}' at each level
+            //
+            std::string field_names(word);
+            std::string end_field;
+            for(keyword_id_t i(f_tree[f_keyword].first_index()); i != NO_KEYWORD; i = f_tree[i].get_next())
+            {
+                field_names += ' ';
+                auto const & tok(f_tree[i].get_token());
+                if(tok.get_type() == token_type_t::TOKEN_STRING)
+                {
+                    if(tok.get_word() == "*")
+                    {
+                        errors() << "dns_options:error: you cannot create or update a field using \"*\" as one of its indices."
+                                 << std::endl;
+                        return 1;
+                    }
+                    field_names += '"';
+                    field_names += tok.get_word();
+                    field_names += '"';
+                }
+                else
+                {
+                    field_names += tok.get_word();
+                }
+            }
+            field_names += " ";
+
+            std::size_t idx(0);
+            for(keyword_id_t field(f_tree[f_keyword].first_field()); field != NO_KEYWORD; field = f_tree[field].get_next(), ++idx)
+            {
+                std::string_view const name(f_tree[field].get_token().get_word());
+
+                // the special name "_" means that there is no
+                // name for that field
+                //
+                if(name != "_")
+                {
+                    if(f_tree[field].get_next() != NO_KEYWORD)
+                    {
+                        field_names += "{\n";
+                        for(size_t j(0); j < idx + 1; ++j)
+                        {
+                            field_names += '\t';
+                            end_field += '\t';
+                        }
+                        end_field += "};\n";
+                    }
+
+                    field_names += name;
+                    for(keyword_id_t i(f_tree[field].first_index()); i != NO_KEYWORD; i = f_tree[i].get_next())
+                    {
+                        field_names += ' ';
+                        auto const & tok(f_tree[i].get_token());
+                        if(tok.get_type() == token_type_t::TOKEN_STRING)
+                        {
+                            if(tok.get_word() == "*")
+                            {
+                                errors() << "dns_options:error: you cannot create or update a field using \"*\" as one of its indices."
+                                         << std::endl;
+                                return 1;
+                            }
+                            field_names += '"';
+                            field_names += tok.get_word();
+                            field_names += '"';
+                        }
+                        else
+                        {
+                            field_names += tok.get_word();
+                        }
+                    }
+                    field_names += " ";
+                }
+            }
+
+            int const replacement_start(f_tree.value_start(f_keyword));
+            int const replacement_end(f_tree.value_end(f_keyword));
+
+            if(replacement_start == -1
+            || replacement_end == -1)
+            {
+                errors() << "dns_options:error: start/end parameters not properly defined to SET/CREATE this value."
+                         << std::endl;
+                return 1;
+            }
+
+            // make sure we have at least one empty line after the last option
+            //
+            std::string separator;
+            std::size_t const length(f_data.length());
+            if(length >= 1
+            && f_data[length - 1] != '\n')
+            {
+                separator = "\n\n";
+            }
+            else if(length >= 2
+                 && f_data[length - 2] != '\n')
+            {
+                separator = "\n";
+            }
+
+            std::string replacement(idx, '\t');
+            replacement += f_execute.substr(replacement_start, replacement_end - replacement_start);
+
+            // here the added newlines and tab are quite arbitrary...
+            //
+            int const data_end(f_data.length());
+            return replace_data(
+                      data_end
+                    , data_end
+                    , separator
+                        + field_names
+                          + "{\n"
+                            + replacement
+                          + ";\n"
+                        + end_field
+                        + "};\n"
+                        + "\n");
+        }
+
+    default:
+        // only the ASSIGN and CREATE do miracles in this case
+        break;
+
+    }
+
+    errors() << "dns_options:error: field \""
+             << f_execute
+             << "\" was not found."
+             << std::endl;
+
+    return 1;
+}
+
+
+dns_options::keyword_id_t dns_options::match_fields(keyword_id_t & field, keyword_id_t opt, keyword_id_t & previous_level)
+{
+    if(field == NO_KEYWORD)
+    {
+        // we reached the end of the fields defined on the command line
+        //
+        return opt;
+    }
+
+    previous_level = opt;
+
+    if(f_tree[opt].first_value() == NO_KEYWORD)
+    {
+        // we reached the end of the file options, this is not a match
+        //
+        return NO_KEYWORD;
+    }
+
+    auto const & k(f_tree[field].get_token());
+    auto const   type(k.get_type());
+    auto const   word(k.get_word());
+
+    // the "_" field matches the value itself
+    //
+    std::string_view name(word);
+    if(word == "_")
+    {
+        int const replacement_start(f_tree.value_start(f_keyword));
+        int const replacement_end(f_tree.value_end(f_keyword));
+        name = std::string_view(f_execute).substr(replacement_start, replacement_end - replacement_start);
+    }
+
+    for(keyword_id_t const v : f_tree.find(opt, name, lookup_index(field)))
+    {
+        auto const & o(f_tree[v].get_token());
+
+
+        if(o.get_type() == type
+        && match_indexes(field, v))
+        {
+            if(word == "_")
+            {
+                // special case where we have to match the value, not the field
+                // name (i.e. when there is no field name within the block)
+                //
+                // in this case we do not expect indexes, although it if
+                // that's the case then match_indexes() returns true
+                //
+                if(o.get_word() == name)
+                {
+                    field = f_tree[field].get_next();
+                    return v;
+                }
+            }
+            else if(o.get_word() == word)
+            {
+                field = f_tree[field].get_next();
+                return match_fields(field, v, previous_level);
+            }
+        }
+    }
+
+    return NO_KEYWORD;
+}
+
+
+/** \brief Get the index used to search a keyword.
+ *
+ * The first index of a command line keyword is used along its name to
+ * search the values of a block. A `"*"` matches any field so in that
+ * case the search uses the name only.
+ *
+ * \param[in] kwd  The command line keyword.
+ *
+ * \return The first index of \p kwd or an empty string.
+ */
+std::string_view dns_options::lookup_index(keyword_id_t kwd) const
+{
+    keyword_id_t const i(f_tree[kwd].first_index());
+    if(i == NO_KEYWORD)
+    {
+        return std::string_view();
+    }
+
+    std::string_view const word(f_tree[i].get_token().get_word());
+    if(word == "*")
+    {
+        return std::string_view();
+    }
+
+    return word;
+}
+
+
+bool dns_options::match_indexes(keyword_id_t kwd, keyword_id_t opt)
+{
+    // WARNING: the keywords (kwd--command line) have indexes
+    //          which should match fields in object (opt--file contents)
+    //
+    keyword_id_t expected(f_tree[kwd].first_index());
+    keyword_id_t existing(f_tree[opt].first_field());
+    for(; expected != NO_KEYWORD; expected = f_tree[expected].get_next(), existing = f_tree[existing].get_next())
+    {
+        if(existing == NO_KEYWORD)
+        {
+            return false;
+        }
+
+        auto const & expected_token(f_tree[expected].get_token());
+        auto const & existing_token(f_tree[existing].get_token());
+        if(expected_token.get_type() == token_type_t::TOKEN_KEYWORD)
+        {
+            // keywords have to match one to one
+            //
+            if(existing_token.get_type() != token_type_t::TOKEN_KEYWORD)
+            {
+                return false;
+            }
+            if(expected_token.get_word() != existing_token.get_word())
+            {
+                return false;
+            }
+        }
+        else if(expected_token.get_type() == token_type_t::TOKEN_STRING)
+        {
+            if(existing_token.get_type() != token_type_t::TOKEN_KEYWORD
+            && existing_token.get_type() != token_type_t::TOKEN_STRING)
+            {
+                return false;
+            }
+            std::string_view const word(expected_token.get_word());
+            if(word != "*")
+            {
+                // words need to be a match
+                //
+                if(word != existing_token.get_word())
+                {
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+
+// vim: ts=4 sw=4 et
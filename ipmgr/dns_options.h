@@ -0,0 +1,301 @@
+// Copyright (c) 2018-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#pragma once
+
+/** \file
+ * \brief Parser and editor of the BIND configuration files.
+ *
+ * The dns_options class loads a named.conf file, applies any number of
+ * expressions to it (get, set, update, create, remove), and saves the
+ * result. The file is parsed once and saved once whatever the number
+ * of expressions.
+ *
+ * This is the engine of the dns-options tool. It is also available to
+ * ipmgr so it can edit those files without starting a process.
+ */
+
+
+// C++
+//
+#include    <cstdint>
+#include    <iostream>
+#include    <list>
+#include    <string>
+#include    <string_view>
+#include    <unordered_map>
+#include    <vector>
+
+
+
+/** \brief Edit various DNS options.
+ *
+ * This class is used to edit the BIND v9 file options.
+ *
+ * This is used to edit various parts of the options such as the
+ * version, hostname, loggin, etc.
+ *
+ * Unfortunately BIND does not give us the option to add various
+ * files in a directory with a proper order, etc. so we have to
+ * parse the whole thing and add or edit options.
+ *
+ * The usage is: define the expressions with add_expression(), load the
+ * file with load(), run the expressions with execute(), and save the
+ * result with save() if is_modified() returns true. The values found
+ * by the GET expressions are available with get_values().
+ *
+ * Errors are written to std::cerr by default. Use set_error_stream()
+ * to capture them instead.
+ */
+class dns_options
+{
+public:
+    typedef std::vector<std::string>    string_list_t;
+
+    void                set_error_stream(std::ostream & out);
+
+    bool                load(std::string const & filename);
+    bool                set_data(std::string const & data);
+    std::string const & get_data() const;
+    bool                is_modified() const;
+    bool                save();
+
+    bool                add_expression(std::string const & expression);
+    bool                execute();
+    bool                execute(std::string const & expression);
+    string_list_t const &
+                        get_values() const;
+    void                clear_values();
+
+private:
+    enum class token_type_t
+    {
+        TOKEN_UNKNOWN,              // unknown token
+
+        TOKEN_EOT,                  // end of tokens
+        TOKEN_KEYWORD,              // option names & values
+        TOKEN_STRING,               // "..."
+        TOKEN_OPEN_BLOCK,           // "{"
+        TOKEN_CLOSE_BLOCK,          // "}"
+        TOKEN_END_OF_DEFINITION,    // ";"
+
+        // extensions
+        //
+        TOKEN_OPEN_INDEX,           // "["
+        TOKEN_CLOSE_INDEX,          // "]"
+        TOKEN_FIELD,                // "."
+        TOKEN_ASSIGN,               // "="
+        TOKEN_UPDATE,               // "+="
+        TOKEN_CREATE,               // "?="
+
+        // special cases
+        //
+        TOKEN_REMOVE,               // "=" "null"
+        TOKEN_GET,                  // no "=", no value
+
+        TOKEN_ERROR                 // an error occurred
+    };
+
+    class token
+    {
+    public:
+        void            set_input(std::string const * input);
+        void            set_type(token_type_t type);
+        void            set_word(int start, int size);
+        void            set_start(int start);
+        void            set_end(int end);
+        void            set_line(int line);
+        void            set_block_level(int level);
+
+        bool            is_null() const;
+
+        token_type_t    get_type() const;
+        std::string_view
+                        get_word() const;
+        int             get_start() const;
+        int             get_end() const;
+        int             get_line() const;
+        int             get_block_level() const;
+
+        void            set_end_of_value(int end);
+        int             get_end_of_value() const;
+
+        void            shift(int offset);
+
+        std::string     to_string() const;
+
+    private:
+        std::string const *
+                        f_input = nullptr;
+        token_type_t    f_type = token_type_t::TOKEN_UNKNOWN;
+        int             f_word_start = 0;               // actual token in f_input (may be empty)
+        int             f_word_size = 0;
+        int             f_start = -1;
+        int             f_end = -1;
+        int             f_end_of_value = -1;
+        int             f_line = -1;
+        int             f_block_level = -1;
+    };
+
+    /** \brief Identifier of a keyword in the keyword tree.
+     *
+     * The keywords are allocated in one arena (see keyword_tree) and they
+     * reference each other with their index in that arena.
+     */
+    typedef std::uint32_t           keyword_id_t;
+
+    static constexpr keyword_id_t   NO_KEYWORD = static_cast<keyword_id_t>(-1);
+
+    class keyword_tree;
+
+    class keyword
+    {
+    public:
+                        keyword(token const & t);
+
+        token const &   get_token() const;
+        token &         get_token();
+
+        void            set_command(token_type_t command);
+        token_type_t    get_command() const;
+
+        keyword_id_t    get_parent() const;
+        keyword_id_t    get_next() const;
+        keyword_id_t    first_index() const;
+        keyword_id_t    first_field() const;
+        keyword_id_t    last_field() const;
+        keyword_id_t    first_value() const;
+        keyword_id_t    last_value() const;
+
+    private:
+        friend class keyword_tree;
+
+        struct list_t
+        {
+            keyword_id_t    f_first = NO_KEYWORD;
+            keyword_id_t    f_last = NO_KEYWORD;
+        };
+
+        token           f_token = token();          // keyword
+
+        keyword_id_t    f_parent = NO_KEYWORD;
+        keyword_id_t    f_next = NO_KEYWORD;        // next sibling in the parent list
+
+        list_t          f_index = list_t();         // keyword[index1][index2][...]
+        list_t          f_fields = list_t();        // keyword[index1][index2][...].field1[index1][...].field2[index1][...]...
+
+        token_type_t    f_command = token_type_t::TOKEN_GET;        // = += ?=, by default GET
+
+        list_t          f_value = list_t();         // keyword | string (if "= null" command becomes REMOVE)
+    };
+
+    /** \brief Arena holding all the keywords.
+     *
+     * The keywords are never freed one by one. The whole tree is released
+     * at once when the arena gets destroyed. The children of a keyword are
+     * linked lists of identifiers so a keyword does not allocate anything.
+     *
+     * The values of a block can also be searched by name with find(). The
+     * lookup table of a block is created the first time it gets searched.
+     */
+    class keyword_tree
+    {
+    public:
+        typedef std::vector<keyword_id_t>   candidates_t;
+
+        void            reserve(std::size_t size);
+        keyword_id_t    create(token const & t);
+
+        keyword &       operator [] (keyword_id_t id);
+        keyword const & operator [] (keyword_id_t id) const;
+
+        void            add_index(keyword_id_t k, keyword_id_t index);
+        void            add_field(keyword_id_t k, keyword_id_t field);
+        void            add_value(keyword_id_t k, keyword_id_t value);
+        void            replace_values(keyword_id_t k, keyword_id_t previous, keyword_id_t next, keyword_id_t values);
+        void            unindex_values(keyword_id_t k, keyword_id_t previous, keyword_id_t next);
+        void            shift(keyword_id_t k, int offset);
+
+        int             value_start(keyword_id_t k) const;
+        int             value_end(keyword_id_t k) const;
+        int             field_value_start(keyword_id_t k) const;
+        int             field_value_end(keyword_id_t k) const;
+
+        candidates_t const &
+                        find(keyword_id_t k, std::string_view name, std::string_view index);
+
+        std::string     to_string(keyword_id_t k) const;
+
+    private:
+        typedef std::unordered_map<std::size_t, candidates_t>   lookup_t;
+
+        void            append(keyword_id_t k, keyword::list_t keyword::*list, keyword_id_t child);
+        void            add_lookup(lookup_t & lookup, keyword_id_t v);
+        void            remove_lookup(lookup_t & lookup, std::size_t hash, keyword_id_t v);
+        static std::size_t
+                        lookup_hash(std::string_view name, std::string_view index);
+
+        std::vector<keyword>
+                        f_keywords = std::vector<keyword>();
+        std::unordered_map<keyword_id_t, lookup_t>
+                        f_lookup = std::unordered_map<keyword_id_t, lookup_t>();
+    };
+
+    struct expression_t
+    {
+        std::string         f_execute = std::string();
+        keyword_id_t        f_keyword = NO_KEYWORD;
+    };
+    typedef std::list<expression_t>     expression_list_t;
+
+    std::ostream &      errors();
+    void                set_input(std::string const & input, int pos = 0, int line = 1);
+    void                count_lines(int start, int end);
+    token               get_token(bool extensions = false);
+
+    int                 parse_command_line(std::string const & execute);
+    int                 edit_option();
+    int                 parse_options(keyword_id_t in, int end);
+    int                 recursive_option(keyword_id_t in);
+    int                 replace_data(int start, int end, std::string const & replacement);
+    int                 match();
+    keyword_id_t        match_fields(keyword_id_t & field, keyword_id_t opt, keyword_id_t & previous_level);
+    bool                match_indexes(keyword_id_t kwd, keyword_id_t opt);
+    std::string_view    lookup_index(keyword_id_t kwd) const;
+
+    std::ostream *      f_errors = &std::cerr;
+    std::string         f_filename = std::string();
+    std::string         f_execute = std::string();
+    expression_list_t   f_expressions = expression_list_t();
+    string_list_t       f_values = string_list_t();
+    std::string         f_data = std::string();
+    bool                f_modified = false;
+    std::string const * f_input = nullptr;
+    int                 f_pos = 0;
+    int                 f_line = 1;
+    token               f_token = token();
+    int                 f_block_level = 0;
+    keyword_tree        f_tree = keyword_tree();
+    keyword_id_t        f_keyword = NO_KEYWORD;
+    keyword_id_t        f_options = NO_KEYWORD;
+};
+
+
+
+// vim: ts=4 sw=4 et
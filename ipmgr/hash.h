@@ -0,0 +1,87 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+/** \file
+ * \brief A fast non-cryptographic hash.
+ *
+ * The ipmgr tool uses this hash to detect changes in its input and output
+ * files without having to compare their entire contents. It is not
+ * expected to resist attacks; only a local administrator can modify
+ * those files anyway.
+ */
+
+
+// C++
+//
+#include    <cstdint>
+#include    <string>
+
+
+
+constexpr std::uint64_t     FNV1A_64_OFFSET_BASIS = 14695981039346656037ULL;
+constexpr std::uint64_t     FNV1A_64_PRIME = 1099511628211ULL;
+
+
+/** \brief Compute the FNV-1a 64 bit hash of a buffer.
+ *
+ * The \p hash parameter can be used to chain calls and compute the hash
+ * of several buffers as if they were one.
+ *
+ * \param[in] data  The buffer to hash.
+ * \param[in] size  The size of the buffer in bytes.
+ * \param[in] hash  The initial hash value.
+ *
+ * \return The updated hash.
+ */
+inline std::uint64_t fnv1a_64(
+      void const * data
+    , std::size_t size
+    , std::uint64_t hash = FNV1A_64_OFFSET_BASIS)
+{
+    std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(data));
+    for(std::uint8_t const * e(s + size); s < e; ++s)
+    {
+        hash ^= *s;
+        hash *= FNV1A_64_PRIME;
+    }
+    return hash;
+}
+
+
+/** \brief Compute the FNV-1a 64 bit hash of a string.
+ *
+ * The hash includes the string terminator so two consecutive strings
+ * such as "ab" + "c" and "a" + "bc" do not give the same hash.
+ *
+ * \param[in] s  The string to hash.
+ * \param[in] hash  The initial hash value.
+ *
+ * \return The updated hash.
+ */
+inline std::uint64_t fnv1a_64(
+      std::string const & s
+    , std::uint64_t hash = FNV1A_64_OFFSET_BASIS)
+{
+    return fnv1a_64(s.c_str(), s.length() + 1, hash);
+}
+
+
+
+// vim: ts=4 sw=4 et
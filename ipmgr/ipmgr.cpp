@@ -45,7 +45,16 @@
 //
 #include    "ipmgr.h"
 #include    "exception.h"
+#include    "dkim_key.h"
+#include    "hash.h"
+#include    "opendkim_table.h"
+#include    "process_runner.h"
+#include    "serial_strategy.h"
+#include    "soa_scanner.h"
 #include    "version.h"
+#include    "zone_diff.h"
+#include    "zone_records.h"
+#include    "zone_watcher.h"
 
 
 // advgetopt
@@ -64,10 +73,11 @@
 #include    <libtld/tld.h>
 
 
-// cppprocess
+// cppthread
 //
-#include    <cppprocess/io_capture_pipe.h>
-#include    <cppprocess/process.h>
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+#include    <cppthread/thread.h>
 
 
 // snaplogger
@@ -78,20 +88,29 @@
 
 // snapdev
 //
-#include    <snapdev/chownnm.h>
 #include    <snapdev/pathinfo.h>
 #include    <snapdev/file_contents.h>
+#include    <snapdev/glob_to_list.h>
 #include    <snapdev/stringize.h>
 #include    <snapdev/trim_string.h>
 
 
 // C++
 //
+#include    <algorithm>
+#include    <chrono>
 #include    <iostream>
 #include    <fstream>
+#include    <list>
 #include    <set>
 
 
+// C
+//
+#include    <fcntl.h>
+#include    <unistd.h>
+
+
 // snapdev
 //
 #include    <snapdev/poison.h>
@@ -128,6 +147,28 @@ advgetopt::option const g_ipmgr_options[] =
 {
     // OPTIONS
     //
+    advgetopt::define_option(
+          advgetopt::Name("copy-mode")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("reflink")
+        , advgetopt::Help("How the bind9 copy of a static zone gets created from the generated copy: \"write\", \"reflink\", or \"link\".")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("daemon")
+        , advgetopt::Flags(advgetopt::standalone_all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+        , advgetopt::Help("Run as a daemon, regenerating the zones each time a zone configuration file changes.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("debounce")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("500")
+        , advgetopt::Help("Number of milliseconds to wait for more changes before processing the zones in --daemon mode.")
+    ),
     advgetopt::define_option(
           advgetopt::Name("default-expire")
         , advgetopt::Flags(advgetopt::all_flags<
@@ -190,6 +231,15 @@ advgetopt::option const g_ipmgr_options[] =
         , advgetopt::DefaultValue("3m")
         , advgetopt::Help("Define the retry rate in case the main server does not reply to your secondary servers.")
     ),
+    advgetopt::define_option(
+          advgetopt::Name("default-serial-strategy")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED
+                    , advgetopt::GETOPT_FLAG_PROCESS_VARIABLES>())
+        , advgetopt::DefaultValue("counter")
+        , advgetopt::Help("Define how the next serial number of a zone is computed: \"counter\", \"date\" (YYYYMMDDnn), or \"unixtime\".")
+    ),
     advgetopt::define_option(
           advgetopt::Name("default-ttl")
         , advgetopt::Flags(advgetopt::all_flags<
@@ -229,6 +279,43 @@ advgetopt::option const g_ipmgr_options[] =
                       advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
         , advgetopt::Help("Force updates even if the files did not change.")
     ),
+    advgetopt::define_option(
+          advgetopt::Name("jobs")
+        , advgetopt::ShortName('j')
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("1")
+        , advgetopt::Help("Number of zones to generate in parallel; use 0 to use one job per available processor.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("live-serial")
+        , advgetopt::Flags(advgetopt::standalone_all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+        , advgetopt::Help("Ask bind9 for the serial number of dynamic zones (`rndc zonestatus`) instead of reading it from the zone files.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("opendkim-key-bits")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("2048")
+        , advgetopt::Help("Size in bits of the new OpenDKIM RSA keys.")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("opendkim-key-type")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::DefaultValue("rsa")
+        , advgetopt::Help("Type of the new OpenDKIM keys: \"rsa\" or \"ed25519\".")
+    ),
+    advgetopt::define_option(
+          advgetopt::Name("paranoid")
+        , advgetopt::Flags(advgetopt::standalone_all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
+        , advgetopt::Help("Read the previously generated zones to detect changes instead of trusting the index of the last run.")
+    ),
     advgetopt::define_option(
           advgetopt::Name("quiet")
         , advgetopt::ShortName('q')
@@ -236,6 +323,13 @@ advgetopt::option const g_ipmgr_options[] =
                       advgetopt::GETOPT_FLAG_GROUP_OPTIONS>())
         , advgetopt::Help("Cancel the `--verbose` flags.")
     ),
+    advgetopt::define_option(
+          advgetopt::Name("root-dir")
+        , advgetopt::Flags(advgetopt::all_flags<
+                      advgetopt::GETOPT_FLAG_GROUP_OPTIONS
+                    , advgetopt::GETOPT_FLAG_REQUIRED>())
+        , advgetopt::Help("Read and write all the files under this directory instead of the system root; the services are not restarted in this mode.")
+    ),
     advgetopt::define_option(
           advgetopt::Name("config-warnings")
         , advgetopt::Flags(advgetopt::all_flags<
@@ -329,11 +423,137 @@ advgetopt::options_environment const g_iplock_options_environment =
 
 
 
+/** \brief Options included in the fingerprint of all the zones.
+ *
+ * When one of these options changes, all the zones need to be
+ * regenerated. If you add a new option used by the zone_files class,
+ * make sure to add it here too.
+ */
+char const * const g_fingerprint_options[] =
+{
+    "default-expire",
+    "default-group",
+    "default-hostmaster",
+    "default-ips",
+    "default-minimum-cache-failures",
+    "default-nameservers",
+    "default-refresh",
+    "default-retry",
+    "default-serial-strategy",
+    "default-ttl",
+    nullptr
+};
+
+
+
+
+/** \brief Retrieve the serial number of a zone we generated.
+ *
+ * This function searches the SOA of a zone file generated by ipmgr
+ * and returns its serial number. It is used to regenerate the header
+ * of the previous version of the file so we can compare the bodies
+ * without having to parse the file any further.
+ *
+ * \param[in] zone  The contents of a zone file generated by ipmgr.
+ *
+ * \return The serial number or 0 if it could not be found.
+ */
+std::uint32_t get_generated_serial(std::string const & zone)
+{
+    std::string::size_type pos(zone.find(" SOA "));
+    if(pos == std::string::npos)
+    {
+        return 0;
+    }
+    pos = zone.find('(', pos);
+    if(pos == std::string::npos)
+    {
+        return 0;
+    }
+
+    std::uint64_t serial(0);
+    for(++pos; pos < zone.length() && zone[pos] >= '0' && zone[pos] <= '9'; ++pos)
+    {
+        serial = serial * 10 + zone[pos] - '0';
+        if(serial > 0xFFFFFFFF)
+        {
+            return 0;
+        }
+    }
+
+    return serial;
+}
+
+
+/** \brief Create the index entry of a generated file.
+ *
+ * \param[in] contents  The contents of the generated file.
+ * \param[in] serial  The serial number saved in its SOA.
+ *
+ * \return The index entry of that file.
+ */
+zone_cache::output_entry make_output_entry(std::string const & contents, std::uint32_t serial)
+{
+    zone_cache::output_entry entry;
+    entry.f_size = contents.length();
+    entry.f_hash = fnv1a_64(contents.data(), contents.length());
+    entry.f_serial = serial;
+    return entry;
+}
+
+
+/** \brief Check whether a generated file changed using its index entry.
+ *
+ * The \p header must be generated with the serial number of the index
+ * entry. The hash is computed on the header and body without
+ * concatenating them.
+ *
+ * \param[in] entry  The index entry of the previous version of the file.
+ * \param[in] header  The header generated with the previous serial.
+ * \param[in] body  The new body.
+ *
+ * \return true if the file would not change.
+ */
+bool output_unchanged(
+      zone_cache::output_entry const & entry
+    , std::string const & header
+    , std::string const & body)
+{
+    if(entry.f_size != header.length() + body.length())
+    {
+        return false;
+    }
+    std::uint64_t const hash(fnv1a_64(header.data(), header.length()));
+    return fnv1a_64(body.data(), body.length(), hash) == entry.f_hash;
+}
 
-char const * const g_bind9_need_restart = "/run/ipmgr/bind9-need-restart";
-char const * const g_opendkim_need_restart = "/run/ipmgr/opendkim-need-restart";
-char const * const g_opendmarc_need_restart = "/run/ipmgr/opendmarc-need-restart";
 
+/** \brief Check that the files written by the last run are still in place.
+ *
+ * The index entry only describes what the last run wrote. If one of
+ * those files was deleted or edited since, the index cannot be trusted
+ * and the file has to be written again.
+ *
+ * \param[in] entry  The index entry of the generated file.
+ * \param[in] filenames  The generated file and its exact copies.
+ *
+ * \return true if all the files exist and have the size of the entry.
+ */
+bool output_files_intact(
+      zone_cache::output_entry const & entry
+    , advgetopt::string_list_t const & filenames)
+{
+    for(auto const & f : filenames)
+    {
+        struct stat st = {};
+        if(stat(f.c_str(), &st) != 0
+        || static_cast<std::uint64_t>(st.st_size) != entry.f_size)
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
 
 bool validate_domain(std::string const & domain)
@@ -372,30 +592,100 @@ bool validate_domain(std::string const & domain)
 }
 
 
-/** \brief Validate a list of IPs using the libaddr library.
+/** \brief Get the IP address parser.
  *
- * This function goes through a list of IPs to verify that they are
- * all either IPv4 or IPv6. If all the IPs are valid, then the function
- * returns true.
+ * The parser is setup once per thread (zones may be generated by
+ * multiple threads, see `--jobs`) and reused for all the IP addresses.
  *
- * This function is expected to be called only when numeric IP addresses
- * are expected. It supports a mix of IPv4 and IPv6 without issue.
- * Since we are setting up a domain name IP address, allowing an
+ * Since we are setting up a domain name IP address, allowing a
  * named domain name wouldn't work (i.e. we would have to query ourselves).
  *
+ * \return The IP address parser of this thread.
+ */
+addr::addr_parser & get_ip_parser()
+{
+    thread_local addr::addr_parser parser;
+    thread_local bool initialized(false);
+    if(!initialized)
+    {
+        parser.set_allow(addr::allow_t::ALLOW_ADDRESS, true);
+        parser.set_allow(addr::allow_t::ALLOW_REQUIRED_ADDRESS, true);
+        parser.set_allow(addr::allow_t::ALLOW_ADDRESS_LOOKUP, false);
+        parser.set_allow(addr::allow_t::ALLOW_PORT, false);
+        initialized = true;
+    }
+    parser.clear_errors();
+    return parser;
+}
+
+
+/** \brief Parse one IP address.
+ *
+ * The IP must be a numeric IPv4 or IPv6 address. IPv6 addresses may be
+ * written with or without square brackets. Ports are not supported.
+ *
+ * \param[in] ip  The IP address to parse.
+ * \param[out] address  The resulting binary address.
+ *
+ * \return true if the IP address is valid.
+ */
+bool parse_ip(std::string const & ip, addr::addr & address)
+{
+    // transform the IP to the IPv6 syntax supported by the addr parser
+    // if it looks like it includes colons (i.e. we do not support ports)
+    //
+    std::string in(ip);
+    if(in[0] != '['
+    && in.find(':') != std::string::npos)
+    {
+        in = '[' + in;
+        if(in.back() != ']')
+        {
+            in += ']';
+        }
+    }
+
+    addr::addr_parser & parser(get_ip_parser());
+    addr::addr_range::vector_t const r(parser.parse(in));
+    if(parser.has_errors()
+    || r.empty()
+    || !r[0].has_from())
+    {
+        SNAP_LOG_ERROR
+            << "could not parse IP address \""
+            << ip
+            << "\" (\""
+            << in
+            << "\"); please verify that it is a valid IPv4 or IPv6 numeric address; error: "
+            << parser.error_messages()
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    address = r[0].get_from();
+    return true;
+}
+
+
+/** \brief Parse a list of IP addresses.
+ *
+ * This function parses each IP address of the list once and saves the
+ * binary addresses in \p addresses. The zone generation then uses these
+ * addresses as is.
+ *
  * \warning
  * An empty list of IPs is considered valid by this function.
  *
  * \param[in] ip_list  A list of IP addresses.
+ * \param[out] addresses  The list where the parsed addresses get added.
  *
- * \return true if the list of IPs is considered valid.
+ * \return true if all the IPs are valid.
  */
-bool validate_ips(advgetopt::string_list_t & ip_list)
+bool parse_ips(advgetopt::string_list_t const & ip_list, addr::addr::vector_t & addresses)
 {
-    std::size_t const max(ip_list.size());
-    for(std::size_t idx(0); idx < max; ++idx)
+    addresses.reserve(addresses.size() + ip_list.size());
+    for(auto const & ip : ip_list)
     {
-        std::string ip(ip_list[idx]);
         if(ip.empty())
         {
             // I don't think this can happen
@@ -403,38 +693,12 @@ bool validate_ips(advgetopt::string_list_t & ip_list)
             continue;
         }
 
-        // transform the IP to the IPv6 syntax supported by the addr parser
-        // if it looks like it includes colons (i.e. we do not support ports)
-        //
-        if(ip[0] != '['
-        && ip.find(':') != std::string::npos)
-        {
-            ip = '[' + ip;
-            if(ip.back() != ']')
-            {
-                ip += ']';
-            }
-            ip_list[idx] = ip;
-        }
-
-        addr::addr_parser parser;
-        parser.set_allow(addr::allow_t::ALLOW_ADDRESS, true);
-        parser.set_allow(addr::allow_t::ALLOW_REQUIRED_ADDRESS, true);
-        parser.set_allow(addr::allow_t::ALLOW_ADDRESS_LOOKUP, false);
-        parser.set_allow(addr::allow_t::ALLOW_PORT, false);
-        snapdev::NOT_USED(parser.parse(ip));
-        if(parser.has_errors())
+        addr::addr a;
+        if(!parse_ip(ip, a))
         {
-            SNAP_LOG_ERROR
-                << "could not parse IP address \""
-                << ip_list[idx]
-                << "\" (\""
-                << ip
-                << "\"); please verify that it is a valid IPv4 or IPv6 numeric address; error: "
-                << parser.error_messages()
-                << SNAP_LOG_SEND;
             return false;
         }
+        addresses.push_back(a);
     }
 
     return true;
@@ -448,17 +712,166 @@ bool validate_ips(advgetopt::string_list_t & ip_list)
 
 
 
-ipmgr::zone_files::zone_files(advgetopt::getopt::pointer_t opt, bool verbose)
+/** \brief Canonicalize the name of a zone parameter.
+ *
+ * The advgetopt library accepts underscores and dashes in the names of
+ * parameters and views them as equivalent. The flattened map of zone
+ * parameters uses dashes.
+ *
+ * \param[in] name  The name to canonicalize.
+ *
+ * \return The name with all the underscores replaced by dashes.
+ */
+std::string ipmgr::zone_files::parameter_name(std::string name)
+{
+    std::replace(name.begin(), name.end(), '_', '-');
+    return name;
+}
+
+
+ipmgr::zone_files::zone_files(
+          advgetopt::getopt::pointer_t opt
+        , paths const & p
+        , serial_store::pointer_t serials
+        , bool verbose)
     : f_opt(opt)
+    , f_paths(p)
+    , f_serials(serials)
     , f_dry_run(f_opt->is_defined("dry-run"))
+    , f_live_serial(f_opt->is_defined("live-serial"))
     , f_verbose(verbose)
+    , f_opendkim_key_bits(f_opt->get_long("opendkim-key-bits"))
+    , f_fingerprint(FNV1A_64_OFFSET_BASIS)
+{
+    // ipmgr::ipmgr() reports invalid key types
+    //
+    snapdev::NOT_USED(string_to_dkim_key_type(f_opt->get_string("opendkim-key-type"), f_opendkim_key_type));
+}
+
+
+/** \brief Add a configuration file to this zone.
+ *
+ * The file is not parsed at this point. The load_configs() function
+ * does that once we know that the zone needs to be regenerated.
+ *
+ * \param[in] filename  The name of the configuration file.
+ * \param[in] hash  The hash of the contents of that file.
+ */
+void ipmgr::zone_files::add(std::string const & filename, std::uint64_t hash)
+{
+    f_filenames.push_back(filename);
+
+    f_fingerprint = fnv1a_64(filename, f_fingerprint);
+    f_fingerprint = fnv1a_64(&hash, sizeof(hash), f_fingerprint);
+}
+
+
+/** \brief Get the fingerprint of the configuration files of this zone.
+ *
+ * The fingerprint is a hash of the filenames and contents of all the
+ * configuration files added to this zone, in order.
+ *
+ * \return The fingerprint of this zone's configuration files.
+ */
+std::uint64_t ipmgr::zone_files::fingerprint() const
+{
+    return f_fingerprint;
+}
+
+
+/** \brief Parse the configuration files of this zone.
+ *
+ * The advgetopt library caches the configuration files so the files
+ * that were parsed by ipmgr::read_zones() do not get parsed again.
+ *
+ * The parameters of all the files get merged in one flattened map. Since
+ * the files are processed in order, a parameter defined in a later file
+ * overrides the same parameter found in an earlier file. This way the
+ * get_zone_param() function does not have to search the files.
+ *
+ * \return true if all the files were loaded.
+ */
+bool ipmgr::zone_files::load_configs()
+{
+    if(!f_configs.empty())
+    {
+        return true;
+    }
+
+    for(auto const & filename : f_filenames)
+    {
+        advgetopt::conf_file_setup zone_setup(filename);
+        advgetopt::conf_file::pointer_t zone_file(advgetopt::conf_file::get_conf_file(zone_setup));
+        if(zone_file == nullptr)
+        {
+            SNAP_LOG_ERROR
+                << "could not load zone configuration file \""
+                << filename
+                << "\"."
+                << SNAP_LOG_SEND;
+            return false;
+        }
+        zone_file->set_variables(f_opt->get_variables());
+        f_configs.push_back(zone_file);
+
+        // get_parameter() is used to get the value since it applies the
+        // variables
+        //
+        advgetopt::conf_file::parameters_t const parameters(zone_file->get_parameters());
+        f_parameters.reserve(f_parameters.size() + parameters.size());
+        for(auto const & p : parameters)
+        {
+            f_parameters[parameter_name(p.first)] = zone_file->get_parameter(p.first);
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Restore the zone fields from the cache.
+ *
+ * When the fingerprint of a zone did not change since the last run, the
+ * zone is not regenerated. Instead, this function restores the fields
+ * necessary to generate the .conf files and the OpenDMARC settings.
+ *
+ * \param[in] domain  The domain name of this zone.
+ * \param[in] entry  The cache entry saved by the last run.
+ */
+void ipmgr::zone_files::restore(std::string const & domain, zone_cache::zone_entry const & entry)
 {
+    f_domain = domain;
+    f_group = entry.f_group;
+    f_dynamic = static_cast<dynamic_t>(entry.f_dynamic);
+    f_auth_server = entry.f_auth_server;
+    f_ptr = entry.f_ptr;
+    f_mail_subdomains.clear();
+    if(!entry.f_mail_subdomain.empty())
+    {
+        f_mail_subdomains.push_back(entry.f_mail_subdomain);
+    }
 }
 
 
-void ipmgr::zone_files::add(advgetopt::conf_file::pointer_t zone)
+/** \brief Get the fields to save in the cache.
+ *
+ * This function is the counterpart of restore(). The fingerprint is
+ * not defined by this function.
+ *
+ * \return The cache entry representing this zone.
+ */
+zone_cache::zone_entry ipmgr::zone_files::get_cache_entry() const
 {
-    f_configs.push_back(zone);
+    zone_cache::zone_entry entry;
+    entry.f_group = f_group;
+    entry.f_dynamic = static_cast<int>(f_dynamic);
+    entry.f_auth_server = f_auth_server;
+    entry.f_ptr = f_ptr;
+    if(!f_mail_subdomains.empty())
+    {
+        entry.f_mail_subdomain = f_mail_subdomains[0];
+    }
+    return entry;
 }
 
 
@@ -467,18 +880,15 @@ std::string ipmgr::zone_files::get_zone_param(
         , std::string const & default_name
         , std::string const & default_value) const
 {
-    // we have to go in reverse and this is a vector so we simply use the
-    // index going backward
+    // the names in the flattened map use dashes; avoid a copy when the
+    // name does not include any underscore (the most common case)
     //
-    std::size_t idx(f_configs.size());
-    while(idx > 0)
+    auto const it(name.find('_') == std::string::npos
+                    ? f_parameters.find(name)
+                    : f_parameters.find(parameter_name(name)));
+    if(it != f_parameters.end())
     {
-        --idx;
-
-        if(f_configs[idx]->has_parameter(name))
-        {
-            return f_configs[idx]->get_parameter(name);
-        }
+        return it->second;
     }
 
     if(!default_name.empty())
@@ -646,19 +1056,20 @@ std::string ipmgr::zone_files::get_zone_email(
  * dynamic, it reads the serial number from the SOA definition. This is
  * important since another tool may increase that number under our feet
  * (i.e. letsencrypt). For static zones, it reads the serial number from
- * a counter file.
- *
- * The counter files are saved under:
+ * the serial store:
  *
  * \code
- *     /var/lib/ipmgr/serial/\<domain-name>.counter
+ *     /var/lib/ipmgr/serial.db
  * \endcode
  *
- * Note that even when dynamic zones are used, a counter file is created.
- * This file is used in case the zone somehow disappears.
+ * Note that even when dynamic zones are used, the serial number is saved
+ * in the store. It is used in case the zone somehow disappears.
  *
- * \todo
- * Avoid hard coded path to serial counters and zone files to read the SOA.
+ * The store is only synced once all the zones were generated (see
+ * ipmgr::commit_output()).
+ *
+ * The next serial number depends on the `serial_strategy` of the zone:
+ * a counter, the date (YYYYMMDDnn), or the Unix time. See next_serial().
  *
  * \param[in] next  Retrieve the next counter (i.e. if the current counter
  * is 5, then the function returns 6).
@@ -679,12 +1090,10 @@ std::uint32_t ipmgr::zone_files::get_zone_serial(bool next)
     }
 #endif
 
-    // zones make use of the serial number found in our serial cache
+    // zones make use of the serial number found in our serial store
     // note, however, that we make use of the serial from the SOA
     // when updating a dynamic file
     //
-    std::string const path("/var/lib/ipmgr/serial/" + f_domain + ".counter");
-
     if(f_dynamic != dynamic_t::DYNAMIC_STATIC)
     {
         // this is a dynamic zone and each update to the zone imply an
@@ -692,82 +1101,16 @@ std::uint32_t ipmgr::zone_files::get_zone_serial(bool next)
         // that number "by hand" to make sure we are up to date when
         // regenerating the files
         //
-        serial = 0;
-        std::string const dynamic_filename("/var/lib/bind/" + f_domain + ".zone");
-        std::ifstream in(dynamic_filename);
-        std::string line;
-        bool found(false);
-        while(std::getline(in, line))
-        {
-            std::string ln(snapdev::trim_string(line));
-            bool quoted(false);
-            std::size_t len(ln.size());
-            for(std::size_t i(0); i < len; ++i)
-            {
-                // TBD: do string support backslashes for escaping?
-                //
-                if(ln[i] == '"')
-                {
-                    quoted = !quoted;
-                }
-                else if(!quoted
-                     && ln[i] == ';')
-                {
-                    ln = ln.substr(0, i);
-                    break;
-                }
-            }
-
-            if(!found)
-            {
-                advgetopt::string_list_t tokens;
-                advgetopt::split_string(
-                          ln
-                        , tokens
-                        , {" ", "\t"});
-                if(tokens.size() >= 3
-                && tokens[2] == "SOA")
-                {
-                    found = true;
-
-                    // we found the SOA entry now we need to search for the
-                    // parenthesis and then read the first number; the
-                    // parenthesis is expected on the same line, but the
-                    // number can be further down
-                    //
-                    std::string::size_type const n(ln.find('('));
-                    if(n != std::string::npos)
-                    {
-                        ln = ln.substr(n + 1);
-                    }
-                }
-            }
-
-            if(found
-            && !ln.empty())
+        // with `--live-serial`, first ask bind9 which avoids reading
+        // the zone file at all
+        //
+        serial = get_live_serial();
+        if(serial == 0)
+        {
+            soa_scanner scanner;
+            if(scanner.load(f_paths.resolve(paths::BIND_DYNAMIC_ZONES) + '/' + f_domain + ".zone"))
             {
-                // ln must include that number, it may be followed by
-                // another number, though
-                //
-                advgetopt::string_list_t tokens;
-                advgetopt::split_string(
-                          ln
-                        , tokens
-                        , {" ", "\t"});
-                if(tokens.size() > 0)
-                {
-                    std::int64_t s(0);
-                    if(advgetopt::validator_integer::convert_string(tokens[0], s))
-                    {
-                        if(s > 0
-                        && s < 65536)
-                        {
-                            serial = s;
-                        }
-                    }
-                }
-
-                break;
+                serial = scanner.serial();
             }
         }
     }
@@ -778,47 +1121,22 @@ std::uint32_t ipmgr::zone_files::get_zone_serial(bool next)
     if(f_dynamic == dynamic_t::DYNAMIC_STATIC
     || serial == 0)
     {
-        struct stat s = {};
-        if(stat(path.c_str(), &s) != 0
-        || s.st_size != sizeof(uint32_t))
+        std::uint32_t saved(0);
+        if(!f_serials->get(f_domain, saved))
         {
-            if(!next)
+            // a new zone: do not save anything yet, the first
+            // generation of the zone saves its first serial number
+            // (it used to save 1 here and the first zone got 2)
+            //
+            if(!next
+            && serial == 0)
             {
-                if(serial == 0)
-                {
-                    serial = 1;
-                }
-                std::ofstream out(path);
-                out.write(reinterpret_cast<char *>(&serial), sizeof(std::uint32_t));
-                if(!out.good())
-                {
-                    SNAP_LOG_ERROR
-                        << "could not create new serial number file \""
-                        << path
-                        << "\" for zone of \""
-                        << f_domain
-                        << "\" domain."
-                        << SNAP_LOG_SEND;
-                    return 0;
-                }
+                serial = 1;
             }
         }
         else
         {
-            std::ifstream in(path);
-            in.read(reinterpret_cast<char *>(&serial), sizeof(std::uint32_t));
-            if(!in.good())
-            {
-                SNAP_LOG_ERROR
-                    << "could not read serial number from file \""
-                    << path
-                    << "\" for zone of \""
-                    << f_domain
-                    << "\" static domain."
-                    << SNAP_LOG_SEND;
-                return 0;
-            }
-
+            serial = saved;
             if(serial == 0)
             {
                 if(f_dynamic == dynamic_t::DYNAMIC_STATIC)
@@ -826,7 +1144,7 @@ std::uint32_t ipmgr::zone_files::get_zone_serial(bool next)
                     SNAP_LOG_RECOVERABLE_ERROR
                         << "serial for \""
                         << f_domain
-                        << "\" could not be read from our serial counter file."
+                        << "\" could not be read from our serial store."
                         << SNAP_LOG_SEND;
                 }
                 else
@@ -847,20 +1165,12 @@ std::uint32_t ipmgr::zone_files::get_zone_serial(bool next)
 
     if(next)
     {
-        ++serial;
-        if(serial == 0)
-        {
-            serial = 1;
-        }
+        serial = next_serial(f_serial_strategy, serial, time(nullptr));
 
-        std::ofstream out(path);
-        out.write(reinterpret_cast<char *>(&serial), sizeof(std::uint32_t));
-        if(!out.good())
+        if(!f_serials->set(f_domain, serial))
         {
             SNAP_LOG_ERROR
-                << "could not write serial number to file \""
-                << path
-                << "\" for zone of \""
+                << "could not save serial number for zone of \""
                 << f_domain
                 << "\" domain."
                 << SNAP_LOG_SEND;
@@ -874,6 +1184,159 @@ std::uint32_t ipmgr::zone_files::get_zone_serial(bool next)
 }
 
 
+/** \brief Ask bind9 for the serial number of a dynamic zone.
+ *
+ * When the `--live-serial` command line option is used, this function
+ * runs `rndc zonestatus \<domain>` and returns the serial number of the
+ * zone as currently loaded by bind9. This is the number bind9 increments
+ * on each dynamic update so it is always up to date, even if the journal
+ * was not yet synced to the zone file.
+ *
+ * \return The live serial number or 0 if it is not available.
+ */
+std::uint32_t ipmgr::zone_files::get_live_serial() const
+{
+    if(!f_live_serial
+    || f_paths.relocated())
+    {
+        return 0;
+    }
+
+    process_runner zonestatus("rndc", { "zonestatus", f_domain });
+    if(f_verbose)
+    {
+        std::cout
+            << "info: "
+            << zonestatus.get_command_line()
+            << std::endl;
+    }
+
+    if(zonestatus.run() != 0)
+    {
+        // the zone may not be loaded yet, fall back to the zone file
+        //
+        return 0;
+    }
+
+    soa_scanner scanner;
+    if(!scanner.parse_zonestatus(zonestatus.output()))
+    {
+        return 0;
+    }
+
+    return scanner.serial();
+}
+
+
+/** \brief Check whether a new OpenDKIM key was generated.
+ *
+ * When generate_zone_body() creates a new OpenDKIM key for this zone,
+ * this function returns true. The key needs to be added to the OpenDKIM
+ * key and signing tables.
+ *
+ * \return true if the last generate_zone_body() created a new key.
+ */
+bool ipmgr::zone_files::new_opendkim_key() const
+{
+    return f_new_opendkim_key;
+}
+
+
+/** \brief Generate the OpenDKIM key of this zone.
+ *
+ * The key is generated in process (see dkim_key). Since each zone has
+ * its own key directory, the keys of several zones can be generated in
+ * parallel by the zone workers (see `--jobs`).
+ *
+ * The files are the same as the ones `opendkim-genkey` creates: the
+ * private key in `mail.private` and the DNS record in `mail.txt`. The
+ * `mail.txt` file is created last since its presence means that the
+ * key exists.
+ *
+ * \param[in] path  The directory where the key files are saved.
+ *
+ * \return true if the key was generated (or in a dry run).
+ */
+bool ipmgr::zone_files::generate_opendkim_key(std::string const & path)
+{
+    if(f_verbose)
+    {
+        std::cout
+            << "info: generating OpenDKIM key for \""
+            << f_domain
+            << "\" in \""
+            << path
+            << "\"."
+            << std::endl;
+    }
+    if(f_dry_run)
+    {
+        return true;
+    }
+
+    dkim_key key;
+    if(!key.generate(f_opendkim_key_type, static_cast<int>(f_opendkim_key_bits)))
+    {
+        SNAP_LOG_FATAL
+            << "could not generate an OpenDKIM key for \""
+            << f_domain
+            << "\": "
+            << key.last_error()
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    // the private key must only be readable by its owner
+    //
+    std::string const private_filename(path + "/mail.private");
+    snapdev::NOT_USED(unlink(private_filename.c_str()));
+    int const fd(open(private_filename.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600));
+    if(fd < 0)
+    {
+        SNAP_LOG_FATAL
+            << "could not create \""
+            << private_filename
+            << "\" for \""
+            << f_domain
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+    std::string const & pem(key.private_key());
+    ssize_t const size(write(fd, pem.c_str(), pem.length()));
+    bool const synced(fsync(fd) == 0);
+    close(fd);
+    if(size != static_cast<ssize_t>(pem.length())
+    || !synced)
+    {
+        SNAP_LOG_FATAL
+            << "an I/O error occurred trying to write to \""
+            << private_filename
+            << "\" for \""
+            << f_domain
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    output_stage stage;
+    if(!stage.stage(path + "/mail.txt", key.txt_record(f_mail_subdomains[0], f_domain))
+    || !stage.commit())
+    {
+        SNAP_LOG_FATAL
+            << "could not save the DNS record of the OpenDKIM key of \""
+            << f_domain
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    f_new_opendkim_key = true;
+
+    return true;
+}
+
+
 std::string ipmgr::zone_files::get_zone_mail_subdomain() const
 {
     if(f_mail_subdomains.empty())
@@ -885,6 +1348,24 @@ std::string ipmgr::zone_files::get_zone_mail_subdomain() const
 }
 
 
+/** \brief Get the OpenDKIM selector of this zone.
+ *
+ * The selector is the first mail subdomain.
+ *
+ * \return The selector or an empty string if the zone has no mail
+ * subdomains.
+ */
+std::string ipmgr::zone_files::get_opendkim_selector() const
+{
+    if(f_mail_subdomains.empty())
+    {
+        return std::string();
+    }
+
+    return f_mail_subdomains[0];
+}
+
+
 bool ipmgr::zone_files::is_auth_server() const
 {
     return f_auth_server;
@@ -920,6 +1401,11 @@ bool ipmgr::zone_files::retrieve_fields()
 {
     typedef bool (ipmgr::zone_files::*retrieve_func_t)();
 
+    if(!load_configs())
+    {
+        return false;
+    }
+
     retrieve_func_t func_list[] =
     {
         // WARNING: for some fields, the order matters
@@ -932,6 +1418,7 @@ bool ipmgr::zone_files::retrieve_fields()
         &ipmgr::zone_files::retrieve_nameservers,
         &ipmgr::zone_files::retrieve_hostmaster,
         &ipmgr::zone_files::retrieve_dynamic,
+        &ipmgr::zone_files::retrieve_serial_strategy,
         &ipmgr::zone_files::retrieve_serial,
         &ipmgr::zone_files::retrieve_refresh,
         &ipmgr::zone_files::retrieve_retry,
@@ -1010,13 +1497,11 @@ bool ipmgr::zone_files::retrieve_ptr()
         return true;
     }
 
-    addr::addr_parser parser;
-    parser.set_allow(addr::allow_t::ALLOW_ADDRESS, true);
-    parser.set_allow(addr::allow_t::ALLOW_REQUIRED_ADDRESS, true);
-    parser.set_allow(addr::allow_t::ALLOW_ADDRESS_LOOKUP, false);
-    parser.set_allow(addr::allow_t::ALLOW_PORT, false);
-    addr::addr_range::vector_t r(parser.parse(f_ptr));
-    addr::addr a(r[0].get_from());
+    addr::addr a;
+    if(!parse_ip(f_ptr, a))
+    {
+        return false;
+    }
     if(!a.is_ipv4())
     {
         SNAP_LOG_ERROR
@@ -1043,11 +1528,12 @@ bool ipmgr::zone_files::retrieve_ptr()
 
 bool ipmgr::zone_files::retrieve_ips()
 {
+    advgetopt::string_list_t ips;
     advgetopt::split_string(
           get_zone_param("ips", "default_ips")
-        , f_ips
+        , ips
         , {" ", ",", ";"});
-    if(f_ips.size() == 0)
+    if(ips.size() == 0)
     {
         SNAP_LOG_ERROR
             << "You must defined at least one IP address defined in a zone."
@@ -1055,7 +1541,8 @@ bool ipmgr::zone_files::retrieve_ips()
         return false;
     }
 
-    return validate_ips(f_ips);
+    f_ips.clear();
+    return parse_ips(ips, f_ips);
 }
 
 
@@ -1168,6 +1655,25 @@ bool ipmgr::zone_files::retrieve_hostmaster()
 }
 
 
+bool ipmgr::zone_files::retrieve_serial_strategy()
+{
+    std::string const strategy(get_zone_param("serial_strategy", "default_serial_strategy", "counter"));
+    if(!string_to_serial_strategy(strategy, f_serial_strategy))
+    {
+        SNAP_LOG_ERROR
+            << "Invalid serial strategy \""
+            << strategy
+            << "\" for \""
+            << f_domain
+            << "\". Please try with \"counter\", \"date\", or \"unixtime\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    return true;
+}
+
+
 bool ipmgr::zone_files::retrieve_serial()
 {
     return get_zone_serial() != 0;
@@ -1432,7 +1938,18 @@ ipmgr::zone_files::dynamic_t ipmgr::zone_files::dynamic() const
 }
 
 
-std::string ipmgr::zone_files::generate_zone_file()
+/** \brief Generate the header of the zone file.
+ *
+ * The header includes the SOA which is the only part of the zone that
+ * depends on the serial number. This allows us to generate the body of
+ * the zone once, compare it with the previous version, and only then
+ * generate the header with the new serial number if the body changed.
+ *
+ * \param[in] serial  The serial number to save in the SOA.
+ *
+ * \return The header of the zone file.
+ */
+std::string ipmgr::zone_files::generate_zone_header(std::uint32_t serial) const
 {
     std::stringstream zone_data;
 
@@ -1453,7 +1970,7 @@ std::string ipmgr::zone_files::generate_zone_file()
         << ". "
         << f_hostmaster
         << ". ("
-        << f_serial
+        << serial
         << " "
         << f_refresh
         << " "
@@ -1464,11 +1981,29 @@ std::string ipmgr::zone_files::generate_zone_file()
         << f_minimum_cache_failures
         << ")\n";
 
+    return zone_data.str();
+}
+
+
+/** \brief Generate the body of the zone file.
+ *
+ * The body is everything that follows the SOA. It does not depend on
+ * the serial number of the zone.
+ *
+ * \return The body of the zone file or an empty string on errors.
+ */
+std::string ipmgr::zone_files::generate_zone_body()
+{
+    f_new_opendkim_key = false;
+
+    zone_records records;
+    records.reserve(f_nameservers.size() + f_mail_subdomains.size() + f_ips.size() + 8);
+
     // list of nameservers
     //
     for(auto const & ns : f_nameservers)
     {
-        zone_data << "\tNS " << ns.first << ".\n";
+        records.add(std::string(), 0, record_type_t::RECORD_TYPE_NS, ns.first + '.');
     }
 
     // MX entries if this domain supports mail
@@ -1477,27 +2012,33 @@ std::string ipmgr::zone_files::generate_zone_file()
     {
         for(auto const & subdomain : f_mail_subdomains)
         {
-            zone_data << "\t";
+            std::int32_t mail_ttl(0);
             if(f_mail_ttl > 0)
             {
                 if(f_mail_ttl != f_ttl)
                 {
-                    zone_data << f_mail_ttl << ' ';    // 1m minimum
+                    mail_ttl = f_mail_ttl;    // 1m minimum
                 }
             }
             else if(f_mail_default_ttl > 0)
             {
                 if(f_mail_default_ttl != f_ttl)
                 {
-                    zone_data << f_mail_default_ttl << ' ';    // 1m minimum
+                    mail_ttl = f_mail_default_ttl;    // 1m minimum
                 }
             }
-            zone_data << "MX";
+            std::string mx;
             if(f_mail_priority > 0)
             {
-                zone_data << ' ' << f_mail_priority;
+                mx = ' ';
+                mx += std::to_string(f_mail_priority);
             }
-            zone_data << '\t' << subdomain << '.' << f_domain << ".\n";
+            mx += '\t';
+            mx += subdomain;
+            mx += '.';
+            mx += f_domain;
+            mx += '.';
+            records.add(std::string(), mail_ttl, record_type_t::RECORD_TYPE_MX, mx);
 
             // TODO: look into automatically handling the mail server keys
             //
@@ -1508,34 +2049,23 @@ std::string ipmgr::zone_files::generate_zone_file()
 
     // domain IP addresses
     //
-    for(auto const & ip : f_ips)
+    for(auto const & a : f_ips)
     {
-        addr::addr_parser parser;
-        parser.set_allow(addr::allow_t::ALLOW_ADDRESS, true);
-        parser.set_allow(addr::allow_t::ALLOW_REQUIRED_ADDRESS, true);
-        parser.set_allow(addr::allow_t::ALLOW_ADDRESS_LOOKUP, false);
-        parser.set_allow(addr::allow_t::ALLOW_PORT, false);
-        addr::addr_range::vector_t r(parser.parse(ip));
-        addr::addr a(r[0].get_from());
-
-        if(a.is_ipv4())
-        {
-            zone_data << "\tA";
-        }
-        else
-        {
-            zone_data << "\tAAAA";
-        }
-        zone_data << '\t' << a.to_ipv4or6_string(addr::STRING_IP_ADDRESS) << '\n';
+        records.add(
+              std::string()
+            , 0
+            , a.is_ipv4()
+                ? record_type_t::RECORD_TYPE_A
+                : record_type_t::RECORD_TYPE_AAAA
+            , a.to_ipv4or6_string(addr::STRING_IP_ADDRESS));
     }
 
-    // we want all the subdomains sorted so we use this intermediate
-    // std::stringstream to generate a string that we save in a set and
-    // afterward we write the strings in the set to the zone_data
+    // we want all the subdomains sorted so we collect them in separate
+    // lists which get sorted once all the sections were parsed
     //
     std::set<std::string> unique_nameserver_ips;
-    std::set<std::string> sorted_domains;
-    std::set<std::string> sorted_subdomains;
+    zone_records sorted_domains;
+    zone_records sorted_subdomains;
     for(auto const & s : f_sections)
     {
         if(s == g_iplock_options_environment.f_section_variables_name)
@@ -1557,6 +2087,7 @@ std::string ipmgr::zone_files::generate_zone_file()
         {
             return std::string();
         }
+        std::int32_t const record_ttl(subdomain_ttl != f_ttl ? subdomain_ttl : 0);
 
         advgetopt::string_list_t subdomain_txt;
         advgetopt::split_string(
@@ -1605,19 +2136,11 @@ std::string ipmgr::zone_files::generate_zone_file()
 
             for(auto const & txt : subdomain_txt)
             {
-                std::stringstream ss;
-
-                ss << '\t';
-
-                if(subdomain_ttl != 0
-                && subdomain_ttl != f_ttl)
-                {
-                    ss << subdomain_ttl << ' ';
-                }
-
-                ss << "TXT\t\"" << txt << '"';
-
-                sorted_domains.insert(ss.str());
+                sorted_domains.add(
+                      std::string()
+                    , record_ttl
+                    , record_type_t::RECORD_TYPE_TXT
+                    , '"' + txt + '"');
             }
         }
         else
@@ -1642,11 +2165,18 @@ std::string ipmgr::zone_files::generate_zone_file()
                 , subdomain_names
                 , {" ", ",", ";"});
 
-            advgetopt::string_list_t subdomain_ips;
+            // the IPs of a section are parsed once for all its subdomains
+            //
+            advgetopt::string_list_t subdomain_ip_list;
             advgetopt::split_string(
                   get_zone_param(s + "::ips")
-                , subdomain_ips
+                , subdomain_ip_list
                 , {" ", ",", ";"});
+            addr::addr::vector_t subdomain_ips;
+            if(!parse_ips(subdomain_ip_list, subdomain_ips))
+            {
+                return std::string();
+            }
             if(subdomain_ips.empty()
             && subdomain_txt.empty()
             && cname.empty())
@@ -1674,12 +2204,11 @@ std::string ipmgr::zone_files::generate_zone_file()
                 return std::string();
             }
 
-            if(!subdomain_ips.empty())
+            std::vector<std::string> subdomain_addresses;
+            subdomain_addresses.reserve(subdomain_ips.size());
+            for(auto const & a : subdomain_ips)
             {
-                if(!validate_ips(subdomain_ips))
-                {
-                    return std::string();
-                }
+                subdomain_addresses.push_back(a.to_ipv4or6_string(addr::STRING_IP_ADDRESS));
             }
 
             for(auto const & d : subdomain_names)
@@ -1688,38 +2217,23 @@ std::string ipmgr::zone_files::generate_zone_file()
                 {
                     for(auto const & txt : subdomain_txt)
                     {
-                        std::stringstream ss;
-
-                        ss << d << '\t';
-
-                        if(subdomain_ttl != 0
-                        && subdomain_ttl != f_ttl)
-                        {
-                            ss << subdomain_ttl << ' ';
-                        }
-
-                        ss << "TXT\t\"" << txt << '"';
-
-                        sorted_subdomains.insert(ss.str());
+                        sorted_subdomains.add(
+                              d
+                            , record_ttl
+                            , record_type_t::RECORD_TYPE_TXT
+                            , '"' + txt + '"');
                     }
                 }
 
                 if(!subdomain_ips.empty())
                 {
-                    for(auto const & ip : subdomain_ips)
+                    auto it(f_nameservers.find(d + '.' + f_domain));
+                    std::size_t const max(subdomain_ips.size());
+                    for(std::size_t idx(0); idx < max; ++idx)
                     {
-                        std::stringstream ss;
-
-                        addr::addr_parser parser;
-                        parser.set_allow(addr::allow_t::ALLOW_ADDRESS, true);
-                        parser.set_allow(addr::allow_t::ALLOW_REQUIRED_ADDRESS, true);
-                        parser.set_allow(addr::allow_t::ALLOW_ADDRESS_LOOKUP, false);
-                        parser.set_allow(addr::allow_t::ALLOW_PORT, false);
-                        addr::addr_range::vector_t r(parser.parse(ip));
-                        addr::addr a(r[0].get_from());
-                        std::string const address(a.to_ipv4or6_string(addr::STRING_IP_ADDRESS));
-
-                        auto it(f_nameservers.find(d + '.' + f_domain));
+                        addr::addr const & a(subdomain_ips[idx]);
+                        std::string const & address(subdomain_addresses[idx]);
+
                         if(it != f_nameservers.end())
                         {
                             if(!it->second.empty()
@@ -1758,25 +2272,13 @@ std::string ipmgr::zone_files::generate_zone_file()
                             }
                         }
 
-                        ss << d << '\t';
-
-                        if(subdomain_ttl != 0
-                        && subdomain_ttl != f_ttl)
-                        {
-                            ss << subdomain_ttl << ' ';
-                        }
-
-                        if(a.is_ipv4())
-                        {
-                            ss << 'A';
-                        }
-                        else
-                        {
-                            ss << "AAAA";
-                        }
-                        ss << "\t" << address;
-
-                        sorted_subdomains.insert(ss.str());
+                        sorted_subdomains.add(
+                              d
+                            , record_ttl
+                            , a.is_ipv4()
+                                ? record_type_t::RECORD_TYPE_A
+                                : record_type_t::RECORD_TYPE_AAAA
+                            , address);
                     }
                 }
 
@@ -1793,20 +2295,10 @@ std::string ipmgr::zone_files::generate_zone_file()
                         return std::string();
                     }
 
-                    std::stringstream ss;
-
-                    ss << d << '\t';
-
-                    if(subdomain_ttl != 0
-                    && subdomain_ttl != f_ttl)
-                    {
-                        ss << subdomain_ttl << ' ';
-                    }
-
-                    ss << "CNAME\t";
+                    std::string target;
                     if(cname == ".")
                     {
-                        ss << f_domain << '.';
+                        target = f_domain + '.';
                     }
                     else if(cname.back() == '.')
                     {
@@ -1818,7 +2310,7 @@ std::string ipmgr::zone_files::generate_zone_file()
                         // if it ends with a period we assume it's a full
                         // domain name and only output the `cname` content
                         //
-                        ss << cname;
+                        target = cname;
                     }
                     else
                     {
@@ -1830,19 +2322,21 @@ std::string ipmgr::zone_files::generate_zone_file()
 
                         // assume cname is a subdomain of this domain
                         //
-                        ss << link << '.';
+                        target = link + '.';
                     }
 
-                    sorted_subdomains.insert(ss.str());
+                    sorted_subdomains.add(
+                          d
+                        , record_ttl
+                        , record_type_t::RECORD_TYPE_CNAME
+                        , target);
                 }
             }
         }
     }
 
-    for(auto const & d : sorted_domains)
-    {
-        zone_data << d << '\n';
-    }
+    sorted_domains.sort();
+    records.append(sorted_domains);
 
     if(!f_mail_subdomains.empty())
     {
@@ -1850,21 +2344,22 @@ std::string ipmgr::zone_files::generate_zone_file()
         //
         // https://en.wikipedia.org/wiki/Sender_Policy_Framework
         //
-        zone_data
-            << '\t'
-            << f_key_ttl
-            << " TXT\t\"v=spf1 a:"
-            << f_mail_subdomains[0]
-            << '.'
-            << f_domain
-            << " a:"
-            << f_domain
-            << " -all\"\n";
+        records.add(
+              std::string()
+            , f_key_ttl
+            , record_type_t::RECORD_TYPE_TXT
+            , "\"v=spf1 a:"
+                + f_mail_subdomains[0]
+                + '.'
+                + f_domain
+                + " a:"
+                + f_domain
+                + " -all\"");
     }
 
     // switch to the subdomains now
     //
-    zone_data << "$ORIGIN " << f_domain << ".\n";
+    records.add_origin(f_domain + '.');
 
     // if there is an MX, handle the special fields for that
     //
@@ -1872,14 +2367,18 @@ std::string ipmgr::zone_files::generate_zone_file()
     {
         // opendkim
         //
-        std::string opendkim_path("/etc/opendkim/");
-        std::string path(opendkim_path);
-        path += f_domain;
-        path += ".key";
-        if(snapdev::mkdir_p(path) != 0)
+        // the key path is saved in the key_table so it has to be the path
+        // opendkim sees; the file system is accessed with the resolved path
+        //
+        std::string const key_path(std::string(paths::OPENDKIM) + '/' + f_domain + ".key");
+        std::string const path(f_paths.resolve(key_path));
+        if(!f_dry_run
+        && snapdev::mkdir_p(path) != 0)
         {
             SNAP_LOG_ERROR
-                << "failed creating \"/etc/opendkim\" for domain \""
+                << "failed creating \""
+                << path
+                << "\" for domain \""
                 << f_domain
                 << "\"."
                 << SNAP_LOG_SEND;
@@ -1902,361 +2401,196 @@ std::string ipmgr::zone_files::generate_zone_file()
                 return std::string();
             }
 
-            // the key doesn't exist yet, create it now
+            // the key doesn't exist yet, create it now; the key and
+            // signing tables get updated once all the zones were
+            // generated (see ipmgr::save_opendkim_tables())
             //
-            std::string cmd("opendkim-genkey --directory=");
-            cmd += path;
-            cmd += " --selector=";
-            cmd += f_mail_subdomains[0]; // TBD: I'm not so sure this is correct, but it works for us...
-            cmd += " --domain='";
-            cmd += f_domain;
-            cmd += "'";
-
-            if(f_verbose)
+            if(!generate_opendkim_key(path))
             {
-                std::cout
-                    << "info: "
-                    << cmd
-                    << std::endl;
+                return std::string();
             }
-            if(!f_dry_run)
+        }
+        else if(!S_ISREG(s.st_mode))
+        {
+            SNAP_LOG_FATAL
+                << "\""
+                << mailtxt
+                << "\" is not a regular file for \""
+                << f_domain
+                << "\"."
+                << SNAP_LOG_SEND;
+            return std::string();
+        }
+        snapdev::file_contents txt(mailtxt);
+        if(!txt.read_all())
+        {
+            // this is normal in a dry-run, otherwise we should
+            // have failed earlier anyway
+            //
+            SNAP_LOG_WARNING
+                << "OpenDKIM key for \""
+                << f_domain
+                << "\" not available."
+                << SNAP_LOG_SEND;
+        }
+        else
+        {
+            records.add(
+                  "adsp._domainkey"
+                , f_key_ttl
+                , record_type_t::RECORD_TYPE_TXT
+                , "\"dkim=all\"");
+
+            // the key file (see dkim_key::txt_record()) is a record, but
+            // the line does not include a TTL so we do a little bit of
+            // work on it
+            //
+            std::string const & key(txt.contents());
+            std::string::size_type const owner_end(key.find_first_of(" \t\n\r\v\f"));
+            if(owner_end == std::string::npos)
+            {
+                SNAP_LOG_FATAL
+                    << "OpenDKIM key for \""
+                    << f_domain
+                    << "\" does not include any blanks."
+                    << SNAP_LOG_SEND;
+                return std::string();
+            }
+            char const * k(key.c_str() + owner_end);
+            do
+            {
+                ++k;
+            }
+            while(*k != '\0' && isspace(*k));
+            if(k[0] == 'I' && k[1] == 'N' && isspace(k[2]))
             {
-                int const r(system(cmd.c_str()));
-                if(r != 0)
+                k += 3;
+                while(*k != '\0' && isspace(*k))
                 {
-                    SNAP_LOG_FATAL
-                        << "could not generate an OpenDKIM key for \""
-                        << f_domain
-                        << "\" (exit code = "
-                        << r
-                        << ")."
-                        << SNAP_LOG_SEND;
-                    return std::string();
+                    ++k;
                 }
-
-                if(stat(mailtxt.c_str(), &s) != 0)
-                {
-                    SNAP_LOG_FATAL
-                        << "command \""
-                        << cmd
-                        << "\" did not generate expected file \""
-                        << mailtxt
-                        << "\" for \""
-                        << f_domain
-                        << "\"."
-                        << SNAP_LOG_SEND;
-                    return std::string();
-                }
-
-                // it worked, update the corresponding tables
-
-                // signing_table
-                //
-                std::string signing_filename(opendkim_path);
-                signing_filename += "/signing_table";
-                snapdev::file_contents signing_file(signing_filename);
-                signing_file.read_all();
-                std::string contents(signing_file.contents());
-                std::string::size_type pos(contents.find(f_domain));
-                if(pos != std::string::npos)
-                {
-                    // remove that line if it exists
-                    //
-                    std::string::size_type end(contents.find('\n', pos));
-                    if(end == std::string::npos)
-                    {
-                        end = contents.length();
-                    }
-                    else
-                    {
-                        ++end;
-                    }
-                    contents = contents.substr(0, pos)
-                             + contents.substr(end);
-                }
-                std::string key_id(f_mail_subdomains[0]);
-                key_id += "._domainkey.";
-                key_id += f_domain;
-                if(contents.empty())
-                {
-                    contents = "# WARNING: AUTO-GENERATED FILE, SEE ipmgr(1) FOR DETAILS\n";
-                }
-                contents += f_domain;
-                contents += ' ';
-                contents += key_id;
-                contents += '\n';
-                if(signing_file.contents() != contents)
-                {
-                    signing_file.contents(contents);
-                    if(!signing_file.write_all())
-                    {
-                        SNAP_LOG_FATAL
-                            << "an I/O error occurred trying to write to \""
-                            << signing_filename
-                            << "\" for \""
-                            << f_domain
-                            << "\"."
-                            << SNAP_LOG_SEND;
-                        return std::string();
-                    }
-                }
-
-                // key_table
-                //
-                std::string key_filename(opendkim_path);
-                key_filename += "/key_table";
-                snapdev::file_contents key_file(key_filename);
-                key_file.read_all();
-                contents = key_file.contents();
-                pos = contents.find(key_id);
-                if(pos != std::string::npos)
-                {
-                    // remove that line if it exists
-                    //
-                    std::string::size_type end(contents.find('\n', pos));
-                    if(end == std::string::npos)
-                    {
-                        end = contents.length();
-                    }
-                    else
-                    {
-                        ++end;
-                    }
-                    contents = contents.substr(0, pos)
-                             + contents.substr(end);
-                }
-                if(contents.empty())
-                {
-                    contents = "# WARNING: AUTO-GENERATED FILE, SEE ipmgr(1) FOR DETAILS\n";
-                }
-                contents += key_id;
-                contents += ' ';
-                contents += f_domain;
-                contents += ":mail:";
-                contents += path;
-                contents += "/mail.private\n";
-                if(key_file.contents() != contents)
-                {
-                    key_file.contents(contents);
-                    if(!key_file.write_all())
-                    {
-                        SNAP_LOG_FATAL
-                            << "an I/O error occurred trying to write to \""
-                            << key_filename
-                            << "\" for \""
-                            << f_domain
-                            << "\"."
-                            << SNAP_LOG_SEND;
-                        return std::string();
-                    }
-                }
-
-                snapdev::file_contents flag(g_opendkim_need_restart, true);
-                flag.contents("*** opendkim restart required ***\n");
-                if(!flag.write_all())
-                {
-                    SNAP_LOG_MINOR
-                        << "could not write to file \""
-                        << g_opendkim_need_restart
-                        << "\": "
-                        << flag.last_error()
-                        << SNAP_LOG_SEND;
-                }
-            }
-        }
-        else if(!S_ISREG(s.st_mode))
-        {
-            SNAP_LOG_FATAL
-                << "\""
-                << mailtxt
-                << "\" is not a regular file for \""
-                << f_domain
-                << "\"."
-                << SNAP_LOG_SEND;
-            return std::string();
-        }
-        snapdev::file_contents txt(mailtxt);
-        if(!txt.read_all())
-        {
-            // this is normal in a dry-run, otherwise we should
-            // have failed earlier anyway
-            //
-            SNAP_LOG_WARNING
-                << "OpenDKIM key for \""
-                << f_domain
-                << "\" not available."
-                << SNAP_LOG_SEND;
-        }
-        else
-        {
-            zone_data << "adsp._domainkey\t" << f_key_ttl << " TXT\t\"dkim=all\"\n";
-
-            // the opendkim-genkey generates a key file, but the line does
-            // not include a TTL so we do a little bit of work on it
-            //
-            std::string const & key(txt.contents());
-            for(char const * k(key.c_str());; ++k)
-            {
-                if(*k == '\0')
-                {
-                    SNAP_LOG_FATAL
-                        << "OpenDKIM key for \""
-                        << f_domain
-                        << "\" does not include any blanks."
-                        << SNAP_LOG_SEND;
-                    return std::string();
-                }
-                if(isspace(*k))
-                {
-                    zone_data << '\t';
-                    zone_data << f_key_ttl;
-                    zone_data << ' ';
-                    do
-                    {
-                        ++k;
-                    }
-                    while(*k != '\0' && isspace(*k));
-                    if(k[0] == 'I' && k[1] == 'N' && isspace(k[2]))
-                    {
-                        k += 3;
-                        while(*k != '\0' && isspace(*k))
-                        {
-                            ++k;
-                        }
-                    }
-                    zone_data << k;
-                    break;
-                }
-                zone_data << *k;
-            }
-        }
+            }
+            std::string data(k);
+            while(!data.empty() && data.back() == '\n')
+            {
+                data.pop_back();
+            }
+            records.add(
+                  key.substr(0, owner_end)
+                , f_key_ttl
+                , record_type_t::RECORD_TYPE_RAW
+                , data);
+        }
 
         // opendmarc
         //
-        zone_data
-            << "_dmarc\t"
-            << f_key_ttl
-            << " TXT\t\"v=DMARC1; p=quarantine;";
+        std::string dmarc("\"v=DMARC1; p=quarantine;");
 
         if(!f_dmarc_rua.empty())
         {
-            zone_data
-                << " rua:"
-                << f_dmarc_rua
-                << ';';
+            dmarc += " rua:";
+            dmarc += f_dmarc_rua;
+            dmarc += ';';
         }
 
         if(!f_dmarc_ruf.empty())
         {
-            zone_data
-                << " ruf:"
-                << f_dmarc_ruf
-                << ';';
+            dmarc += " ruf:";
+            dmarc += f_dmarc_ruf;
+            dmarc += ';';
         }
 
-        zone_data
-            << " fo=0; adkim=r; aspf=r; pct=100; rf=afrf; sp=quarantine\"\n";
-    }
+        dmarc += " fo=0; adkim=r; aspf=r; pct=100; rf=afrf; sp=quarantine\"";
 
-    for(auto const & d : sorted_subdomains)
-    {
-        zone_data << d << '\n';
+        records.add(
+              "_dmarc"
+            , f_key_ttl
+            , record_type_t::RECORD_TYPE_TXT
+            , dmarc);
     }
 
-    zone_data << "; vim: ts=25\n";
-
-    // verify the final zone
-    //
-    {
-        std::string const zone_to_verify("/run/ipmgr/verify.zone");
-        snapdev::file_contents temp(zone_to_verify, true, true);
-        temp.contents(zone_data.str());
-        if(!temp.write_all())
-        {
-            SNAP_LOG_FATAL
-                << "the generated zone could not be saved in \""
-                << zone_to_verify
-                << "\" for verification."
-                << SNAP_LOG_SEND;
-            return std::string();
-        }
-
-        std::string verify_zone("named-checkzone ");
-        verify_zone += f_domain;
-        verify_zone += ' ';
-        verify_zone += zone_to_verify;
-        if(f_verbose)
-        {
-            std::cout
-                << "info: "
-                << verify_zone
-                << std::endl;
-        }
+    sorted_subdomains.sort();
+    records.append(sorted_subdomains);
 
-        cppprocess::process named_checkzone("named-verification");
-        named_checkzone.set_command("named-checkzone");
-        named_checkzone.add_argument(f_domain);
-        named_checkzone.add_argument(zone_to_verify);
+    std::string zone_data;
+    records.render(zone_data);
+    zone_data += "; vim: ts=25\n";
 
-        cppprocess::io_capture_pipe::pointer_t output(std::make_shared<cppprocess::io_capture_pipe>());
-        named_checkzone.set_output_io(output);
+    return zone_data;
+}
 
-        cppprocess::io_capture_pipe::pointer_t error(std::make_shared<cppprocess::io_capture_pipe>());
-        named_checkzone.set_error_io(error);
 
-        if(f_verbose)
-        {
-            std::cout
-                << "info: "
-                << named_checkzone.get_command_line()
-                << std::endl;
-        }
+/** \brief Verify a zone with named-checkzone.
+ *
+ * This function saves the zone in a temporary file and runs the
+ * named-checkzone tool against it.
+ *
+ * \param[in] zone_data  The complete zone file (header and body).
+ *
+ * \return true if the zone is considered valid.
+ */
+bool ipmgr::zone_files::verify_zone(std::string const & zone_data) const
+{
+    // the filename includes the domain name since multiple zones
+    // may be verified simultaneously (see --jobs)
+    //
+    std::string const zone_to_verify(f_paths.resolve(paths::IPMGR_RUN) + "/verify-" + f_domain + ".zone");
+    snapdev::file_contents temp(zone_to_verify, true, true);
+    temp.contents(zone_data);
+    if(!temp.write_all())
+    {
+        SNAP_LOG_FATAL
+            << "the generated zone could not be saved in \""
+            << zone_to_verify
+            << "\" for verification."
+            << SNAP_LOG_SEND;
+        return false;
+    }
 
-        if(named_checkzone.start() != 0)
-        {
-            SNAP_LOG_FATAL
-                << "could not start \""
-                << named_checkzone.get_command_line()
-                << "\"."
-                << SNAP_LOG_SEND;
-            return std::string();
-        }
+    process_runner named_checkzone("named-checkzone", { f_domain, zone_to_verify });
+    if(f_verbose)
+    {
+        std::cout
+            << "info: "
+            << named_checkzone.get_command_line()
+            << std::endl;
+    }
 
-        int const r(named_checkzone.wait());
-        if(r != 0)
-        {
-            std::string const results(snapdev::trim_string(output->get_output(true)));
-            std::string const errmsg(snapdev::trim_string(error->get_output(true)));
+    int const r(named_checkzone.run());
+    if(r != 0)
+    {
+        std::string const results(snapdev::trim_string(named_checkzone.output()));
+        std::string const errmsg(snapdev::trim_string(named_checkzone.error()));
 
-            SNAP_LOG_FATAL
-                << "command \""
-                << named_checkzone.get_command_line()
-                << "\" returned an error (exit code "
-                << r
-                << "): stdout \""
-                << results
-                << "\" -- stderr \""
-                << errmsg
-                << "\"."
-                << SNAP_LOG_SEND;
-            return std::string();
-        }
+        SNAP_LOG_FATAL
+            << "command \""
+            << named_checkzone.get_command_line()
+            << "\" returned an error (exit code "
+            << r
+            << "): stdout \""
+            << results
+            << "\" -- stderr \""
+            << errmsg
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
     }
 
-    return zone_data.str();
+    return true;
 }
 
 
-std::string ipmgr::zone_files::generate_ptr_file()
+/** \brief Generate the header of the PTR zone file.
+ *
+ * Like with the generate_zone_header(), this header includes the SOA
+ * and thus the serial number.
+ *
+ * \param[in] serial  The serial number to save in the SOA.
+ *
+ * \return The header of the PTR zone file.
+ */
+std::string ipmgr::zone_files::generate_ptr_header(std::uint32_t serial) const
 {
-    // at the moment, I think this should not happen, but I'd have to test
-    // to make 100% sure
-    //
-    if(f_nameservers.empty())
-    {
-        return std::string();
-    }
-
     std::stringstream zone_data;
 
     // warning
@@ -2275,7 +2609,7 @@ std::string ipmgr::zone_files::generate_ptr_file()
         << ". "
         << f_hostmaster
         << ". ("
-        << f_serial
+        << serial
         << " "
         << f_refresh
         << " "
@@ -2286,6 +2620,26 @@ std::string ipmgr::zone_files::generate_ptr_file()
         << f_minimum_cache_failures
         << ")\n";
 
+    return zone_data.str();
+}
+
+
+/** \brief Generate the body of the PTR zone file.
+ *
+ * \return The body of the PTR zone file or an empty string on errors.
+ */
+std::string ipmgr::zone_files::generate_ptr_body() const
+{
+    // at the moment, I think this should not happen, but I'd have to test
+    // to make 100% sure
+    //
+    if(f_nameservers.empty())
+    {
+        return std::string();
+    }
+
+    std::stringstream zone_data;
+
     // list of nameservers
     //
     for(auto const & ns : f_nameservers)
@@ -2324,6 +2678,7 @@ std::string ipmgr::zone_files::generate_ptr_file()
  */
 ipmgr::ipmgr(int argc, char * argv[])
     : f_opt(std::make_shared<advgetopt::getopt>(g_iplock_options_environment))
+    , f_zone_cache(paths::IPMGR_ZONE_CACHE)
 {
     snaplogger::add_logger_options(*f_opt);
     f_opt->finish_parsing(argc, argv);
@@ -2334,9 +2689,70 @@ ipmgr::ipmgr(int argc, char * argv[])
                     , false);
 
     f_dry_run = f_opt->is_defined("dry-run");
-    f_verbose = f_dry_run || f_opt->is_defined("verbose");
+    f_verbose = (f_dry_run || f_opt->is_defined("verbose"))
+             && !f_opt->is_defined("quiet");
     f_force = f_opt->is_defined("force");
+    f_paranoid = f_opt->is_defined("paranoid");
     f_config_warnings = f_opt->is_defined("config-warnings");
+    f_daemon = f_opt->is_defined("daemon");
+
+    if(f_opt->is_defined("root-dir"))
+    {
+        f_paths = paths(f_opt->get_string("root-dir"));
+        f_zone_cache = zone_cache(f_paths.resolve(paths::IPMGR_ZONE_CACHE));
+    }
+    f_serial_store = std::make_shared<serial_store>(
+              f_paths.resolve(paths::IPMGR_SERIAL_DB)
+            , f_paths.resolve(paths::IPMGR_SERIAL)
+            , f_dry_run);
+
+    // keep a copy of the arguments to restart the daemon
+    //
+    f_argv.assign(argv, argv + argc);
+    f_argv.push_back(nullptr);
+
+    // on an invalid number, get_long() already emitted an error and
+    // returns -1 in which case we keep the default of 1 job
+    //
+    long const jobs(f_opt->get_long("jobs", 0, 0, 1024));
+    if(jobs == 0)
+    {
+        f_jobs = std::max(1, cppthread::get_number_of_available_processors());
+    }
+    else if(jobs > 0)
+    {
+        f_jobs = jobs;
+    }
+
+    long const debounce(f_opt->get_long("debounce", 0, 0, 60000));
+    if(debounce >= 0)
+    {
+        f_debounce = debounce;
+    }
+
+    copy_mode_t copy_mode(copy_mode_t::COPY_MODE_REFLINK);
+    if(string_to_copy_mode(f_opt->get_string("copy-mode"), copy_mode))
+    {
+        f_output_stage.set_copy_mode(copy_mode);
+    }
+    else
+    {
+        SNAP_LOG_ERROR
+            << "unknown --copy-mode \""
+            << f_opt->get_string("copy-mode")
+            << "\", using \"reflink\" instead."
+            << SNAP_LOG_SEND;
+    }
+
+    dkim_key_type_t key_type(dkim_key_type_t::DKIM_KEY_TYPE_RSA);
+    if(!string_to_dkim_key_type(f_opt->get_string("opendkim-key-type"), key_type))
+    {
+        SNAP_LOG_ERROR
+            << "unknown --opendkim-key-type \""
+            << f_opt->get_string("opendkim-key-type")
+            << "\", using \"rsa\" instead."
+            << SNAP_LOG_SEND;
+    }
 }
 
 
@@ -2384,18 +2800,21 @@ int ipmgr::make_root()
 }
 
 
-/** \brief Read all the files to process.
+/** \brief Get the list of zone directories.
  *
- * This function reads all the zone files that are going to be processed.
- * It also merges the list items by name. The same zone can be defined in
- * three different locations (plus their standard sub-directories as per
- * advgetopt, so really some 303 files). The one with the lowest priority
- * is read first. The others can overwrite the values as required.
+ * This function returns the list of directories defined in the
+ * `--zone-directories` option or its default if undefined.
+ *
+ * The directories are resolved against the `--root-dir` directory.
+ *
+ * \param[out] directories  The list of zone directories.
+ *
+ * \return 0 on success, 1 on errors.
  */
-int ipmgr::read_zones()
+int ipmgr::get_zone_directories(advgetopt::string_list_t & directories)
 {
-    // get a list of all the files
-    //
+    directories.clear();
+
     std::size_t max(f_opt->size("zone-directories"));
     if(max == 0)
     {
@@ -2414,10 +2833,36 @@ int ipmgr::read_zones()
         max = f_opt->size("zone-directories");
     }
 
-    int exit_code(0);
     for(std::size_t i(0); i < max; ++i)
     {
-        std::string dir(f_opt->get_string("zone-directories", i));
+        directories.push_back(f_paths.resolve(f_opt->get_string("zone-directories", i)));
+    }
+
+    return 0;
+}
+
+
+/** \brief Read all the files to process.
+ *
+ * This function reads all the zone files that are going to be processed.
+ * It also merges the list items by name. The same zone can be defined in
+ * three different locations (plus their standard sub-directories as per
+ * advgetopt, so really some 303 files). The one with the lowest priority
+ * is read first. The others can overwrite the values as required.
+ */
+int ipmgr::read_zones()
+{
+    // get a list of all the files
+    //
+    advgetopt::string_list_t directories;
+    int exit_code(get_zone_directories(directories));
+    if(exit_code != 0)
+    {
+        return exit_code;
+    }
+
+    for(auto const & dir : directories)
+    {
         if(f_verbose)
         {
             std::cout
@@ -2444,57 +2889,103 @@ int ipmgr::read_zones()
         //
         for(auto const & g : glob)
         {
-            advgetopt::conf_file_setup zone_setup(g);
-            advgetopt::conf_file::pointer_t zone_file(advgetopt::conf_file::get_conf_file(zone_setup));
-            zone_file->set_variables(f_opt->get_variables());
-            std::string const domain(zone_file->get_parameter("domain"));
-            if(domain.empty())
+            struct stat st = {};
+            if(stat(g.c_str(), &st) != 0)
             {
-                // force the re-definition of the domain name at all the
-                // levels to confirm that everything is as it has to be
-                //
-                SNAP_LOG_ERROR
-                    << "a domain name cannot be an empty string in \""
+                SNAP_LOG_WARNING
+                    << "could not retrieve the status of \""
                     << g
-                    << "\"."
+                    << "\"; ignoring."
                     << SNAP_LOG_SEND;
-                exit_code = 1;
                 continue;
             }
 
-            if(f_config_warnings)
+            // when the file did not change since the last run, we already
+            // know its domain name and hash so we do not read it at all
+            //
+            zone_cache::file_entry entry;
+            zone_cache::file_entry const * cached(f_zone_cache.find_file(g));
+            if(cached != nullptr
+            && cached->f_mtime_sec == st.st_mtim.tv_sec
+            && cached->f_mtime_nsec == st.st_mtim.tv_nsec
+            && cached->f_size == st.st_size)
             {
-                std::string const domain_filename(snapdev::pathinfo::basename(g, ".conf"));
-                if(domain_filename != domain)
+                entry = *cached;
+            }
+            else
+            {
+                snapdev::file_contents contents(g);
+                if(!contents.read_all())
                 {
-                    SNAP_LOG_WARNING
-                        << "domain filename ("
+                    SNAP_LOG_ERROR
+                        << "could not read zone configuration file \""
                         << g
-                        << ") does not corresponding to the domain defined in that file ("
-                        << domain
-                        << ")."
+                        << "\": "
+                        << contents.last_error()
+                        << SNAP_LOG_SEND;
+                    exit_code = 1;
+                    continue;
+                }
+                entry.f_mtime_sec = st.st_mtim.tv_sec;
+                entry.f_mtime_nsec = st.st_mtim.tv_nsec;
+                entry.f_size = st.st_size;
+                entry.f_hash = fnv1a_64(contents.contents());
+
+                advgetopt::conf_file_setup zone_setup(g);
+                advgetopt::conf_file::pointer_t zone_file(advgetopt::conf_file::get_conf_file(zone_setup));
+                zone_file->set_variables(f_opt->get_variables());
+                entry.f_domain = zone_file->get_parameter("domain");
+                if(entry.f_domain.empty())
+                {
+                    // force the re-definition of the domain name at all the
+                    // levels to confirm that everything is as it has to be
+                    //
+                    SNAP_LOG_ERROR
+                        << "a domain name cannot be an empty string in \""
+                        << g
+                        << "\"."
                         << SNAP_LOG_SEND;
+                    exit_code = 1;
+                    continue;
+                }
+
+                // verify the TLD with the libtld
+                //
+                // this is an early validation; it is done again when we
+                // retrieve that field in ipmgr::zone_files::retrieve_domain()
+                //
+                if(!validate_domain(entry.f_domain))
+                {
+                    exit_code = 1;
+                    continue;
                 }
             }
+            f_zone_cache.set_file(g, entry);
 
-            // verify the TLD with the libtld
-            //
-            // this is an early validation; it is done again when we
-            // retrieve that field in ipmgr::zone_files::retrieve_domain()
-            //
-            if(!validate_domain(domain))
+            std::string const & domain(entry.f_domain);
+
+            if(f_config_warnings)
             {
-                exit_code = 1;
-                continue;
+                std::string const domain_filename(snapdev::pathinfo::basename(g, ".conf"));
+                if(domain_filename != domain)
+                {
+                    SNAP_LOG_WARNING
+                        << "domain filename ("
+                        << g
+                        << ") does not corresponding to the domain defined in that file ("
+                        << domain
+                        << ")."
+                        << SNAP_LOG_SEND;
+                }
             }
 
             // further validation of the file will happen later
             //
             if(f_zone_files[domain] == nullptr)
             {
-                f_zone_files[domain] = std::make_shared<zone_files>(f_opt, f_verbose);
+                f_zone_files[domain] = std::make_shared<zone_files>(f_opt, f_paths, f_serial_store, f_verbose);
             }
-            f_zone_files[domain]->add(zone_file);
+            f_zone_files[domain]->add(g, entry.f_hash);
 
             if(f_verbose)
             {
@@ -2520,21 +3011,165 @@ int ipmgr::read_zones()
 }
 
 
-int ipmgr::prepare_includes()
+/** \brief Retrieve the zones found by read_zones().
+ *
+ * \return The map of zones indexed by domain name.
+ */
+ipmgr::zone_files::map_t const & ipmgr::get_zone_files() const
+{
+    return f_zone_files;
+}
+
+
+/** \brief Compute the fingerprint of the global options.
+ *
+ * The zones make use of a few global options as their defaults. If any
+ * one of those changes, all the zones need to be regenerated. This
+ * function computes a hash of those options, the variables, and the
+ * version of ipmgr (since a new version may generate different files).
+ *
+ * \return The fingerprint of the global options.
+ */
+std::uint64_t ipmgr::options_fingerprint() const
 {
-    std::string const includes_filename("/etc/bind/ipmgr-options.conf");
+    std::uint64_t fingerprint(fnv1a_64(IPMGR_VERSION_STRING));
 
-    f_includes.open(includes_filename);
-    if(!f_includes.is_open())
+    for(char const * const * name(g_fingerprint_options); *name != nullptr; ++name)
     {
-        SNAP_LOG_ERROR
-            << "could not create file \""
-            << includes_filename
-            << "\"."
-            << SNAP_LOG_SEND;
-        return 1;
+        fingerprint = fnv1a_64(*name, fingerprint);
+        std::size_t const max(f_opt->size(*name));
+        for(std::size_t idx(0); idx < max; ++idx)
+        {
+            fingerprint = fnv1a_64(f_opt->get_string(*name, idx), fingerprint);
+        }
+    }
+
+    advgetopt::variables::pointer_t variables(f_opt->get_variables());
+    if(variables != nullptr)
+    {
+        for(auto const & v : variables->get_variables())
+        {
+            fingerprint = fnv1a_64(v.first, fingerprint);
+            fingerprint = fnv1a_64(v.second, fingerprint);
+        }
+    }
+
+    return fingerprint;
+}
+
+
+/** \brief Restore a zone from the cache if it did not change.
+ *
+ * If the fingerprint of the zone is the same as the one saved in the
+ * cache by the last run and the output files still exist, the zone
+ * does not need to be generated. In that case, the fields required
+ * to generate the .conf files are restored from the cache and the
+ * job is marked as done.
+ *
+ * \param[in] domain  The domain of the zone.
+ * \param[in,out] job  The job of the zone with its fingerprint defined.
+ *
+ * \return true if the zone was restored from the cache.
+ */
+bool ipmgr::restore_zone(std::string const & domain, zone_job & job)
+{
+    zone_cache::zone_entry const * entry(f_zone_cache.find_zone(domain));
+    if(entry == nullptr
+    || entry->f_fingerprint != job.f_fingerprint)
+    {
+        return false;
+    }
+
+    // make sure the output was not deleted under our feet
+    //
+    advgetopt::string_list_t outputs;
+    outputs.push_back(std::string(paths::IPMGR_GENERATED) + '/' + entry->f_group + '/' + domain + ".zone");
+    if(entry->f_dynamic == static_cast<int>(zone_files::dynamic_t::DYNAMIC_STATIC))
+    {
+        outputs.push_back(std::string(paths::BIND_ZONES) + '/' + entry->f_group + '/' + domain + ".zone");
+    }
+    else
+    {
+        outputs.push_back(std::string(paths::BIND_DYNAMIC_ZONES) + '/' + domain + ".zone");
+    }
+    if(!entry->f_ptr.empty())
+    {
+        outputs.push_back(std::string(paths::IPMGR_GENERATED) + '/' + entry->f_ptr + ".ptr");
+        outputs.push_back(std::string(paths::BIND_ZONES) + '/' + entry->f_ptr + ".ptr");
+    }
+    for(auto const & o : outputs)
+    {
+        if(access(f_paths.resolve(o).c_str(), F_OK) != 0)
+        {
+            return false;
+        }
+    }
+
+    // keep the index entries of the generated files for the next run
+    //
+    for(auto const & o : outputs)
+    {
+        std::string const filename(f_paths.resolve(o));
+        zone_cache::output_entry const * output(f_zone_cache.find_output(filename));
+        if(output != nullptr)
+        {
+            job.f_outputs[filename] = *output;
+        }
+    }
+
+    job.f_zone->restore(domain, *entry);
+    job.f_cached = true;
+    job.f_fields_retrieved = true;
+    job.f_generated = true;
+    if(!entry->f_ptr.empty())
+    {
+        job.f_ptr_processed = true;
+        job.f_ptr_generated = true;
+    }
+
+    if(f_verbose)
+    {
+        std::cout
+            << "info: zone \""
+            << domain
+            << "\" did not change since the last run."
+            << std::endl;
+    }
+
+    return true;
+}
+
+
+/** \brief Save the zone of a successful job in the cache.
+ *
+ * Only zones which were successfully generated (or restored) get saved
+ * in the cache. The others will be generated again on the next run.
+ *
+ * \param[in] job  The job to save in the cache.
+ */
+void ipmgr::cache_zone(zone_job const & job)
+{
+    if(job.f_result != 0
+    || job.f_ptr_result != 0
+    || !job.f_generated)
+    {
+        return;
+    }
+
+    zone_cache::zone_entry entry(job.f_zone->get_cache_entry());
+    entry.f_fingerprint = job.f_fingerprint;
+    f_zone_cache.set_zone(job.f_zone->domain(), entry);
+
+    for(auto const & o : job.f_outputs)
+    {
+        f_zone_cache.set_output(o.first, o.second);
     }
+}
+
 
+int ipmgr::prepare_includes()
+{
+    f_includes.str(std::string());
     f_includes
         << "// AUTO-GENERATED, DO NOT EDIT\n"
         << "\n";
@@ -2543,6 +3178,52 @@ int ipmgr::prepare_includes()
 }
 
 
+/** \brief Create the directories used by a zone.
+ *
+ * When the zones are generated by more than one worker (see `--jobs`),
+ * multiple threads may attempt to create the same group directories
+ * simultaneously. This function creates them under a lock so the
+ * file_contents objects find them already present.
+ *
+ * The lock is dedicated to the directories. The bind9 lock may be held
+ * for as long as a `systemctl stop bind9` takes, and the workers must
+ * not wait on that just to create a directory.
+ *
+ * \param[in] zone  The zone for which the directories are created.
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr::prepare_zone_directories(zone_files::pointer_t zone)
+{
+    cppthread::guard lock(f_directory_mutex);
+
+    std::string const directories[] =
+    {
+        std::string(paths::IPMGR_GENERATED) + '/' + zone->group(),
+        std::string(paths::BIND_ZONES) + '/' + zone->group(),
+        paths::BIND_DYNAMIC_ZONES,
+    };
+
+    for(auto const & d : directories)
+    {
+        std::string const dir(f_paths.resolve(d));
+        if(snapdev::mkdir_p(dir) != 0)
+        {
+            SNAP_LOG_ERROR
+                << "could not create directory \""
+                << dir
+                << "\" for zone \""
+                << zone->domain()
+                << "\"."
+                << SNAP_LOG_SEND;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
 /** \brief Generate one zone.
  *
  * This function generates one zone from the specified configuration
@@ -2550,16 +3231,26 @@ int ipmgr::prepare_includes()
  *
  * The input is a zone as read by the read_zones() function.
  *
+ * This function may be called by several zone workers simultaneously.
+ * It does not modify the configuration or includes data. Instead it
+ * marks the \p job with the information necessary for the
+ * add_zone_conf() function to do so.
+ *
+ * \param[in,out] job  The job with the zone to generate.
+ *
  * \return 0 on success, 1 on errors.
  */
-int ipmgr::generate_zone(zone_files::pointer_t & zone)
+int ipmgr::generate_zone(zone_job & job)
 {
     int r(0);
 
+    zone_files::pointer_t & zone(job.f_zone);
+
     if(!zone->retrieve_fields())
     {
         return 1;
     }
+    job.f_fields_retrieved = true;
 
     if(f_verbose)
     {
@@ -2570,191 +3261,176 @@ int ipmgr::generate_zone(zone_files::pointer_t & zone)
             << std::endl;
     }
 
-    if(f_zone_conf[zone->group()].str().empty())
+    if(f_jobs > 1)
     {
-        f_includes
-            << "include \"/etc/bind/zones/"
-            << zone->group()
-            << ".conf\";\n";
+        r = prepare_zone_directories(zone);
+        if(r != 0)
+        {
+            return r;
+        }
     }
 
-    std::string z(zone->generate_zone_file());
-    if(z.empty())
+    // the body does not depend on the serial number so we generate it
+    // only once
+    //
+    std::string const body(zone->generate_zone_body());
+    if(body.empty())
     {
         // generation failed
         //
         return 1;
     }
-
-// TODO: use a template to generate the zone_conf files (instead of the
-//       dynamic parameter, use a template=... where you can define
-//       the name of the template which gives us the parameters to use
-//       all in one place and especially editable by users and yo'd be
-//       able to create any number of templates)
-
-    // we must insert all the zones in the configuration file, even if we
-    // do not regenerate some of them because they are already up to date
-    //
-    // otherwise the .conf file would be missing those entries and that
-    // would be really bad!
-    //
-    if(f_zone_conf[zone->group()].str().empty())
-    {
-        f_zone_conf[zone->group()]
-            << "// AUTO-GENERATED FILE, DO NOT EDIT\n"
-            << "// see ipmgr(1) instead\n"
-            << "\n";
-    }
-
-    f_zone_conf[zone->group()]
-        << "zone \""
-        << zone->domain()
-        << "\" {\n"
-        << "  type master;\n"
-        << "  file \""
-            << (zone->dynamic() != zone_files::dynamic_t::DYNAMIC_STATIC
-                    ? std::string("/var/lib/bind")
-                    : "/etc/bind/zones/" + zone->group())
-            << '/'
-            << zone->domain()
-            << ".zone"
-            << "\";\n"
-        << "  allow-transfer { trusted-servers; };\n"
-
-        // at this time, I only handle our very specific update-policy needs...
-        // this needs a lot of help
-        //
-        << (zone->dynamic() == zone_files::dynamic_t::DYNAMIC_LETSENCRYPT
-                ? "  check-names warn;\n"
-                  "  update-policy {\n"
-                  "    grant letsencrypt_wildcard. name _acme-challenge." + zone->domain() + ". txt;\n"
-                  "  };\n"
-                : std::string())
-        << (zone->dynamic() == zone_files::dynamic_t::DYNAMIC_LOCAL
-                ? "  update-policy local;\n"
-                : std::string())
-        << (zone->dynamic() == zone_files::dynamic_t::DYNAMIC_BOTH
-                ? "  check-names warn;\n"
-                  "  update-policy {\n"
-                  "    grant local-ddns zonesub any;\n"
-                  "    grant letsencrypt_wildcard. name _acme-challenge." + zone->domain() + ". txt;\n"
-                  "  };\n"
-                : std::string())
-        << (zone->dynamic() != zone_files::dynamic_t::DYNAMIC_STATIC
-                ? "  max-journal-size 2M;\n"
-                : "")
-        << "};\n"
-        << "\n";
+    job.f_generated = true;
+    job.f_new_opendkim_key = zone->new_opendkim_key();
 
     // compare with existing file, if it changed, then we raise a flag
     // about that
     //
-    std::string const zone_filename("/var/lib/ipmgr/generated/" + zone->group() + "/" + zone->domain() + ".zone");
+    std::string const zone_filename(f_paths.resolve(paths::IPMGR_GENERATED) + '/' + zone->group() + '/' + zone->domain() + ".zone");
+    std::string const bind_filename(f_paths.resolve(paths::BIND_ZONES) + '/' + zone->group() + '/' + zone->domain() + ".zone");
+    std::string const dynamic_filename(f_paths.resolve(paths::BIND_DYNAMIC_ZONES) + '/' + zone->domain() + ".zone");
+
+    // for dynamic zones, keep the previous version when only the body
+    // changed so we can send the differences to bind9
+    //
+    std::string previous_zone;
 
     snapdev::file_contents file(zone_filename, true);
     if(!f_force)
     {
-        if(file.exists()
+        // the index of the last run tells us whether the zone changed
+        // without reading the file, unless --paranoid is used
+        //
+        zone_cache::output_entry const * output(f_paranoid ? nullptr : f_zone_cache.find_output(zone_filename));
+        bool rewrite(false);
+        if(output != nullptr
+        && output_unchanged(*output, zone->generate_zone_header(output->f_serial), body))
+        {
+            // the files may have been deleted or edited since; bind9
+            // rewrites the dynamic copy itself (journal sync) so that
+            // one only has to exist
+            //
+            bool const intact(zone->dynamic() == zone_files::dynamic_t::DYNAMIC_STATIC
+                    ? output_files_intact(*output, { zone_filename, bind_filename })
+                    : output_files_intact(*output, { zone_filename })
+                        && access(dynamic_filename.c_str(), F_OK) == 0);
+            if(intact)
+            {
+                job.f_outputs[zone_filename] = *output;
+                return 0;
+            }
+
+            // do not trust the previous file either, write everything again
+            //
+            rewrite = true;
+        }
+
+        // dynamic zones need the previous version to send the differences
+        // to bind9 so we have to read it anyway
+        //
+        if(!rewrite
+        && (output == nullptr
+            || zone->dynamic() != zone_files::dynamic_t::DYNAMIC_STATIC)
+        && file.exists()
         && file.read_all())
         {
             // got existing file contents, did it change?
             //
-            if(file.contents() == z)
+            // the previous header is regenerated with the previous serial
+            // so the comparison is not affected by the serial number
+            //
+            std::string const & previous(file.contents());
+            std::uint32_t const previous_serial(get_generated_serial(previous));
+            if(previous_serial != 0)
             {
-                // no changes, we're done here
-                //
-                return 0;
+                std::string const previous_header(zone->generate_zone_header(previous_serial));
+                if(previous.compare(0, previous_header.length(), previous_header) == 0)
+                {
+                    if(previous.length() == previous_header.length() + body.length()
+                    && previous.compare(previous_header.length(), body.length(), body) == 0)
+                    {
+                        // no changes, we're done here
+                        //
+                        job.f_outputs[zone_filename] = make_output_entry(previous, previous_serial);
+                        return 0;
+                    }
+
+                    if(zone->dynamic() != zone_files::dynamic_t::DYNAMIC_STATIC)
+                    {
+                        previous_zone = previous;
+                    }
+                }
             }
         }
     }
 
-    if(zone->dynamic() != zone_files::dynamic_t::DYNAMIC_STATIC)
+    // a letsencrypt zone gets frozen before its serial number is read:
+    // `rndc freeze` writes the journal to the zone file so the serial
+    // found in that file is the one bind9 has in memory
+    //
+    bool frozen(false);
+    if(zone->dynamic() == zone_files::dynamic_t::DYNAMIC_LETSENCRYPT
+    && !previous_zone.empty()
+    && access(dynamic_filename.c_str(), F_OK) == 0
+    && bind9_accepts_updates())
     {
-        stop_bind9();
+        frozen = run_command("rndc", { "freeze", zone->domain() }) == 0;
     }
 
     // the zone changed or is forcibly refreshed so increment the serial number
     //
-    if(zone->get_zone_serial(true) == 0)
+    std::uint32_t const serial(zone->get_zone_serial(true));
+    if(serial == 0)
     {
+        if(frozen)
+        {
+            snapdev::NOT_USED(run_command("rndc", { "thaw", zone->domain() }));
+        }
         return 1;
     }
 
-    z = zone->generate_zone_file();
-    if(z.empty())
+    std::string const z(zone->generate_zone_header(serial) + body);
+    if(!zone->verify_zone(z))
     {
-        // generation failed
-        //
+        if(frozen)
+        {
+            snapdev::NOT_USED(run_command("rndc", { "thaw", zone->domain() }));
+        }
         return 1;
     }
 
-    // raise flag that something changed and a restart will be required
-    //
-    // this file goes under /run so we don't take the risk of restarting
-    // again after a reboot
+    // raise flag that something changed and a reload will be required
+    // (dynamic zones cannot be reloaded, see update_dynamic_zone())
     //
-    f_bind_restart_required = true;
-    snapdev::file_contents flag(g_bind9_need_restart, true);
-    flag.contents("*** bind9 restart required ***\n");
-    if(!flag.write_all())
+    if(zone->dynamic() == zone_files::dynamic_t::DYNAMIC_STATIC)
     {
-        SNAP_LOG_MINOR
-            << "could not write to file \""
-            << g_bind9_need_restart
-            << "\": "
-            << flag.last_error()
-            << SNAP_LOG_SEND;
+        bind9_reload_zone(zone->domain());
     }
 
-    // save the new content
+    // save the new content (the files are moved in place by the
+    // commit_output() once all the zones were generated)
     //
-    file.contents(z);
-    if(!file.write_all())
+    if(!f_output_stage.stage(zone_filename, z))
     {
-        SNAP_LOG_ERROR
-            << "could not write to file \""
-            << zone_filename
-            << "\": "
-            << file.last_error()
-            << SNAP_LOG_SEND;
+        if(frozen)
+        {
+            snapdev::NOT_USED(run_command("rndc", { "thaw", zone->domain() }));
+        }
         return 1;
     }
-
-    std::string const bind_filename("/etc/bind/zones/" + zone->group() + "/" + zone->domain() + ".zone");
-    std::string const dynamic_filename("/var/lib/bind/" + zone->domain() + ".zone");
+    job.f_outputs[zone_filename] = make_output_entry(z, serial);
 
     if(zone->dynamic() == zone_files::dynamic_t::DYNAMIC_STATIC)
     {
         // if static, make sure to remove the dynamic zone file
         //
-        r = unlink(dynamic_filename.c_str());
-        if(r != 0
-        && errno != ENOENT)
-        {
-            int const e(errno);
-            SNAP_LOG_WARNING
-                << "could not delete file \""
-                << dynamic_filename
-                << "\": "
-                << e
-                << ", "
-                << strerror(e)
-                << SNAP_LOG_SEND;
-        }
+        f_output_stage.remove(dynamic_filename);
 
         // static zones also get saved under /etc/bind/zones/<group>/...
+        // (as a copy of the generated file, see --copy-mode)
         //
-
-        snapdev::file_contents bind(bind_filename, true);
-        bind.contents(z);
-        if(!bind.write_all())
+        if(!f_output_stage.stage_copy(bind_filename, zone_filename, z))
         {
-            SNAP_LOG_ERROR
-                << "could not write to static file \""
-                << bind_filename
-                << "\": "
-                << bind.last_error()
-                << SNAP_LOG_SEND;
             return 1;
         }
 
@@ -2763,89 +3439,171 @@ int ipmgr::generate_zone(zone_files::pointer_t & zone)
 
     // if dynamic, make sure to remove the static zone file
     //
-    r = unlink(bind_filename.c_str());
-    if(r != 0
-    && errno != ENOENT)
-    {
-        int const e(errno);
-        SNAP_LOG_WARNING
-            << "could not delete file \""
-            << bind_filename
-            << "\": "
-            << e
-            << ", "
-            << strerror(e)
-            << SNAP_LOG_SEND;
-    }
+    f_output_stage.remove(bind_filename);
 
     // this is a dynamic zone
     //
-    // ideally, we would want to dynamically update this zone but...
-    //
-    // (1) zones made dynamic to allow letsencrypt can get a TXT setup
-    //     but nothing else, so it's not useful
-    //
-    // (2) zones made dynamic to allow subdomain updates may have other
-    //     changes such as their SOA and at this point I don't have the
-    //     time to implement such here! (rndc can be used to update the
-    //     SOA, but I'm not too sure how you'd setup the NS and MX
-    //     fields, etc.)
+    // (1) zones made dynamic to allow letsencrypt only accept updates
+    //     of the _acme-challenge TXT records, so we freeze the zone,
+    //     rewrite the file, and thaw the zone
     //
-    // 1. new or letsencrypt dynamism only
+    // (2) zones made dynamic to allow subdomain updates get the
+    //     differences applied with one nsupdate transaction which keeps
+    //     the journals and the changes made by other updaters
     //
-    // if it is the first time we set this one up, we need to create the
-    // file under /var/lib/bind/<domain>.zone
+    // if it is the first time we set this one up, bind9 is not running,
+    // or the SOA changed, we need to create the file under
+    // /var/lib/bind/<domain>.zone from scratch
     //
-    // 2. existing
-    //
-    // it already exists, we want to just make the changes with nsupdate
+    if(!previous_zone.empty()
+    && access(dynamic_filename.c_str(), F_OK) == 0)
+    {
+        r = update_dynamic_zone(zone, previous_zone, z, frozen);
+        if(r == 0)
+        {
+            return 0;
+        }
+    }
+
+    // for the full refresh to work safely, we need to turn off the
+    // server first, otherwise it could try to update the file under
+    // our feet
     //
+    r = stop_bind9();
+    bind9_restart_required();
+    if(r != 0)
+    {
+        SNAP_LOG_ERROR
+            << "bind9 could not be stopped to rewrite dynamic zone \""
+            << zone->domain()
+            << "\"."
+            << SNAP_LOG_SEND;
+        return 1;
+    }
 
-    // as mentioned above, always refresh the whole file...
-    // and for that to work safely, we need to turn off the
-    // server first, otherwise it could try to update the file
-    // under our feet
+    // bind9 stays stopped until the file is committed
     //
-    stop_bind9();
+    std::string const owner(f_paths.relocated() ? std::string() : std::string("bind"));
+    if(!f_output_stage.stage(dynamic_filename, z, owner, owner))
+    {
+        return 1;
+    }
+
+    return 0;
+}
 
-    //if(access(dynamic_filename, F_OK) != 0
-    //|| zone->dynamic() != dynamic_t::DYNAMIC_LOCAL)
+
+/** \brief Apply the changes of a dynamic zone without stopping bind9.
+ *
+ * This function compares the previous and new versions of the zone and
+ * sends the differences to bind9:
+ *
+ * \li zones accepting local updates (`update-policy local`) get all the
+ * changes applied in a single `nsupdate -l` transaction; the journal
+ * and the records added by other updaters are kept as is;
+ * \li zones only open to letsencrypt were frozen with `rndc freeze` by
+ * the caller before their serial number was read, the file is rewritten,
+ * and the zone is thawed with `rndc thaw`.
+ *
+ * If bind9 is not running or was already stopped, or anything fails,
+ * the function returns 1 and the caller falls back to rewriting the
+ * whole file with bind9 stopped.
+ *
+ * \param[in] zone  The zone being updated.
+ * \param[in] previous  The previously generated version of the zone.
+ * \param[in] next  The newly generated version of the zone.
+ * \param[in] frozen  Whether the letsencrypt zone was frozen.
+ *
+ * \return 0 if the changes were applied, 1 otherwise.
+ */
+int ipmgr::update_dynamic_zone(
+      zone_files::pointer_t zone
+    , std::string const & previous
+    , std::string const & next
+    , bool frozen)
+{
+    if(zone->dynamic() == zone_files::dynamic_t::DYNAMIC_LETSENCRYPT)
     {
-        // case 1. file is new or we're not in LOCAL dynamism
-        //
-        snapdev::file_contents dynamic_zone(dynamic_filename, true);
-        dynamic_zone.contents(z);
-        if(!dynamic_zone.write_all())
+        if(!frozen)
         {
-            SNAP_LOG_ERROR
-                << "could not write to dynamic file \""
-                << dynamic_filename
-                << "\": "
-                << dynamic_zone.last_error()
-                << SNAP_LOG_SEND;
             return 1;
         }
-        if(snapdev::chownnm(dynamic_filename, "bind", "bind") != 0)
+
+        // the zone is only frozen for the duration of this update so the
+        // file gets committed right away instead of with the other files
+        //
+        std::string const dynamic_filename(f_paths.resolve(paths::BIND_DYNAMIC_ZONES) + '/' + zone->domain() + ".zone");
+        std::string const owner(f_paths.relocated() ? std::string() : std::string("bind"));
+        output_stage dynamic_zone;
+        if(!dynamic_zone.stage(dynamic_filename, next, owner, owner)
+        || !dynamic_zone.commit())
         {
-            SNAP_LOG_ERROR
-                << "could not set dynamic file \""
-                << dynamic_filename
-                << "\" owner and/or group to bind:bind."
-                << SNAP_LOG_SEND;
+            snapdev::NOT_USED(run_command("rndc", { "thaw", zone->domain() }));
             return 1;
         }
 
+        return run_command("rndc", { "thaw", zone->domain() });
+    }
+
+    if(!bind9_accepts_updates())
+    {
+        return 1;
+    }
+
+    zone_diff diff;
+    if(!diff.load(previous, next))
+    {
+        return 1;
+    }
+    if(diff.empty())
+    {
         return 0;
     }
 
-// at the moment this case is not handled (see comments above)
+    if(f_verbose)
+    {
+        std::cout
+            << "info: "
+            << diff.size()
+            << " RRset(s) changed in dynamic zone \""
+            << zone->domain()
+            << "\"."
+            << std::endl;
+    }
+
+    std::string const script_filename(f_paths.resolve(paths::IPMGR_RUN) + "/nsupdate-" + zone->domain() + ".txt");
+    snapdev::file_contents script(script_filename, true);
+    script.contents(diff.nsupdate_script(zone->domain()));
+    if(!script.write_all())
+    {
+        SNAP_LOG_ERROR
+            << "could not write to file \""
+            << script_filename
+            << "\": "
+            << script.last_error()
+            << SNAP_LOG_SEND;
+        return 1;
+    }
+
+    int const r(run_command("nsupdate", { "-l", script_filename }));
+    if(r != 0)
+    {
+        return r;
+    }
+
+    if(!f_dry_run)
+    {
+        snapdev::NOT_USED(unlink(script_filename.c_str()));
+    }
 
     return 0;
 }
 
 
-int ipmgr::generate_ptr_zone(zone_files::pointer_t & zone)
+int ipmgr::generate_ptr_zone(zone_job & job)
 {
+    zone_files::pointer_t & zone(job.f_zone);
+
     if(f_verbose)
     {
         std::cout
@@ -2855,18 +3613,121 @@ int ipmgr::generate_ptr_zone(zone_files::pointer_t & zone)
             << std::endl;
     }
 
-    f_includes
-        << "include \"/etc/bind/zones/"
-        << zone->get_ptr()
-        << ".ptr\";\n";
-
-    std::string z(zone->generate_ptr_file());
-    if(z.empty())
+    std::string const body(zone->generate_ptr_body());
+    if(body.empty())
     {
         // generation failed
         //
         return 1;
     }
+    job.f_ptr_generated = true;
+
+    // compare with existing file, if it changed, then we raise a flag
+    // about that
+    //
+    std::string const zone_filename(f_paths.resolve(paths::IPMGR_GENERATED) + '/' + zone->get_ptr() + ".ptr");
+    std::string const bind_filename(f_paths.resolve(paths::BIND_ZONES) + '/' + zone->get_ptr() + ".ptr");
+
+    snapdev::file_contents file(zone_filename, true);
+    if(!f_force)
+    {
+        zone_cache::output_entry const * output(f_paranoid ? nullptr : f_zone_cache.find_output(zone_filename));
+        if(output != nullptr)
+        {
+            if(output_unchanged(*output, zone->generate_ptr_header(output->f_serial), body)
+            && output_files_intact(*output, { zone_filename, bind_filename }))
+            {
+                job.f_outputs[zone_filename] = *output;
+                return 0;
+            }
+        }
+        else if(file.exists()
+             && file.read_all())
+        {
+            // got existing file contents, did it change?
+            //
+            std::string const & previous(file.contents());
+            std::uint32_t const previous_serial(get_generated_serial(previous));
+            if(previous_serial != 0
+            && previous.length() > body.length()
+            && previous.compare(previous.length() - body.length(), body.length(), body) == 0
+            && previous.compare(0, previous.length() - body.length(), zone->generate_ptr_header(previous_serial)) == 0)
+            {
+                // no changes, we're done here
+                //
+                job.f_outputs[zone_filename] = make_output_entry(previous, previous_serial);
+                return 0;
+            }
+        }
+    }
+
+    // the zone changed or is forcibly refreshed so increment the serial number
+    //
+    std::uint32_t const serial(zone->get_zone_serial(true));
+    if(serial == 0)
+    {
+        return 1;
+    }
+
+    std::string const z(zone->generate_ptr_header(serial) + body);
+
+    // raise flag that something changed and a reload will be required
+    //
+    bind9_reload_zone(zone->get_ptr_arpa());
+
+    // save the new content
+    //
+    if(!f_output_stage.stage(zone_filename, z))
+    {
+        return 1;
+    }
+    job.f_outputs[zone_filename] = make_output_entry(z, serial);
+
+    if(!f_output_stage.stage_copy(bind_filename, zone_filename, z))
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/** \brief Add the zone to the configuration and includes.
+ *
+ * This function adds the zone definition to the configuration file of
+ * its group and the include of that configuration file the first time
+ * the group is encountered. It also adds the PTR definition if one was
+ * generated for that zone.
+ *
+ * The function gets called with the jobs in the order of f_zone_files
+ * so the results are always the same whether the zones are generated
+ * by one or more workers.
+ *
+ * \param[in] job  The job that was processed.
+ */
+void ipmgr::add_zone_conf(zone_job const & job)
+{
+    zone_files::pointer_t const & zone(job.f_zone);
+
+    if(!job.f_fields_retrieved)
+    {
+        return;
+    }
+
+    if(f_zone_conf[zone->group()].str().empty())
+    {
+        f_includes
+            << "include \""
+            << paths::BIND_ZONES
+            << '/'
+            << zone->group()
+            << ".conf\";\n";
+    }
+
+    if(!job.f_generated)
+    {
+        return;
+    }
 
 // TODO: use a template to generate the zone_conf files (instead of the
 //       dynamic parameter, use a template=... where you can define
@@ -2880,6 +3741,71 @@ int ipmgr::generate_ptr_zone(zone_files::pointer_t & zone)
     // otherwise the .conf file would be missing those entries and that
     // would be really bad!
     //
+    if(f_zone_conf[zone->group()].str().empty())
+    {
+        f_zone_conf[zone->group()]
+            << "// AUTO-GENERATED FILE, DO NOT EDIT\n"
+            << "// see ipmgr(1) instead\n"
+            << "\n";
+    }
+
+    f_zone_conf[zone->group()]
+        << "zone \""
+        << zone->domain()
+        << "\" {\n"
+        << "  type master;\n"
+        << "  file \""
+            << (zone->dynamic() != zone_files::dynamic_t::DYNAMIC_STATIC
+                    ? std::string(paths::BIND_DYNAMIC_ZONES)
+                    : std::string(paths::BIND_ZONES) + '/' + zone->group())
+            << '/'
+            << zone->domain()
+            << ".zone"
+            << "\";\n"
+        << "  allow-transfer { trusted-servers; };\n"
+
+        // at this time, I only handle our very specific update-policy needs...
+        // this needs a lot of help
+        //
+        << (zone->dynamic() == zone_files::dynamic_t::DYNAMIC_LETSENCRYPT
+                ? "  check-names warn;\n"
+                  "  update-policy {\n"
+                  "    grant letsencrypt_wildcard. name _acme-challenge." + zone->domain() + ". txt;\n"
+                  "  };\n"
+                : std::string())
+        << (zone->dynamic() == zone_files::dynamic_t::DYNAMIC_LOCAL
+                ? "  update-policy local;\n"
+                : std::string())
+        << (zone->dynamic() == zone_files::dynamic_t::DYNAMIC_BOTH
+                ? "  check-names warn;\n"
+                  "  update-policy {\n"
+                  "    grant local-ddns zonesub any;\n"
+                  "    grant letsencrypt_wildcard. name _acme-challenge." + zone->domain() + ". txt;\n"
+                  "  };\n"
+                : std::string())
+        << (zone->dynamic() != zone_files::dynamic_t::DYNAMIC_STATIC
+                ? "  max-journal-size 2M;\n"
+                : "")
+        << "};\n"
+        << "\n";
+
+    if(!job.f_ptr_processed)
+    {
+        return;
+    }
+
+    f_includes
+        << "include \""
+        << paths::BIND_ZONES
+        << '/'
+        << zone->get_ptr()
+        << ".ptr\";\n";
+
+    if(!job.f_ptr_generated)
+    {
+        return;
+    }
+
     if(f_zone_conf[zone->get_ptr()].str().empty())
     {
         // this should not happen here
@@ -2895,99 +3821,295 @@ int ipmgr::generate_ptr_zone(zone_files::pointer_t & zone)
         << zone->get_ptr_arpa()
         << "\" {\n"
         << "  type master;\n"
-        << "  file \"/etc/bind/zones/"
+        << "  file \""
+        << paths::BIND_ZONES
+        << '/'
         << zone->get_ptr()
         << ".ptr\";\n"
         << "};\n";
+}
 
-    // compare with existing file, if it changed, then we raise a flag
-    // about that
-    //
-    std::string const zone_filename("/var/lib/ipmgr/generated/" + zone->get_ptr() + ".ptr");
 
-    snapdev::file_contents file(zone_filename, true);
-    if(!f_force)
+/** \brief Generate the configuration files of all the zones.
+ *
+ * This function prepares the includes and adds all the zones to the
+ * configuration files as if each one of them was successfully generated.
+ * It is used to time that phase independently of the generation of the
+ * zones themselves.
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr::generate_conf_files()
+{
+    int const r(prepare_includes());
+    if(r != 0)
     {
-        if(file.exists()
-        && file.read_all())
-        {
-            // got existing file contents, did it change?
-            //
-            if(file.contents() == z)
-            {
-                // no changes, we're done here
-                //
-                return 0;
-            }
-        }
+        return r;
     }
 
-    // the zone changed or is forcibly refreshed so increment the serial number
-    //
-    if(zone->get_zone_serial(true) == 0)
+    for(auto const & z : f_zone_files)
     {
-        return 1;
+        zone_job job;
+        job.f_zone = z.second;
+        job.f_fields_retrieved = true;
+        job.f_generated = true;
+        job.f_ptr_processed = !z.second->get_ptr().empty();
+        job.f_ptr_generated = job.f_ptr_processed;
+        add_zone_conf(job);
     }
 
-    z = zone->generate_ptr_file();
-    if(z.empty())
+    return 0;
+}
+
+
+/** \brief Raise the flag telling us that bind9 needs to be restarted.
+ *
+ * The flag is saved in a file under /run so we don't take the risk of
+ * restarting again after a reboot, but we do restart if ipmgr fails
+ * before reaching the restart_bind9() function.
+ */
+void ipmgr::bind9_restart_required()
+{
+    cppthread::guard lock(f_bind9_mutex);
+
+    if(f_bind_restart_required)
     {
-        // generation failed
-        //
-        return 1;
+        return;
     }
+    f_bind_restart_required = true;
 
-    // raise flag that something changed and a restart will be required
+    // a flag left behind by a previous run means that run failed before
+    // it could reload bind9 and we do not know which zones it changed
     //
-    // this file goes under /run so we don't take the risk of restarting
-    // again after a reboot
-    //
-    f_bind_restart_required = true;
-    snapdev::file_contents flag(g_bind9_need_restart, true);
+    std::string const flag_filename(f_paths.resolve(paths::IPMGR_BIND9_NEED_RESTART));
+    if(access(flag_filename.c_str(), F_OK) == 0)
+    {
+        f_bind9_full_restart = true;
+        return;
+    }
+
+    snapdev::file_contents flag(flag_filename, true);
     flag.contents("*** bind9 restart required ***\n");
     if(!flag.write_all())
     {
         SNAP_LOG_MINOR
             << "could not write to file \""
-            << g_bind9_need_restart
+            << flag_filename
             << "\": "
             << flag.last_error()
             << SNAP_LOG_SEND;
     }
+}
 
-    // save the new content
-    //
-    file.contents(z);
-    if(!file.write_all())
+
+/** \brief Mark a zone as changed.
+ *
+ * The zones marked as changed get reloaded with `rndc reload <zone>`
+ * instead of a full restart of bind9 whenever possible.
+ *
+ * \param[in] zone  The name of the zone as defined in the bind9
+ * configuration.
+ */
+void ipmgr::bind9_reload_zone(std::string const & zone)
+{
+    bind9_restart_required();
+
+    cppthread::guard lock(f_bind9_mutex);
+    f_bind9_reload_zones.insert(zone);
+}
+
+
+/** \brief Generate the zone and PTR zone of one job.
+ *
+ * This function generates the zone and, if the zone has a PTR, also
+ * generates the PTR zone. The result is saved in the job.
+ *
+ * \param[in,out] job  The job to process.
+ */
+void ipmgr::process_zone_job(zone_job & job)
+{
+    if(job.f_cached)
     {
-        SNAP_LOG_ERROR
-            << "could not write to file \""
-            << zone_filename
-            << "\": "
-            << file.last_error()
-            << SNAP_LOG_SEND;
-        return 1;
+        return;
     }
 
-    std::string const bind_filename("/etc/bind/zones/" + zone->get_ptr() + ".ptr");
+    job.f_result = generate_zone(job);
+    if(job.f_result == 0
+    && !job.f_zone->get_ptr().empty())
+    {
+        job.f_ptr_processed = true;
+        job.f_ptr_result = generate_ptr_zone(job);
+    }
+}
+
 
-    snapdev::file_contents bind(bind_filename, true);
-    bind.contents(z);
-    if(!bind.write_all())
+/** \brief Retrieve the next job to process.
+ *
+ * This function returns a pointer to the next job to process. The jobs
+ * are returned in order. Once a job failed, no more jobs are returned
+ * so we do not do more work than a serial run would do.
+ *
+ * \return The next job or nullptr when no more jobs are to be processed.
+ */
+ipmgr::zone_job * ipmgr::next_zone_job()
+{
+    cppthread::guard lock(f_job_mutex);
+
+    if(f_zone_job_failed
+    || f_next_zone_job >= f_zone_jobs.size())
     {
-        SNAP_LOG_ERROR
-            << "could not write to static file \""
-            << bind_filename
-            << "\": "
-            << bind.last_error()
-            << SNAP_LOG_SEND;
-        return 1;
+        return nullptr;
+    }
+
+    zone_job * job(&f_zone_jobs[f_next_zone_job]);
+    ++f_next_zone_job;
+    return job;
+}
+
+
+/** \brief Mark a job as done.
+ *
+ * If the job failed, this function prevents any further jobs from being
+ * started.
+ *
+ * \param[in] job  The job that just completed.
+ */
+void ipmgr::zone_job_done(zone_job const & job)
+{
+    if(job.f_result != 0)
+    {
+        cppthread::guard lock(f_job_mutex);
+        f_zone_job_failed = true;
+    }
+}
+
+
+/** \brief A zone worker.
+ *
+ * When more than one job is requested (see `--jobs`), the zones get
+ * generated by this worker. It retrieves the next available job and
+ * processes it until no more jobs are available.
+ */
+class ipmgr::zone_worker
+    : public cppthread::runner
+{
+public:
+    typedef std::shared_ptr<zone_worker>    pointer_t;
+
+                            zone_worker(ipmgr * manager);
+
+    virtual void            run() override;
+
+private:
+    ipmgr *                 f_manager = nullptr;
+};
+
+
+ipmgr::zone_worker::zone_worker(ipmgr * manager)
+    : runner("zone-worker")
+    , f_manager(manager)
+{
+}
+
+
+void ipmgr::zone_worker::run()
+{
+    for(;;)
+    {
+        zone_job * job(f_manager->next_zone_job());
+        if(job == nullptr)
+        {
+            return;
+        }
+        f_manager->process_zone_job(*job);
+        f_manager->zone_job_done(*job);
+    }
+}
+
+
+/** \brief Generate all the zones.
+ *
+ * This function starts the zone workers and waits for them to be done.
+ * The current thread is also used as one of the workers so when `--jobs`
+ * is 1 (the default), no threads get created.
+ *
+ * \return 0 if the workers ran, 1 otherwise.
+ */
+int ipmgr::process_zone_jobs()
+{
+    std::size_t const count(std::min(f_jobs, f_zone_jobs.size()));
+
+    std::vector<zone_worker::pointer_t> workers;
+    std::vector<cppthread::thread::pointer_t> threads;
+    for(std::size_t idx(1); idx < count; ++idx)
+    {
+        zone_worker::pointer_t w(std::make_shared<zone_worker>(this));
+        cppthread::thread::pointer_t t(std::make_shared<cppthread::thread>("zone-worker", w.get()));
+        if(!t->start())
+        {
+            // the other workers will take over
+            //
+            SNAP_LOG_WARNING
+                << "could not start zone worker #"
+                << idx
+                << "."
+                << SNAP_LOG_SEND;
+            break;
+        }
+        workers.push_back(w);
+        threads.push_back(t);
+    }
+
+    if(f_verbose
+    && count > 1)
+    {
+        std::cout
+            << "info: generating zones with "
+            << threads.size() + 1
+            << " jobs."
+            << std::endl;
+    }
+
+    zone_worker w(this);
+    w.run();
+
+    for(auto & t : threads)
+    {
+        t->stop();
     }
 
     return 0;
 }
 
 
+/** \brief Save a configuration file if it changed.
+ *
+ * This function compares \p contents with the existing file. If it is
+ * different, the file gets overwritten and bind9 will be asked to
+ * reload its configuration (`rndc reconfig`).
+ *
+ * \param[in] filename  The name of the configuration file.
+ * \param[in] contents  The new contents of the configuration file.
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr::save_conf_file(std::string const & filename, std::string const & contents)
+{
+    snapdev::file_contents conf(filename, true);
+    if(conf.exists()
+    && conf.read_all()
+    && conf.contents() == contents)
+    {
+        return 0;
+    }
+
+    f_bind9_reconfig_required = true;
+    bind9_restart_required();
+
+    return f_output_stage.stage(filename, contents) ? 0 : 1;
+}
+
+
 /** \brief Save the configuration files.
  *
  * Each group of zones is given a configuration file with the bind syntax
@@ -3002,32 +4124,34 @@ int ipmgr::save_conf_files()
 {
     for(auto & ss : f_zone_conf)
     {
-        std::string conf_filename("/etc/bind/zones/");
+        std::string conf_filename(f_paths.resolve(paths::BIND_ZONES));
+        conf_filename += '/';
         conf_filename += ss.first;
         conf_filename += ".conf";
 
-        snapdev::file_contents conf(conf_filename, true);
-        conf.contents(ss.second.str());
-        if(!conf.write_all())
+        int const r(save_conf_file(conf_filename, ss.second.str()));
+        if(r != 0)
         {
-            SNAP_LOG_ERROR
-                << "could not write to file \""
-                << conf_filename
-                << "\": "
-                << conf.last_error()
-                << SNAP_LOG_SEND;
-            return 1;
+            return r;
         }
     }
 
-    return 0;
+    return save_conf_file(f_paths.resolve(paths::BIND_OPTIONS), f_includes.str());
 }
 
 
-/** \brief Process the input files one at a time.
+/** \brief Process the input files.
  *
  * This function reads the list of zone files to be processed using
- * a glob and then it processes them one by one.
+ * a glob and then it processes them one by one or concurrently when
+ * `--jobs` is larger than 1.
+ *
+ * The generated .conf and includes files are the same whatever the
+ * number of jobs since they get merged in order once all the zones
+ * were processed.
+ *
+ * Zones whose fingerprint did not change since the last run are not
+ * generated at all unless `--force` is used.
  *
  * \return 0 if no error occurred, 1 otherwise.
  */
@@ -3041,30 +4165,236 @@ int ipmgr::process_zones()
         return r;
     }
 
-    r = prepare_includes();
-    if(r != 0)
+    r = prepare_includes();
+    if(r != 0)
+    {
+        return r;
+    }
+
+    std::uint64_t const options(options_fingerprint());
+    f_zone_jobs.reserve(f_zone_files.size());
+    for(auto & z : f_zone_files)
+    {
+        f_zone_jobs.emplace_back();
+        zone_job & job(f_zone_jobs.back());
+        job.f_zone = z.second;
+
+        // the fingerprint of a zone includes its configuration files,
+        // the global options, and the OpenDKIM key
+        //
+        job.f_fingerprint = fnv1a_64(&options, sizeof(options), z.second->fingerprint());
+        struct stat st = {};
+        if(stat((f_paths.resolve(paths::OPENDKIM) + '/' + z.first + ".key/mail.txt").c_str(), &st) == 0)
+        {
+            std::int64_t const key_info[3] =
+            {
+                st.st_mtim.tv_sec,
+                st.st_mtim.tv_nsec,
+                st.st_size,
+            };
+            job.f_fingerprint = fnv1a_64(key_info, sizeof(key_info), job.f_fingerprint);
+        }
+
+        if(!f_force)
+        {
+            restore_zone(z.first, job);
+        }
+    }
+
+    r = process_zone_jobs();
+    if(r != 0)
+    {
+        return r;
+    }
+
+    int result(0);
+    for(auto const & job : f_zone_jobs)
+    {
+        add_zone_conf(job);
+        if(job.f_result != 0)
+        {
+            result = job.f_result;
+            break;
+        }
+        cache_zone(job);
+    }
+
+    // the new OpenDKIM keys exist even if their zone failed so the
+    // tables are always updated
+    //
+    r = save_opendkim_tables();
+    if(result == 0)
+    {
+        result = r;
+    }
+
+    // the configuration files only get updated if all the zones are valid
+    //
+    if(result == 0)
+    {
+        result = save_conf_files();
+    }
+
+    // the zones that were successfully generated get saved even on
+    // failures; if that fails, we do not save the cache so all these
+    // zones get generated again on the next run
+    //
+    r = commit_output();
+    if(r != 0)
+    {
+        return r;
+    }
+
+    // save the cache even on failures so the zones that were successfully
+    // generated are not generated again on the next run; the others were
+    // not added to the cache so they will be
+    //
+    if(!f_dry_run)
+    {
+        f_zone_cache.save();
+    }
+
+    return result;
+}
+
+
+/** \brief Add the OpenDKIM keys to the OpenDKIM tables.
+ *
+ * The zone workers generate the missing OpenDKIM keys. Once all the
+ * zones were processed, this function loads the `signing_table` and
+ * `key_table` files once and makes sure that each zone generated in
+ * this run with an OpenDKIM key has its entries (exact match on the
+ * domain name and key identifier; see opendkim_table). This also
+ * repairs the tables if a previous run failed before saving them.
+ *
+ * The tables are staged and written along the zones (see
+ * commit_output()), and only if they changed.
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr::save_opendkim_tables()
+{
+    std::string const opendkim_path(f_paths.resolve(paths::OPENDKIM));
+
+    opendkim_table signing_table(opendkim_path + "/signing_table");
+    opendkim_table key_table(opendkim_path + "/key_table");
+    bool loaded(false);
+    bool new_key(false);
+    for(auto const & job : f_zone_jobs)
+    {
+        if(!job.f_generated)
+        {
+            continue;
+        }
+        std::string const selector(job.f_zone->get_opendkim_selector());
+        if(selector.empty())
+        {
+            continue;
+        }
+
+        // in a dry run, a new key is not actually created
+        //
+        std::string const domain(job.f_zone->domain());
+        std::string const key_path(std::string(paths::OPENDKIM) + '/' + domain + ".key");
+        if(access(f_paths.resolve(key_path + "/mail.txt").c_str(), F_OK) != 0)
+        {
+            continue;
+        }
+
+        if(!loaded)
+        {
+            loaded = true;
+            if(!signing_table.load())
+            {
+                SNAP_LOG_WARNING
+                    << "\""
+                    << signing_table.filename()
+                    << "\" includes invalid lines; they are kept as is."
+                    << SNAP_LOG_SEND;
+            }
+            if(!key_table.load())
+            {
+                SNAP_LOG_WARNING
+                    << "\""
+                    << key_table.filename()
+                    << "\" includes invalid lines; they are kept as is."
+                    << SNAP_LOG_SEND;
+            }
+        }
+
+        std::string const key_id(selector + "._domainkey." + domain);
+        signing_table.set(domain, key_id);
+        key_table.set(key_id, domain + ':' + selector + ':' + key_path + "/mail.private");
+
+        new_key = new_key || job.f_new_opendkim_key;
+    }
+
+    if(signing_table.modified()
+    && !f_output_stage.stage(signing_table.filename(), signing_table.to_string()))
+    {
+        return 1;
+    }
+
+    if(key_table.modified()
+    && !f_output_stage.stage(key_table.filename(), key_table.to_string()))
+    {
+        return 1;
+    }
+
+    if(new_key
+    || signing_table.modified()
+    || key_table.modified())
+    {
+        snapdev::file_contents flag(f_paths.resolve(paths::IPMGR_OPENDKIM_NEED_RESTART), true);
+        flag.contents("*** opendkim restart required ***\n");
+        if(!flag.write_all())
+        {
+            SNAP_LOG_MINOR
+                << "could not write to file \""
+                << flag.filename()
+                << "\": "
+                << flag.last_error()
+                << SNAP_LOG_SEND;
+        }
+    }
+
+    return 0;
+}
+
+
+/** \brief Move the generated files in place.
+ *
+ * The zones and configuration files generated by this run were saved
+ * in temporary files. This function moves them all in place at once
+ * (see output_stage for details).
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr::commit_output()
+{
+    if(f_verbose)
     {
-        return r;
+        std::cout
+            << "info: saving "
+            << f_output_stage.size()
+            << " generated file(s)."
+            << std::endl;
     }
 
-    for(auto & z : f_zone_files)
+    // the serial numbers must be on disk before the zones using them
+    //
+    if(!f_serial_store->sync())
     {
-        r = generate_zone(z.second);
-        if(r != 0)
-        {
-            return r;
-        }
-
-        if(!z.second->get_ptr().empty())
-        {
-            generate_ptr_zone(z.second);
-        }
+        f_output_stage.rollback();
+        return 1;
     }
 
-    r = save_conf_files();
-    if(r != 0)
+    if(!f_output_stage.commit())
     {
-        return r;
+        SNAP_LOG_ERROR
+            << "some of the generated files could not be saved."
+            << SNAP_LOG_SEND;
+        return 1;
     }
 
     return 0;
@@ -3073,10 +4403,8 @@ int ipmgr::process_zones()
 
 int ipmgr::process_opendmarc()
 {
-    bool changed(false);
-
-    std::string cmd("edit-config --no-warning --space /etc/opendmarc.conf TrustedAuthservIDs ");
-    bool has_trusted_mail(false);
+    std::string const opendmarc_conf(f_paths.resolve(paths::OPENDMARC_CONF));
+    std::string trusted_list;
     std::string auth_server_id;
     for(auto & z : f_zone_files)
     {
@@ -3101,39 +4429,28 @@ int ipmgr::process_opendmarc()
                     return 1;
                 }
             }
-            if(has_trusted_mail)
-            {
-                cmd += ',';
-            }
-            else
+            if(!trusted_list.empty())
             {
-                has_trusted_mail = true;
+                trusted_list += ',';
             }
-            cmd += trusted;
+            trusted_list += trusted;
         }
     }
-    if(has_trusted_mail)
+    // edit-config does not tell us whether it changed the file so we
+    // compare the contents before and after the edits
+    //
+    snapdev::file_contents previous(opendmarc_conf);
+    snapdev::NOT_USED(previous.read_all());
+
+    if(!trusted_list.empty())
     {
-        if(f_verbose)
-        {
-            std::cout
-                << "info: "
-                << cmd
-                << std::endl;
-        }
-        if(!f_dry_run)
+        int const r(run_command("edit-config", { "--no-warning", "--space", opendmarc_conf, "TrustedAuthservIDs", trusted_list }));
+        if(r != 0)
         {
-            int const r(system(cmd.c_str()));
-            if(r != 0)
-            {
-                SNAP_LOG_ERROR
-                    << "updating the opendmarc configuration file with the list of trusted mail servers failed \""
-                    << cmd
-                    << "\"."
-                    << SNAP_LOG_SEND;
-                return r;
-            }
-            changed = true;
+            SNAP_LOG_ERROR
+                << "updating the opendmarc configuration file with the list of trusted mail servers failed."
+                << SNAP_LOG_SEND;
+            return r;
         }
     }
 
@@ -3148,40 +4465,32 @@ int ipmgr::process_opendmarc()
         // this should be the MTA name (i.e. we shouldn't have to have
         // the user define which entry is the authoritative one)
         //
-        cmd = "edit-config --space /etc/opendmarc.conf AuthservID ";
-        cmd += auth_server_id;
-        if(f_verbose)
-        {
-            std::cout
-                << "info: "
-                << cmd
-                << std::endl;
-        }
-        if(!f_dry_run)
+        int const r(run_command("edit-config", { "--space", opendmarc_conf, "AuthservID", auth_server_id }));
+        if(r != 0)
         {
-            int const r(system(cmd.c_str()));
-            if(r != 0)
-            {
-                SNAP_LOG_ERROR
-                    << "updating the opendmarc configuration file with the list of trusted mail servers failed: \""
-                    << cmd
-                    << "\"."
-                    << SNAP_LOG_SEND;
-                return r;
-            }
-            changed = true;
+            SNAP_LOG_ERROR
+                << "updating the opendmarc configuration file with the authoritative mail server failed."
+                << SNAP_LOG_SEND;
+            return r;
         }
     }
 
-    if(changed)
+    if(f_dry_run)
+    {
+        return 0;
+    }
+
+    snapdev::file_contents current(opendmarc_conf);
+    snapdev::NOT_USED(current.read_all());
+    if(current.contents() != previous.contents())
     {
-        snapdev::file_contents flag(g_opendmarc_need_restart, true);
+        snapdev::file_contents flag(f_paths.resolve(paths::IPMGR_OPENDMARC_NEED_RESTART), true);
         flag.contents("*** opendmarc restart required ***\n");
         if(!flag.write_all())
         {
             SNAP_LOG_MINOR
                 << "could not write to file \""
-                << g_opendmarc_need_restart
+                << flag.filename()
                 << "\": "
                 << flag.last_error()
                 << SNAP_LOG_SEND;
@@ -3192,63 +4501,80 @@ int ipmgr::process_opendmarc()
 }
 
 
-int ipmgr::bind9_is_active()
+/** \brief Check whether services are active.
+ *
+ * The `systemctl is-active` commands of all the \p services run
+ * concurrently.
+ *
+ * \param[in] services  The names of the services to check.
+ * \param[out] active  Whether each service is active.
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr::services_are_active(advgetopt::string_list_t const & services, std::vector<bool> & active)
 {
-    // we must check only once because we may get called more than once
-    // and the stop_bind9() may get called in between...
-    //
-    if(f_bind9_is_active != active_t::ACTIVE_NOT_TESTED)
-    {
-        return 0;
-    }
-
-    // we do not want to force a stop & start if the process is not currently
-    // active (i.e. it may have been stopped by the user for a while)
-    //
-    cppprocess::process is_active_process("bind9-is-active?");
-    is_active_process.set_command("systemctl");
-    is_active_process.add_argument("is-active");
-    is_active_process.add_argument("bind9");
-
-    cppprocess::io_capture_pipe::pointer_t output(std::make_shared<cppprocess::io_capture_pipe>());
-    is_active_process.set_output_io(output);
-
-    if(f_verbose)
-    {
-        std::cout
-            << "info: "
-            << is_active_process.get_command_line()
-            << std::endl;
-    }
+    active.clear();
 
-    if(!f_dry_run)
+    std::list<process_runner> is_active;
+    for(auto const & s : services)
     {
-        if(is_active_process.start() != 0)
+        is_active.emplace_back("systemctl", process_runner::args_t{ "is-active", s });
+        if(!start_command(is_active.back()))
         {
-            SNAP_LOG_FATAL
-                << "could not start \""
-                << is_active_process.get_command_line()
-                << "\"."
-                << SNAP_LOG_SEND;
             return 1;
         }
-        int const r(is_active_process.wait());
+    }
+
+    for(auto & p : is_active)
+    {
+        int const r(wait_command(p));
         if(r != 0
         && r != 3)  // 3 is returned if the unit is not active
         {
             SNAP_LOG_FATAL
                 << "command \""
-                << is_active_process.get_command_line()
+                << p.get_command_line()
                 << "\" returned an error (exit code "
                 << r
                 << ")."
                 << SNAP_LOG_SEND;
             return 1;
         }
+        active.push_back(snapdev::trim_string(p.output()) == "active");
+    }
+
+    return 0;
+}
+
+
+int ipmgr::bind9_is_active()
+{
+    // we must check only once because we may get called more than once
+    // and the stop_bind9() may get called in between...
+    //
+    if(f_bind9_is_active != active_t::ACTIVE_NOT_TESTED)
+    {
+        return 0;
+    }
+
+    // the bind9 service does not use the files of a relocated tree
+    //
+    if(f_paths.relocated())
+    {
+        f_bind9_is_active = active_t::ACTIVE_NO;
+        return 0;
     }
 
-    std::string const active(snapdev::trim_string(output->get_output(true)));
-    f_bind9_is_active = active == "active"
+    // we do not want to force a stop & start if the process is not currently
+    // active (i.e. it may have been stopped by the user for a while)
+    //
+    std::vector<bool> active;
+    int const r(services_are_active({ "bind9" }, active));
+    if(r != 0)
+    {
+        return r;
+    }
+    f_bind9_is_active = active[0]
                             ? active_t::ACTIVE_YES
                             : active_t::ACTIVE_NO;
 
@@ -3259,10 +4585,35 @@ int ipmgr::bind9_is_active()
 }
 
 
+/** \brief Check whether bind9 can receive updates of dynamic zones.
+ *
+ * bind9 must be running and not stopped by a zone worker.
+ *
+ * \return true if bind9 accepts `rndc` and `nsupdate` commands.
+ */
+bool ipmgr::bind9_accepts_updates()
+{
+    cppthread::guard lock(f_bind9_mutex);
+
+    if(f_stopped_bind9)
+    {
+        return false;
+    }
+
+    return bind9_is_active() == 0
+        && f_bind9_is_active == active_t::ACTIVE_YES;
+}
+
+
 int ipmgr::stop_bind9()
 {
     int r(0);
 
+    // zone workers may call this function simultaneously; the first one
+    // stops bind9 and the others wait until that is done
+    //
+    cppthread::guard lock(f_bind9_mutex);
+
     // make sure we try to stop only once (it's rather slow to repeat this
     // call otherwise even if it's safe)
     //
@@ -3284,26 +4635,13 @@ int ipmgr::stop_bind9()
 
     // stop the DNS server
     //
-    char const * cmd("systemctl stop bind9");
-    if(f_verbose)
-    {
-        std::cout
-            << "info: "
-            << cmd
-            << std::endl;
-    }
-    if(!f_dry_run)
+    r = run_command("systemctl", { "stop", "bind9" });
+    if(r != 0)
     {
-        r = system(cmd);
-        if(r != 0)
-        {
-            SNAP_LOG_FATAL
-                << "could not stop the bind9 process (systemctl exit value: "
-                << r
-                << ")"
-                << SNAP_LOG_SEND;
-            return r;
-        }
+        SNAP_LOG_FATAL
+            << "could not stop the bind9 process."
+            << SNAP_LOG_SEND;
+        return r;
     }
 
     return 0;
@@ -3314,28 +4652,178 @@ int ipmgr::start_bind9()
 {
     // start the DNS server
     //
-    char const * cmd("systemctl start bind9");
+    int const r(run_command("systemctl", { "start", "bind9" }));
+    if(r != 0)
+    {
+        SNAP_LOG_FATAL
+            << "could not start the bind9 process."
+            << SNAP_LOG_SEND;
+        return r;
+    }
+
+    return 0;
+}
+
+
+/** \brief Start a command.
+ *
+ * In verbose mode, the command line is printed. In a dry run, the
+ * command is not started.
+ *
+ * \param[in] command  The command to start.
+ *
+ * \return true if the command was started (or in a dry run).
+ */
+bool ipmgr::start_command(process_runner & command)
+{
     if(f_verbose)
     {
         std::cout
             << "info: "
-            << cmd
+            << command.get_command_line()
             << std::endl;
     }
-    if(!f_dry_run)
+
+    if(f_dry_run)
+    {
+        return true;
+    }
+
+    if(!command.start())
+    {
+        SNAP_LOG_ERROR
+            << "could not start \""
+            << command.get_command_line()
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    return true;
+}
+
+
+/** \brief Wait for a command started with start_command().
+ *
+ * \param[in] command  The command to wait on.
+ *
+ * \return The exit code of the command, -1 if it failed or timed out,
+ * and 0 in a dry run.
+ */
+int ipmgr::wait_command(process_runner & command)
+{
+    if(f_dry_run)
+    {
+        return 0;
+    }
+
+    int const r(command.wait());
+    if(command.timed_out())
+    {
+        SNAP_LOG_ERROR
+            << "command \""
+            << command.get_command_line()
+            << "\" timed out."
+            << SNAP_LOG_SEND;
+    }
+
+    return r;
+}
+
+
+/** \brief Run a bind9 command with the specified arguments.
+ *
+ * This function runs commands such as `rndc`, used to ask bind9 to
+ * reload its configuration or a specific zone without a restart, and
+ * `nsupdate`, used to update dynamic zones. The command is not run
+ * through a shell so the arguments are passed as is.
+ *
+ * \param[in] command  The name of the command to run.
+ * \param[in] args  The arguments to pass to the command.
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr::run_command(std::string const & command, advgetopt::string_list_t const & args)
+{
+    process_runner runner(command, args);
+    if(!start_command(runner))
+    {
+        return 1;
+    }
+
+    int const r(wait_command(runner));
+    if(r != 0)
+    {
+        SNAP_LOG_ERROR
+            << "command \""
+            << runner.get_command_line()
+            << "\" returned an error (exit code "
+            << r
+            << "): "
+            << snapdev::trim_string(runner.error())
+            << SNAP_LOG_SEND;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/** \brief Reload the zones that changed.
+ *
+ * When only static zones changed, bind9 does not need to be restarted.
+ * Instead, the zones that changed get reloaded one by one with
+ * `rndc reload <zone>` and, when the configuration files changed (i.e.
+ * a zone was added or removed), `rndc reconfig` is used first.
+ *
+ * If bind9 is not active, nothing happens. It will load the new files
+ * when it gets started.
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr::reload_bind9()
+{
+    int r(bind9_is_active());
+    if(r != 0)
+    {
+        return r;
+    }
+    if(f_bind9_is_active != active_t::ACTIVE_YES)
+    {
+        return 0;
+    }
+
+    std::chrono::steady_clock::time_point const start(std::chrono::steady_clock::now());
+
+    if(f_bind9_reconfig_required)
     {
-        int const r(system(cmd));
+        r = run_command("rndc", { "reconfig" });
+        if(r != 0)
+        {
+            return r;
+        }
+    }
+
+    for(auto const & zone : f_bind9_reload_zones)
+    {
+        r = run_command("rndc", { "reload", zone });
         if(r != 0)
         {
-            SNAP_LOG_FATAL
-                << "could not start the bind9 process (systemctl exit value: "
-                << r
-                << ")."
-                << SNAP_LOG_SEND;
             return r;
         }
     }
 
+    std::chrono::steady_clock::duration const latency(std::chrono::steady_clock::now() - start);
+    SNAP_LOG_INFO
+        << "bind9 reloaded "
+        << f_bind9_reload_zones.size()
+        << " zone(s)"
+        << (f_bind9_reconfig_required ? " and its configuration" : "")
+        << " in "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(latency).count()
+        << "ms."
+        << SNAP_LOG_SEND;
+
     return 0;
 }
 
@@ -3345,23 +4833,60 @@ int ipmgr::start_bind9()
  * This function checks whether the bind9 service needs to be restarted.
  * If so, then it checks whether it is currently active. If a restart is
  * not necessary or the service is not currently active, nothing happens.
- * Otherwise, it stops the process, removes all the .jnl files, and
- * finally restarts the process.
+ *
+ * When only static zones and configuration files changed, the zones
+ * are reloaded with rndc (see reload_bind9()). Otherwise (dynamic zones
+ * were rewritten, a previous run failed before bind9 was reloaded, or
+ * the reload itself failed), it stops the process, removes all the .jnl
+ * files, and finally restarts the process.
  *
  * \return 0 or 1 as the main() function expects
  */
 int ipmgr::restart_bind9()
 {
     int r(0);
+    std::string const flag_filename(f_paths.resolve(paths::IPMGR_BIND9_NEED_RESTART));
 
-    // restart necessary?
+    // restart necessary? (if we stopped bind9, it has to be started
+    // again whatever happened)
     //
-    if(!f_bind_restart_required)
+    if(!f_bind_restart_required
+    && !f_stopped_bind9)
+    {
+        if(access(flag_filename.c_str(), F_OK) != 0)
+        {
+            return 0;
+        }
+
+        // a previous run failed before bind9 was reloaded, we do not
+        // know which zones changed
+        //
+        f_bind9_full_restart = true;
+    }
+
+    if(!f_stopped_bind9
+    && !f_bind9_full_restart)
     {
-        if(access(g_bind9_need_restart, F_OK) != 0)
+        r = reload_bind9();
+        if(r == 0)
         {
+            if(f_verbose)
+            {
+                std::cout
+                    << "info: rm -f "
+                    << flag_filename
+                    << std::endl;
+            }
+            if(!f_dry_run)
+            {
+                snapdev::NOT_USED(unlink(flag_filename.c_str()));
+            }
             return 0;
         }
+
+        SNAP_LOG_WARNING
+            << "reloading the zones failed, falling back to a full restart of bind9."
+            << SNAP_LOG_SEND;
     }
 
     r = stop_bind9();
@@ -3376,29 +4901,38 @@ int ipmgr::restart_bind9()
         //
         if(!f_dry_run)
         {
-            snapdev::NOT_USED(unlink(g_bind9_need_restart));
+            snapdev::NOT_USED(unlink(flag_filename.c_str()));
         }
         return 0;
     }
 
     // clear the journals
     //
-    char const * clear_journals("rm -f /var/lib/bind/*.jnl");
+    std::string const journals(f_paths.resolve(paths::BIND_DYNAMIC_ZONES) + "/*.jnl");
     if(f_verbose)
     {
         std::cout
-            << "info: "
-            << clear_journals
+            << "info: rm -f "
+            << journals
             << std::endl;
     }
     if(!f_dry_run)
     {
-        r = system(clear_journals);
-        if(r != 0)
+        snapdev::glob_to_list<std::vector<std::string>> glob;
+        if(glob.read_path<snapdev::glob_to_list_flag_t::GLOB_FLAG_IGNORE_ERRORS>(journals))
         {
-            SNAP_LOG_WARNING
-                << "could not delete the journal (.jnl) files."
-                << SNAP_LOG_SEND;
+            for(auto const & j : glob)
+            {
+                if(unlink(j.c_str()) != 0
+                && errno != ENOENT)
+                {
+                    SNAP_LOG_WARNING
+                        << "could not delete the journal file \""
+                        << j
+                        << "\"."
+                        << SNAP_LOG_SEND;
+                }
+            }
         }
     }
 
@@ -3414,229 +4948,304 @@ int ipmgr::restart_bind9()
     {
         std::cout
             << "info: rm -f "
-            << g_bind9_need_restart
+            << flag_filename
             << std::endl;
     }
     if(!f_dry_run)
     {
         // ignore errors on this one
         //
-        snapdev::NOT_USED(unlink(g_bind9_need_restart));
+        snapdev::NOT_USED(unlink(flag_filename.c_str()));
     }
 
     return 0;
 }
 
 
-int ipmgr::restart_opendkim()
+/** \brief Restart the mail services.
+ *
+ * When the OpenDKIM keys or the OpenDMARC configuration changed, a flag
+ * file requests a restart of the corresponding service. Services that
+ * are not currently active are not restarted (i.e. they may have been
+ * stopped by the user for a while).
+ *
+ * The services are independent so they get checked and restarted
+ * concurrently.
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr::restart_mail_services()
 {
-    int r(0);
-
-    // restart necessary?
+    // the mail services do not use the files of a relocated tree
     //
-    if(access(g_opendkim_need_restart, F_OK) != 0)
+    if(f_paths.relocated())
     {
         return 0;
     }
 
-    // we do not want to force a restart if opendkim is not currently
-    // active (i.e. it may have been stopped by the user for a while)
+    // restart necessary?
     //
-    cppprocess::process is_active_process("opendkim-is-active?");
-    is_active_process.set_command("systemctl");
-    is_active_process.add_argument("is-active");
-    is_active_process.add_argument("opendkim");
-
-    cppprocess::io_capture_pipe::pointer_t output(std::make_shared<cppprocess::io_capture_pipe>());
-    is_active_process.set_output_io(output);
+    advgetopt::string_list_t services;
+    advgetopt::string_list_t flags;
+    std::pair<char const *, char const *> const mail_services[] =
+    {
+        { "opendkim", paths::IPMGR_OPENDKIM_NEED_RESTART },
+        { "opendmarc", paths::IPMGR_OPENDMARC_NEED_RESTART },
+    };
+    for(auto const & s : mail_services)
+    {
+        std::string const flag_filename(f_paths.resolve(s.second));
+        if(access(flag_filename.c_str(), F_OK) == 0)
+        {
+            services.push_back(s.first);
+            flags.push_back(flag_filename);
+        }
+    }
+    if(services.empty())
+    {
+        return 0;
+    }
 
-    if(f_verbose)
+    std::vector<bool> active;
+    int r(services_are_active(services, active));
+    if(r != 0)
     {
-        std::cout
-            << "info: "
-            << is_active_process.get_command_line()
-            << std::endl;
+        return r;
     }
 
-    if(!f_dry_run)
+    std::list<process_runner> restarts;
+    std::vector<std::string> restarted_flags;
+    for(std::size_t idx(0); idx < services.size(); ++idx)
     {
-        if(is_active_process.start() != 0)
+        if(!active[idx])
         {
-            SNAP_LOG_FATAL
-                << "could not start \""
-                << is_active_process.get_command_line()
-                << "\"."
-                << SNAP_LOG_SEND;
-            return 1;
+            continue;
         }
-        r = is_active_process.wait();
-        if(r != 0
-        && r != 3)  // 3 is returned if the unit is not active
+        restarts.emplace_back("systemctl", process_runner::args_t{ "restart", services[idx] });
+        restarted_flags.push_back(flags[idx]);
+        if(!start_command(restarts.back()))
+        {
+            restarts.pop_back();
+            restarted_flags.pop_back();
+            r = 1;
+        }
+    }
+
+    auto flag(restarted_flags.begin());
+    for(auto & p : restarts)
+    {
+        int const exit_code(wait_command(p));
+        if(exit_code != 0)
         {
             SNAP_LOG_FATAL
-                << "command \""
-                << is_active_process.get_command_line()
-                << "\" returned an error (exit code "
-                << r
+                << "could not restart the service (\""
+                << p.get_command_line()
+                << "\" exit value: "
+                << exit_code
                 << ")."
                 << SNAP_LOG_SEND;
-            return 1;
+            r = 1;
         }
+        else
+        {
+            // remove the flag telling us that the restart was requested
+            //
+            if(f_verbose)
+            {
+                std::cout
+                    << "info: rm -f "
+                    << *flag
+                    << std::endl;
+            }
+            if(!f_dry_run)
+            {
+                // ignore errors on this one
+                //
+                snapdev::NOT_USED(unlink(flag->c_str()));
+            }
+        }
+        ++flag;
     }
 
-    std::string const active(snapdev::trim_string(output->get_output(true)));
-    if(active != "active")
+    return r;
+}
+
+
+/** \brief Process the zones and restart the services.
+ *
+ * This function processes all the zones and, if anything changed,
+ * restarts the affected services.
+ *
+ * If bind9 was stopped while processing the zones, it gets started
+ * again even when the processing fails.
+ *
+ * \return 0 on success, 1 on errors.
+ */
+int ipmgr::process()
+{
+    int r(process_zones());
+    if(r == 0)
     {
-        return 0;
+        r = process_opendmarc();
     }
 
-    // stop the DNS server
+    // a zone worker may have stopped bind9 to rewrite a dynamic zone;
+    // it must be started again even if another zone failed
     //
-    char const * cmd("systemctl restart opendkim");
-    if(f_verbose)
-    {
-        std::cout
-            << "info: "
-            << cmd
-            << std::endl;
-    }
-    if(!f_dry_run)
+    if(r == 0
+    || f_stopped_bind9)
     {
-        r = system(cmd);
-        if(r != 0)
+        int const restart(restart_bind9());
+        if(r == 0)
         {
-            SNAP_LOG_FATAL
-                << "could not restart the opendkim service (systemctl exit value: "
-                << r
-                << ")"
-                << SNAP_LOG_SEND;
-            return r;
+            r = restart;
         }
     }
-
-    // remove the flag telling us that the restart we requested
-    //
-    if(f_verbose)
+    if(r != 0)
     {
-        std::cout
-            << "info: rm -f "
-            << g_opendkim_need_restart
-            << std::endl;
+        return r;
     }
-    if(!f_dry_run)
+
+    r = restart_mail_services();
+    if(r != 0)
     {
-        // ignore errors on this one
-        //
-        snapdev::NOT_USED(unlink(g_opendkim_need_restart));
+        return r;
     }
 
     return 0;
 }
 
 
-int ipmgr::restart_opendmarc()
+/** \brief Reset the state between two runs in daemon mode.
+ *
+ * The cache entries of the last run become the entries to compare
+ * against and the zone configuration files get parsed again if the
+ * zones they define need to be regenerated.
+ */
+void ipmgr::reset_state()
 {
-    int r(0);
-
-    // restart necessary?
+    advgetopt::conf_file::reset_conf_files();
+
+    f_zone_cache.rotate();
+    f_output_stage.rollback();
+    f_zone_files.clear();
+    f_zone_conf.clear();
+    f_zone_jobs.clear();
+    f_next_zone_job = 0;
+    f_zone_job_failed = false;
+    f_bind_restart_required = false;
+    f_bind9_full_restart = false;
+    f_bind9_reconfig_required = false;
+    f_bind9_reload_zones.clear();
+    f_stopped_bind9 = false;
+    f_bind9_is_active = active_t::ACTIVE_NOT_TESTED;
+
+    // --force only applies to the first run
     //
-    if(access(g_opendmarc_need_restart, F_OK) != 0)
+    f_force = false;
+}
+
+
+/** \brief Run the IP Manager as a daemon.
+ *
+ * In this mode, ipmgr processes the zones once and then waits for
+ * changes to the zone configuration files. When a change is detected,
+ * the zones are processed again. Thanks to the zone cache, only the
+ * zones affected by the change get regenerated and the services are
+ * restarted at most once per batch of changes.
+ *
+ * A change to the ipmgr configuration files may affect all the zones
+ * and the options, so in that case the daemon restarts itself.
+ *
+ * \return 1 on a fatal error; the function does not otherwise return.
+ */
+int ipmgr::run_daemon()
+{
+    zone_watcher watcher;
+    if(!watcher.init())
     {
-        return 0;
+        return 1;
     }
 
-    // we do not want to force a restart if opendmarc is not currently
-    // active (i.e. it may have been stopped by the user for a while)
+    // watch first so we do not miss changes happening while we process
+    // the zones
     //
-    cppprocess::process is_active_process("opendmarc-is-active?");
-    is_active_process.set_command("systemctl");
-    is_active_process.add_argument("is-active");
-    is_active_process.add_argument("opendmarc");
-
-    cppprocess::io_capture_pipe::pointer_t output(std::make_shared<cppprocess::io_capture_pipe>());
-    is_active_process.set_output_io(output);
-
-    if(f_verbose)
+    advgetopt::string_list_t directories;
+    int r(get_zone_directories(directories));
+    if(r != 0)
     {
-        std::cout
-            << "info: "
-            << is_active_process.get_command_line()
-            << std::endl;
+        return r;
     }
-
-    if(!f_dry_run)
+    for(auto const & dir : directories)
     {
-        if(is_active_process.start() != 0)
+        if(!watcher.watch_zone_directory(dir))
         {
-            SNAP_LOG_FATAL
-                << "could not start \""
-                << is_active_process.get_command_line()
-                << "\"."
-                << SNAP_LOG_SEND;
             return 1;
         }
-        r = is_active_process.wait();
-        if(r != 0
-        && r != 3)  // 3 is returned if the unit is not active
+    }
+    for(char const * const * dir(g_configuration_directories); *dir != nullptr; ++dir)
+    {
+        if(!watcher.watch_configuration_directory(*dir))
         {
-            SNAP_LOG_FATAL
-                << "command \""
-                << is_active_process.get_command_line()
-                << "\" returned an error (exit code "
-                << r
-                << ")."
-                << SNAP_LOG_SEND;
             return 1;
         }
     }
 
-    std::string const active(snapdev::trim_string(output->get_output(true)));
-    if(active != "active")
-    {
-        return 0;
-    }
-
-    // stop the DNS server
-    //
-    char const * cmd("systemctl restart opendmarc");
-    if(f_verbose)
-    {
-        std::cout
-            << "info: "
-            << cmd
-            << std::endl;
-    }
-    if(!f_dry_run)
+    for(;;)
     {
-        r = system(cmd);
-        if(r != 0)
+        // errors do not stop the daemon, the administrator is expected
+        // to fix the zone files which will trigger a new run
+        //
+        if(process() != 0)
         {
-            SNAP_LOG_FATAL
-                << "could not restart the opendmarc service (systemctl exit value: "
-                << r
-                << ")"
+            SNAP_LOG_ERROR
+                << "the zones could not all be processed; waiting for changes before trying again."
                 << SNAP_LOG_SEND;
-            return r;
         }
-    }
 
-    // remove the flag telling us that the restart we requested
-    //
-    if(f_verbose)
-    {
-        std::cout
-            << "info: rm -f "
-            << g_opendmarc_need_restart
-            << std::endl;
-    }
-    if(!f_dry_run)
-    {
-        // ignore errors on this one
+        // release the serial store and its lock while waiting so ipmgr
+        // can be run by hand in between
         //
-        snapdev::NOT_USED(unlink(g_opendmarc_need_restart));
-    }
+        f_serial_store->close();
 
-    return 0;
+        zone_watcher::change_t const change(watcher.wait(f_debounce));
+        switch(change)
+        {
+        case zone_watcher::change_t::CHANGE_ERROR:
+            return 1;
+
+        case zone_watcher::change_t::CHANGE_CONFIGURATION:
+            SNAP_LOG_INFO
+                << "the ipmgr configuration changed, restarting."
+                << SNAP_LOG_SEND;
+            execv("/proc/self/exe", f_argv.data());
+            {
+                int const e(errno);
+                SNAP_LOG_FATAL
+                    << "could not restart ipmgr (errno: "
+                    << e
+                    << ", "
+                    << strerror(e)
+                    << ")."
+                    << SNAP_LOG_SEND;
+            }
+            return 1;
+
+        case zone_watcher::change_t::CHANGE_NONE:
+        case zone_watcher::change_t::CHANGE_ZONES:
+            break;
+
+        }
+
+        if(f_verbose)
+        {
+            std::cout
+                << "info: zone files changed, processing the zones again."
+                << std::endl;
+        }
+
+        reset_state();
+    }
 }
 
 
@@ -3660,50 +5269,46 @@ int ipmgr::restart_opendmarc()
  * `/run/ipmgr/...` in case something happens and the restart doesn't
  * happen on this run).
  *
+ * With `--daemon`, these steps are repeated each time a zone
+ * configuration file changes.
+ *
  * \return The function returns 1 on errors and 0 on success (like what main()
  * is expected to return).
  */
 int ipmgr::run()
 {
-    // some functionality requires us to modify files own by root or bind
-    //
-    int r(make_root());
-    if(r != 0)
-    {
-        return r;
-    }
-
-    r = process_zones();
-    if(r != 0)
-    {
-        return r;
-    }
-
-    r = process_opendmarc();
-    if(r != 0)
+    if(f_paths.relocated())
     {
-        return r;
+        // a relocated tree is expected to be writable by the current
+        // user and the package did not create our directories in there
+        //
+        if(!f_paths.create_directories())
+        {
+            return 1;
+        }
     }
-
-    r = restart_bind9();
-    if(r != 0)
+    else
     {
-        return r;
+        // some functionality requires us to modify files own by root or bind
+        //
+        int const r(make_root());
+        if(r != 0)
+        {
+            return r;
+        }
     }
 
-    r = restart_opendkim();
-    if(r != 0)
+    if(!f_force)
     {
-        return r;
+        f_zone_cache.load();
     }
 
-    r = restart_opendmarc();
-    if(r != 0)
+    if(f_daemon)
     {
-        return r;
+        return run_daemon();
     }
 
-    return 0;
+    return process();
 }
 
 
@@ -25,15 +25,38 @@
  */
 
 
+// self
+//
+#include    "dkim_key.h"
+#include    "output_stage.h"
+#include    "paths.h"
+#include    "process_runner.h"
+#include    "serial_store.h"
+#include    "serial_strategy.h"
+#include    "zone_cache.h"
+
+
 // advgetopt
 //
 #include    <advgetopt/advgetopt.h>
 #include    <advgetopt/conf_file.h>
 
 
+// cppthread
+//
+#include    <cppthread/mutex.h>
+
+
+// libaddr
+//
+#include    <libaddr/addr.h>
+
+
 // C++
 //
+#include    <set>
 #include    <sstream>
+#include    <unordered_map>
 
 
 
@@ -48,6 +71,7 @@ public:
         typedef std::map<std::string, pointer_t>                map_t;
         typedef std::vector<advgetopt::conf_file::pointer_t>    config_array_t;
         typedef std::map<std::string, std::string>              nameservers_t;
+        typedef std::unordered_map<std::string, std::string>    parameters_t;
 
         enum class dynamic_t
         {
@@ -59,9 +83,15 @@ public:
 
                                 zone_files(
                                       advgetopt::getopt::pointer_t opt
+                                    , paths const & p
+                                    , serial_store::pointer_t serials
                                     , bool verbose);
 
-        void                    add(advgetopt::conf_file::pointer_t zone);
+        void                    add(std::string const & filename, std::uint64_t hash);
+        std::uint64_t           fingerprint() const;
+        bool                    load_configs();
+        void                    restore(std::string const & domain, zone_cache::zone_entry const & entry);
+        zone_cache::zone_entry  get_cache_entry() const;
 
         std::string             get_zone_param(
                                       std::string const & name
@@ -89,15 +119,23 @@ public:
         std::string             group() const;
         std::string             domain() const;
         dynamic_t               dynamic() const;
-        std::string             generate_zone_file();
-        std::string             generate_ptr_file();
+        std::string             generate_zone_header(std::uint32_t serial) const;
+        std::string             generate_zone_body();
+        bool                    verify_zone(std::string const & zone_data) const;
+        std::string             generate_ptr_header(std::uint32_t serial) const;
+        std::string             generate_ptr_body() const;
         std::uint32_t           get_zone_serial(bool next = false);
+        bool                    new_opendkim_key() const;
         std::string             get_zone_mail_subdomain() const;
+        std::string             get_opendkim_selector() const;
         bool                    is_auth_server() const;
         std::string             get_ptr() const;
         std::string             get_ptr_arpa() const;
 
     private:
+        static std::string      parameter_name(std::string name);
+        std::uint32_t           get_live_serial() const;
+        bool                    generate_opendkim_key(std::string const & path);
         bool                    retrieve_group();
         bool                    retrieve_domain();
         bool                    retrieve_ttl();
@@ -105,6 +143,7 @@ public:
         bool                    retrieve_ips();
         bool                    retrieve_nameservers();
         bool                    retrieve_hostmaster();
+        bool                    retrieve_serial_strategy();
         bool                    retrieve_serial();
         bool                    retrieve_refresh();
         bool                    retrieve_retry();
@@ -115,24 +154,36 @@ public:
         bool                    retrieve_all_sections();
 
         advgetopt::getopt::pointer_t        f_opt = advgetopt::getopt::pointer_t();
+        paths                               f_paths = paths();
+        serial_store::pointer_t             f_serials = serial_store::pointer_t();
         bool                                f_dry_run = false;
+        bool                                f_live_serial = false;
         bool                                f_verbose = false;
+        dkim_key_type_t                     f_opendkim_key_type = dkim_key_type_t::DKIM_KEY_TYPE_RSA;
+        long                                f_opendkim_key_bits = dkim_key::DEFAULT_RSA_BITS;
+        bool                                f_new_opendkim_key = false;
 
-        // the order matters; when searching for a parameter, the
-        // first file from the end of the vector must be checked
-        // first; the first instance of a defined parameter must be
-        // used; prior instances were overridden
+        // the order matters; a parameter defined in a file overrides
+        // the same parameter defined in the files before it; the
+        // parameters get merged in f_parameters as the files are loaded
         //
+        // the files only get parsed by load_configs() since the zone
+        // may not need to be regenerated
+        //
+        advgetopt::string_list_t            f_filenames = advgetopt::string_list_t();
+        std::uint64_t                       f_fingerprint = 0;
         config_array_t                      f_configs = config_array_t();
+        parameters_t                        f_parameters = parameters_t();
 
         // these get defined when we call the retrive_fields() function
         //
         std::string                         f_group = std::string();
         std::string                         f_domain = std::string();
         std::int32_t                        f_ttl = 0;
-        advgetopt::string_list_t            f_ips = advgetopt::string_list_t();
+        addr::addr::vector_t                f_ips = addr::addr::vector_t();
         nameservers_t                       f_nameservers = nameservers_t();
         std::string                         f_hostmaster = std::string();
+        serial_strategy_t                   f_serial_strategy = serial_strategy_t::SERIAL_STRATEGY_COUNTER;
         std::uint32_t                       f_serial = 0;
         std::int64_t                        f_refresh = 0;
         std::int64_t                        f_retry = 0;
@@ -156,9 +207,43 @@ public:
 
     int                     run();
 
+    // the phases of process_zones() which can be timed separately
+    //
+    int                     read_zones();
+    zone_files::map_t const &
+                            get_zone_files() const;
+    int                     generate_conf_files();
+    int                     save_conf_files();
+    int                     commit_output();
+    int                     process_zones();
+    void                    reset_state();
+
 private:
     typedef std::map<std::string, std::stringstream>    conf_map_t;
 
+    class zone_worker;
+
+    // the result of processing one zone; the vector of jobs is kept in
+    // the same order as f_zone_files so the .conf and includes can be
+    // merged in a deterministic manner once all the workers are done
+    //
+    struct zone_job
+    {
+        zone_files::pointer_t   f_zone = zone_files::pointer_t();
+        std::uint64_t           f_fingerprint = 0;
+        int                     f_result = 0;
+        int                     f_ptr_result = 0;
+        bool                    f_cached = false;
+        bool                    f_fields_retrieved = false;
+        bool                    f_generated = false;
+        bool                    f_ptr_processed = false;
+        bool                    f_ptr_generated = false;
+        bool                    f_new_opendkim_key = false;
+        zone_cache::output_map_t
+                                f_outputs = zone_cache::output_map_t();
+    };
+    typedef std::vector<zone_job>                       zone_job_list_t;
+
     enum active_t
     {
         ACTIVE_NOT_TESTED,
@@ -169,30 +254,71 @@ private:
     bool                    dry_run() const;
     bool                    verbose() const;
     int                     make_root();
-    int                     read_zones();
+    int                     get_zone_directories(advgetopt::string_list_t & directories);
+    std::uint64_t           options_fingerprint() const;
+    bool                    restore_zone(std::string const & domain, zone_job & job);
+    void                    cache_zone(zone_job const & job);
     int                     prepare_includes();
-    int                     generate_zone(zone_files::pointer_t & zone);
-    int                     generate_ptr_zone(zone_files::pointer_t & zone);
-    int                     save_conf_files();
-    int                     process_zones();
+    int                     prepare_zone_directories(zone_files::pointer_t zone);
+    int                     generate_zone(zone_job & job);
+    int                     update_dynamic_zone(
+                                      zone_files::pointer_t zone
+                                    , std::string const & previous
+                                    , std::string const & next
+                                    , bool frozen);
+    int                     generate_ptr_zone(zone_job & job);
+    void                    add_zone_conf(zone_job const & job);
+    void                    process_zone_job(zone_job & job);
+    zone_job *              next_zone_job();
+    void                    zone_job_done(zone_job const & job);
+    int                     process_zone_jobs();
+    void                    bind9_restart_required();
+    void                    bind9_reload_zone(std::string const & zone);
+    int                     save_conf_file(std::string const & filename, std::string const & contents);
+    int                     save_opendkim_tables();
     int                     process_opendmarc();
+    int                     services_are_active(advgetopt::string_list_t const & services, std::vector<bool> & active);
     int                     bind9_is_active();
+    bool                    bind9_accepts_updates();
     int                     stop_bind9();
     int                     start_bind9();
+    bool                    start_command(process_runner & command);
+    int                     wait_command(process_runner & command);
+    int                     run_command(std::string const & command, advgetopt::string_list_t const & args);
+    int                     reload_bind9();
     int                     restart_bind9();
-    int                     restart_opendkim();
-    int                     restart_opendmarc();
+    int                     restart_mail_services();
+    int                     process();
+    int                     run_daemon();
 
     advgetopt::getopt::pointer_t
                             f_opt = advgetopt::getopt::pointer_t();
     zone_files::map_t       f_zone_files = zone_files::map_t();
+    paths                   f_paths = paths();
+    zone_cache              f_zone_cache;
+    output_stage            f_output_stage = output_stage();
+    serial_store::pointer_t f_serial_store = serial_store::pointer_t();
     conf_map_t              f_zone_conf = {}; // indexed by group name
-    std::ofstream           f_includes = std::ofstream();
+    std::stringstream       f_includes = std::stringstream();
+    zone_job_list_t         f_zone_jobs = zone_job_list_t();
+    std::size_t             f_next_zone_job = 0;
+    std::size_t             f_jobs = 1;
+    bool                    f_zone_job_failed = false;
+    cppthread::mutex        f_job_mutex = cppthread::mutex();
+    cppthread::mutex        f_bind9_mutex = cppthread::mutex();
+    cppthread::mutex        f_directory_mutex = cppthread::mutex();
     bool                    f_bind_restart_required = false;
+    bool                    f_bind9_full_restart = false;
+    bool                    f_bind9_reconfig_required = false;
+    std::set<std::string>   f_bind9_reload_zones = std::set<std::string>();
     bool                    f_dry_run = false;
     bool                    f_verbose = false;
     bool                    f_force = false;
+    bool                    f_paranoid = false;
     bool                    f_config_warnings = false;
+    bool                    f_daemon = false;
+    std::int64_t            f_debounce = 500;
+    std::vector<char *>     f_argv = std::vector<char *>();
     bool                    f_stopped_bind9 = false;
     active_t                f_bind9_is_active = active_t::ACTIVE_NOT_TESTED;
 };
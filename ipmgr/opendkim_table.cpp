@@ -0,0 +1,351 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the OpenDKIM table model.
+ *
+ * A table is a list of lines with a key, blanks, and a value:
+ *
+ * \code
+ *     # signing_table
+ *     example.com mail._domainkey.example.com
+ *
+ *     # key_table
+ *     mail._domainkey.example.com example.com:mail:/etc/opendkim/example.com.key/mail.private
+ * \endcode
+ *
+ * The lines are kept in their original order and written back verbatim,
+ * comments, empty and invalid lines included. This matters with refile
+ * where the signing table is searched in order and one domain can have
+ * several entries. Only the lines of the keys passed to set() and erase()
+ * get modified; new keys are appended at the end.
+ */
+
+
+// self
+//
+#include    "opendkim_table.h"
+
+
+// snapdev
+//
+#include    <snapdev/file_contents.h>
+#include    <snapdev/not_used.h>
+#include    <snapdev/trim_string.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+char const * const g_auto_generated = "# WARNING: AUTO-GENERATED FILE, SEE ipmgr(1) FOR DETAILS";
+
+
+/** \brief Split a line of a table in its key and value.
+ *
+ * \param[in] line  The line to split.
+ * \param[out] key  The first field of the line.
+ * \param[out] value  The rest of the line without the surrounding blanks.
+ *
+ * \return true if the line is an entry, false for comments, empty and
+ * invalid lines.
+ */
+bool split_line(std::string const & line, std::string & key, std::string & value)
+{
+    std::string const l(snapdev::trim_string(line));
+    if(l.empty()
+    || l[0] == '#')
+    {
+        return false;
+    }
+
+    std::string::size_type const key_end(l.find_first_of(" \t"));
+    if(key_end == std::string::npos)
+    {
+        return false;
+    }
+    key = l.substr(0, key_end);
+    value = l.substr(l.find_first_not_of(" \t", key_end));
+
+    return true;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Initialize a table.
+ *
+ * \param[in] filename  The name of the file with the table.
+ */
+opendkim_table::opendkim_table(std::string const & filename)
+    : f_filename(filename)
+{
+}
+
+
+/** \brief Get the name of the file of this table.
+ *
+ * \return The filename passed to the constructor.
+ */
+std::string const & opendkim_table::filename() const
+{
+    return f_filename;
+}
+
+
+/** \brief Load the table from its file.
+ *
+ * A missing file is not an error; the table is empty.
+ *
+ * \return true if the table was loaded.
+ */
+bool opendkim_table::load()
+{
+    snapdev::file_contents file(f_filename);
+    if(!file.read_all())
+    {
+        // the file may not exist yet
+        //
+        return parse(std::string());
+    }
+
+    return parse(file.contents());
+}
+
+
+/** \brief Parse the contents of a table.
+ *
+ * The previous lines are replaced by the ones found in \p contents
+ * and the table is marked as not modified.
+ *
+ * Invalid lines (a key without a value) are kept as is, they are only
+ * reported by the returned value.
+ *
+ * \param[in] contents  The contents of a table file.
+ *
+ * \return true if all the lines were valid.
+ */
+bool opendkim_table::parse(std::string const & contents)
+{
+    f_lines.clear();
+    f_modified = false;
+
+    std::string::size_type pos(0);
+    while(pos < contents.length())
+    {
+        std::string::size_type eol(contents.find('\n', pos));
+        if(eol == std::string::npos)
+        {
+            eol = contents.length();
+        }
+        f_lines.push_back(contents.substr(pos, eol - pos));
+        pos = eol + 1;
+    }
+
+    index_lines();
+
+    for(auto const & l : f_lines)
+    {
+        std::string key;
+        std::string value;
+        if(!split_line(l, key, value))
+        {
+            std::string const line(snapdev::trim_string(l));
+            if(!line.empty()
+            && line[0] != '#')
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/** \brief Find the value of an entry.
+ *
+ * When a key appears on several lines, the first one is used.
+ *
+ * \param[in] key  The key of the entry.
+ *
+ * \return The value of the entry or an empty string.
+ */
+std::string opendkim_table::find(std::string const & key) const
+{
+    auto const it(f_index.find(key));
+    if(it == f_index.end())
+    {
+        return std::string();
+    }
+
+    std::string k;
+    std::string value;
+    snapdev::NOT_USED(split_line(f_lines[it->second.front()], k, value));
+    return value;
+}
+
+
+/** \brief Add or replace an entry.
+ *
+ * If one of the lines of \p key already has \p value, nothing changes.
+ * Otherwise the first line of \p key is replaced, or a new line is
+ * appended if the key is new. The other lines are not touched.
+ *
+ * The table is marked as modified only if a line changes.
+ *
+ * \param[in] key  The key of the entry.
+ * \param[in] value  The new value of the entry.
+ */
+void opendkim_table::set(std::string const & key, std::string const & value)
+{
+    auto const it(f_index.find(key));
+    if(it != f_index.end())
+    {
+        for(auto const n : it->second)
+        {
+            std::string k;
+            std::string v;
+            if(split_line(f_lines[n], k, v)
+            && v == value)
+            {
+                return;
+            }
+        }
+        f_lines[it->second.front()] = key + ' ' + value;
+    }
+    else
+    {
+        if(f_lines.empty())
+        {
+            f_lines.push_back(g_auto_generated);
+        }
+        f_index[key].push_back(f_lines.size());
+        f_lines.push_back(key + ' ' + value);
+    }
+    f_modified = true;
+}
+
+
+/** \brief Remove all the lines of an entry.
+ *
+ * \param[in] key  The key of the entry to remove.
+ *
+ * \return true if the entry existed.
+ */
+bool opendkim_table::erase(std::string const & key)
+{
+    auto const it(f_index.find(key));
+    if(it == f_index.end())
+    {
+        return false;
+    }
+
+    // the line numbers are sorted, remove from the end
+    //
+    for(auto n(it->second.rbegin()); n != it->second.rend(); ++n)
+    {
+        f_lines.erase(f_lines.begin() + *n);
+    }
+    index_lines();
+    f_modified = true;
+
+    return true;
+}
+
+
+/** \brief Get the number of entries.
+ *
+ * \return The number of lines with a key and a value.
+ */
+std::size_t opendkim_table::size() const
+{
+    std::size_t result(0);
+    for(auto const & i : f_index)
+    {
+        result += i.second.size();
+    }
+    return result;
+}
+
+
+/** \brief Check whether the table changed since it was loaded.
+ *
+ * \return true if set() or erase() changed the table.
+ */
+bool opendkim_table::modified() const
+{
+    return f_modified;
+}
+
+
+/** \brief Convert the table to the contents of its file.
+ *
+ * \return The table as expected by OpenDKIM.
+ */
+std::string opendkim_table::to_string() const
+{
+    if(f_lines.empty())
+    {
+        return std::string(g_auto_generated) + '\n';
+    }
+
+    std::size_t size(0);
+    for(auto const & l : f_lines)
+    {
+        size += l.length() + 1;
+    }
+
+    std::string result;
+    result.reserve(size);
+    for(auto const & l : f_lines)
+    {
+        result += l;
+        result += '\n';
+    }
+
+    return result;
+}
+
+
+void opendkim_table::index_lines()
+{
+    f_index.clear();
+    for(std::size_t n(0); n < f_lines.size(); ++n)
+    {
+        std::string key;
+        std::string value;
+        if(split_line(f_lines[n], key, value))
+        {
+            f_index[key].push_back(n);
+        }
+    }
+}
+
+
+// vim: ts=4 sw=4 et
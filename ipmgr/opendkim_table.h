@@ -0,0 +1,71 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+/** \file
+ * \brief Model of the OpenDKIM key and signing tables.
+ *
+ * The opendkim_table class loads one of the OpenDKIM tables (i.e.
+ * `/etc/opendkim/signing_table` or `/etc/opendkim/key_table`) as a list
+ * of lines kept in their original order. An index of the first field of
+ * each line finds the entries of a key with an exact match. Only the
+ * lines of the keys being updated change, all the other lines are
+ * written back verbatim.
+ */
+
+
+// C++
+//
+#include    <string>
+#include    <unordered_map>
+#include    <vector>
+
+
+
+class opendkim_table
+{
+public:
+                            opendkim_table(std::string const & filename = std::string());
+
+    std::string const &     filename() const;
+    bool                    load();
+    bool                    parse(std::string const & contents);
+    std::string             find(std::string const & key) const;
+    void                    set(std::string const & key, std::string const & value);
+    bool                    erase(std::string const & key);
+    std::size_t             size() const;
+    bool                    modified() const;
+    std::string             to_string() const;
+
+private:
+    typedef std::vector<std::size_t>                        line_numbers_t;
+    typedef std::unordered_map<std::string, line_numbers_t> index_t;
+
+    void                    index_lines();
+
+    std::string             f_filename = std::string();
+    std::vector<std::string>
+                            f_lines = std::vector<std::string>();
+    index_t                 f_index = index_t();        // key -> line numbers
+    bool                    f_modified = false;
+};
+
+
+
+// vim: ts=4 sw=4 et
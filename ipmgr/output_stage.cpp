@@ -0,0 +1,562 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the transactional output.
+ *
+ * Each file gets written to a temporary file in the same directory as
+ * the final file so the rename(2) that moves it in place is atomic.
+ *
+ * On commit(), the file systems holding the temporary files are synced
+ * once with syncfs(2), the files are renamed, the files marked for
+ * removal are deleted, and the file systems are synced again so the
+ * renames are durable as well.
+ *
+ * The copies staged with stage_copy() are created from the temporary
+ * file of the source so they also get moved in place by commit().
+ */
+
+
+// self
+//
+#include    "output_stage.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// snapdev
+//
+#include    <snapdev/chownnm.h>
+#include    <snapdev/file_contents.h>
+#include    <snapdev/mkdir_p.h>
+#include    <snapdev/not_used.h>
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <linux/fs.h>
+#include    <string.h>
+#include    <sys/ioctl.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+typedef std::map<dev_t, std::string>        device_map_t;
+
+
+/** \brief Sync the file systems.
+ *
+ * \param[in] devices  One file per file system to sync.
+ *
+ * \return true if all the file systems were synced.
+ */
+bool sync_devices(device_map_t const & devices)
+{
+    bool result(true);
+    for(auto const & d : devices)
+    {
+        int const fd(open(d.second.c_str(), O_RDONLY | O_CLOEXEC));
+        if(fd < 0
+        || syncfs(fd) != 0)
+        {
+            int const e(errno);
+            SNAP_LOG_ERROR
+                << "could not sync the file system of \""
+                << d.second
+                << "\" (errno: "
+                << e
+                << ", "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+            result = false;
+        }
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    return result;
+}
+
+
+/** \brief Create a hard link to a file.
+ *
+ * \param[in] source  The existing file.
+ * \param[in] destination  The new link.
+ *
+ * \return true if the link was created.
+ */
+bool link_file(std::string const & source, std::string const & destination)
+{
+    snapdev::NOT_USED(unlink(destination.c_str()));
+    return link(source.c_str(), destination.c_str()) == 0;
+}
+
+
+/** \brief Clone a file or copy it within the kernel.
+ *
+ * The function first attempts a reflink (FICLONE) which shares the data
+ * blocks until one of the files gets modified. File systems which do not
+ * support that (i.e. ext4) still get the data copied with
+ * copy_file_range() so it does not go through user space.
+ *
+ * \param[in] source  The existing file.
+ * \param[in] destination  The new file.
+ *
+ * \return true if the file was cloned or copied.
+ */
+bool reflink_file(std::string const & source, std::string const & destination)
+{
+    int const in(open(source.c_str(), O_RDONLY | O_CLOEXEC));
+    if(in < 0)
+    {
+        return false;
+    }
+    struct stat st = {};
+    if(fstat(in, &st) != 0)
+    {
+        close(in);
+        return false;
+    }
+    int const out(open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+    if(out < 0)
+    {
+        close(in);
+        return false;
+    }
+
+    bool result(ioctl(out, FICLONE, in) == 0);
+    if(!result)
+    {
+        result = true;
+        off_t left(st.st_size);
+        while(left > 0)
+        {
+            ssize_t const copied(copy_file_range(in, nullptr, out, nullptr, left, 0));
+            if(copied <= 0)
+            {
+                result = false;
+                break;
+            }
+            left -= copied;
+        }
+    }
+
+    close(in);
+    if(close(out) != 0)
+    {
+        result = false;
+    }
+
+    return result;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Convert a copy mode name to a copy mode.
+ *
+ * The supported names are "write", "reflink", and "link".
+ *
+ * \param[in] name  The name of the copy mode.
+ * \param[out] mode  The corresponding copy mode.
+ *
+ * \return true if \p name is a valid copy mode name.
+ */
+bool string_to_copy_mode(std::string const & name, copy_mode_t & mode)
+{
+    if(name == "write")
+    {
+        mode = copy_mode_t::COPY_MODE_WRITE;
+        return true;
+    }
+    if(name == "reflink")
+    {
+        mode = copy_mode_t::COPY_MODE_REFLINK;
+        return true;
+    }
+    if(name == "link")
+    {
+        mode = copy_mode_t::COPY_MODE_LINK;
+        return true;
+    }
+
+    return false;
+}
+
+
+
+/** \brief Clean up.
+ *
+ * Files that were staged but not committed get deleted.
+ */
+output_stage::~output_stage()
+{
+    rollback();
+}
+
+
+/** \brief Stage a file.
+ *
+ * The \p contents get saved in a temporary file next to \p filename.
+ * If the same file gets staged again, the new contents replace the
+ * previous ones.
+ *
+ * This function can be called by several zone workers simultaneously.
+ *
+ * \param[in] filename  The name of the final file.
+ * \param[in] contents  The contents of the file.
+ * \param[in] owner  The owner of the file or an empty string to keep ours.
+ * \param[in] group  The group of the file or an empty string to keep ours.
+ *
+ * \return true if the file was staged.
+ */
+bool output_stage::stage(
+      std::string const & filename
+    , std::string const & contents
+    , std::string const & owner
+    , std::string const & group)
+{
+    std::string const temporary(temporary_filename(filename));
+
+    // the temporary file may be a hard link from a previous stage_copy()
+    //
+    snapdev::NOT_USED(unlink(temporary.c_str()));
+
+    snapdev::file_contents file(temporary, true);
+    file.contents(contents);
+    if(!file.write_all())
+    {
+        SNAP_LOG_ERROR
+            << "could not write to file \""
+            << temporary
+            << "\": "
+            << file.last_error()
+            << SNAP_LOG_SEND;
+        snapdev::NOT_USED(unlink(temporary.c_str()));
+        return false;
+    }
+
+    if(!owner.empty()
+    && snapdev::chownnm(temporary, owner, group) != 0)
+    {
+        SNAP_LOG_ERROR
+            << "could not set file \""
+            << temporary
+            << "\" owner and/or group to "
+            << owner
+            << ':'
+            << group
+            << '.'
+            << SNAP_LOG_SEND;
+        snapdev::NOT_USED(unlink(temporary.c_str()));
+        return false;
+    }
+
+    cppthread::guard lock(f_mutex);
+    f_staged[filename] = temporary;
+    f_removed.erase(filename);
+
+    return true;
+}
+
+
+/** \brief Stage a file with the same contents as another staged file.
+ *
+ * When \p source was staged and the copy mode is not
+ * copy_mode_t::COPY_MODE_WRITE, the temporary file of \p filename is
+ * created from the temporary file of \p source with a hard link
+ * (copy_mode_t::COPY_MODE_LINK only), a reflink, or copy_file_range(),
+ * whichever works first. These fail when the files are on different
+ * file systems, in which case the \p contents get written as with
+ * stage().
+ *
+ * Note that with hard links, the two files share their ownership and
+ * permissions.
+ *
+ * \param[in] filename  The name of the final file.
+ * \param[in] source  The name of the final file to copy.
+ * \param[in] contents  The contents of \p source.
+ *
+ * \return true if the file was staged.
+ */
+bool output_stage::stage_copy(
+      std::string const & filename
+    , std::string const & source
+    , std::string const & contents)
+{
+    std::string source_temporary;
+    copy_mode_t mode(copy_mode_t::COPY_MODE_WRITE);
+    {
+        cppthread::guard lock(f_mutex);
+
+        auto it(f_staged.find(source));
+        if(it != f_staged.end())
+        {
+            source_temporary = it->second;
+            mode = f_copy_mode;
+        }
+    }
+
+    if(mode != copy_mode_t::COPY_MODE_WRITE)
+    {
+        std::string const temporary(temporary_filename(filename));
+        if(snapdev::mkdir_p(temporary, true) == 0
+        && ((mode == copy_mode_t::COPY_MODE_LINK && link_file(source_temporary, temporary))
+            || reflink_file(source_temporary, temporary)))
+        {
+            cppthread::guard lock(f_mutex);
+            f_staged[filename] = temporary;
+            f_removed.erase(filename);
+            return true;
+        }
+        snapdev::NOT_USED(unlink(temporary.c_str()));
+    }
+
+    return stage(filename, contents);
+}
+
+
+/** \brief Mark a file for removal.
+ *
+ * The file gets deleted on commit(), after the staged files were moved
+ * in place. If the file was staged, it gets unstaged.
+ *
+ * \param[in] filename  The name of the file to remove.
+ */
+void output_stage::remove(std::string const & filename)
+{
+    cppthread::guard lock(f_mutex);
+
+    auto it(f_staged.find(filename));
+    if(it != f_staged.end())
+    {
+        snapdev::NOT_USED(unlink(it->second.c_str()));
+        f_staged.erase(it);
+    }
+    f_removed.insert(filename);
+}
+
+
+/** \brief Move all the staged files in place.
+ *
+ * On an error, the function still attempts to move the other files in
+ * place. The files which could not be moved are deleted.
+ *
+ * \return true if all the files were moved in place and removed.
+ */
+bool output_stage::commit()
+{
+    cppthread::guard lock(f_mutex);
+
+    if(f_staged.empty()
+    && f_removed.empty())
+    {
+        return true;
+    }
+
+    // one file per file system is enough for syncfs()
+    //
+    device_map_t devices;
+    for(auto const & s : f_staged)
+    {
+        struct stat st = {};
+        if(stat(s.second.c_str(), &st) == 0)
+        {
+            devices.emplace(st.st_dev, s.second);
+        }
+    }
+
+    bool result(sync_devices(devices));
+    if(!result)
+    {
+        // without the data on disk, a rename could leave an empty file
+        // behind after a crash; keep the old files instead
+        //
+        for(auto const & s : f_staged)
+        {
+            snapdev::NOT_USED(unlink(s.second.c_str()));
+        }
+        f_staged.clear();
+        f_removed.clear();
+        return false;
+    }
+
+    devices.clear();
+    for(auto const & s : f_staged)
+    {
+        if(rename(s.second.c_str(), s.first.c_str()) != 0)
+        {
+            int const e(errno);
+            SNAP_LOG_ERROR
+                << "could not rename \""
+                << s.second
+                << "\" to \""
+                << s.first
+                << "\" (errno: "
+                << e
+                << ", "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+            snapdev::NOT_USED(unlink(s.second.c_str()));
+            result = false;
+            continue;
+        }
+
+        struct stat st = {};
+        if(stat(s.first.c_str(), &st) == 0)
+        {
+            devices.emplace(st.st_dev, s.first);
+        }
+    }
+    f_staged.clear();
+
+    for(auto const & r : f_removed)
+    {
+        if(unlink(r.c_str()) != 0
+        && errno != ENOENT)
+        {
+            int const e(errno);
+            SNAP_LOG_WARNING
+                << "could not delete file \""
+                << r
+                << "\": "
+                << e
+                << ", "
+                << strerror(e)
+                << SNAP_LOG_SEND;
+        }
+    }
+    f_removed.clear();
+
+    // make the renames durable too
+    //
+    if(!sync_devices(devices))
+    {
+        result = false;
+    }
+
+    return result;
+}
+
+
+/** \brief Forget about all the staged files.
+ *
+ * The temporary files get deleted and the files marked for removal
+ * are kept.
+ */
+void output_stage::rollback()
+{
+    cppthread::guard lock(f_mutex);
+
+    for(auto const & s : f_staged)
+    {
+        snapdev::NOT_USED(unlink(s.second.c_str()));
+    }
+    f_staged.clear();
+    f_removed.clear();
+}
+
+
+/** \brief Check whether anything is staged.
+ *
+ * \return true if no files are staged or marked for removal.
+ */
+bool output_stage::empty() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_staged.empty() && f_removed.empty();
+}
+
+
+/** \brief Get the number of staged files.
+ *
+ * \return The number of files staged, not including the files to remove.
+ */
+std::size_t output_stage::size() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_staged.size();
+}
+
+
+/** \brief Change the way stage_copy() creates the copies.
+ *
+ * \param[in] mode  The new copy mode.
+ */
+void output_stage::set_copy_mode(copy_mode_t mode)
+{
+    cppthread::guard lock(f_mutex);
+    f_copy_mode = mode;
+}
+
+
+/** \brief Get the way stage_copy() creates the copies.
+ *
+ * \return The current copy mode.
+ */
+copy_mode_t output_stage::get_copy_mode() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_copy_mode;
+}
+
+
+/** \brief Get the name of the temporary file of a staged file.
+ *
+ * The temporary file is in the same directory so it is on the same
+ * file system and the rename is atomic.
+ *
+ * \param[in] filename  The name of the final file.
+ *
+ * \return The name of the temporary file.
+ */
+std::string output_stage::temporary_filename(std::string const & filename)
+{
+    return filename + ".ipmgr-new";
+}
+
+
+
+// vim: ts=4 sw=4 et
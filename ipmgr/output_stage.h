@@ -0,0 +1,100 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Transactional output of the generated files.
+ *
+ * The output_stage class saves the files generated by one run in
+ * temporary files and moves them in place all at once. This way bind9
+ * never sees a partially written file and the data is made durable with
+ * one sync per file system instead of one per file.
+ *
+ * A file with the same contents as another staged file can be staged as
+ * a copy of that file which, depending on the copy mode and the file
+ * system, is a hard link, a reflink, or an in kernel copy.
+ */
+
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <map>
+#include    <set>
+#include    <string>
+
+
+
+enum class copy_mode_t
+{
+    COPY_MODE_WRITE,        // always write the contents
+    COPY_MODE_REFLINK,      // clone the file or copy it in the kernel
+    COPY_MODE_LINK,         // hard link the file, share the inode
+};
+
+
+bool                        string_to_copy_mode(std::string const & name, copy_mode_t & mode);
+
+
+
+class output_stage
+{
+public:
+                            output_stage() = default;
+                            output_stage(output_stage const &) = delete;
+                            ~output_stage();
+
+    output_stage &          operator = (output_stage const &) = delete;
+
+    bool                    stage(
+                                  std::string const & filename
+                                , std::string const & contents
+                                , std::string const & owner = std::string()
+                                , std::string const & group = std::string());
+    bool                    stage_copy(
+                                  std::string const & filename
+                                , std::string const & source
+                                , std::string const & contents);
+    void                    remove(std::string const & filename);
+    bool                    commit();
+    void                    rollback();
+    bool                    empty() const;
+    std::size_t             size() const;
+
+    void                    set_copy_mode(copy_mode_t mode);
+    copy_mode_t             get_copy_mode() const;
+
+    static std::string      temporary_filename(std::string const & filename);
+
+private:
+    typedef std::map<std::string, std::string>  staged_map_t;
+
+    mutable cppthread::mutex
+                            f_mutex = cppthread::mutex();
+    staged_map_t            f_staged = staged_map_t();      // final filename -> temporary filename
+    std::set<std::string>   f_removed = std::set<std::string>();
+    copy_mode_t             f_copy_mode = copy_mode_t::COPY_MODE_REFLINK;
+};
+
+
+
+// vim: ts=4 sw=4 et
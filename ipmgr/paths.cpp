@@ -0,0 +1,143 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the path resolution.
+ *
+ * The paths used by ipmgr are always absolute paths such as
+ * `/etc/bind/zones`. These are the paths that bind9 and the other
+ * services see, so they are the ones saved in the generated files.
+ * When ipmgr accesses the file system, it first resolves these paths
+ * against the root directory which is empty by default.
+ */
+
+
+// self
+//
+#include    "paths.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// snapdev
+//
+#include    <snapdev/mkdir_p.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+/** \brief Initialize the paths.
+ *
+ * The \p root parameter is the directory used as the root of the file
+ * system. By default it is empty meaning that the paths are used as is.
+ * A root of "/" is viewed as empty.
+ *
+ * \param[in] root  The root directory.
+ */
+paths::paths(std::string const & root)
+    : f_root(root)
+{
+    while(!f_root.empty()
+       && f_root.back() == '/')
+    {
+        f_root.pop_back();
+    }
+}
+
+
+/** \brief Get the root directory.
+ *
+ * \return The root directory without a trailing slash, or an empty string.
+ */
+std::string const & paths::root() const
+{
+    return f_root;
+}
+
+
+/** \brief Check whether the paths are relocated.
+ *
+ * When the paths are relocated, ipmgr works in a sandbox. The services
+ * (bind9, opendkim, opendmarc) are viewed as not running since the files
+ * they use are not the ones ipmgr generates.
+ *
+ * \return true if a root directory was specified.
+ */
+bool paths::relocated() const
+{
+    return !f_root.empty();
+}
+
+
+/** \brief Resolve an absolute path against the root directory.
+ *
+ * \param[in] path  An absolute path such as "/etc/bind/zones".
+ *
+ * \return The path prefixed with the root directory.
+ */
+std::string paths::resolve(std::string const & path) const
+{
+    return f_root + path;
+}
+
+
+/** \brief Create the directories ipmgr expects to exist.
+ *
+ * On a normal installation, the package creates these directories.
+ * In a relocated tree, they are created by this function instead.
+ *
+ * \return true if all the directories exist.
+ */
+bool paths::create_directories() const
+{
+    char const * const directories[] =
+    {
+        IPMGR_GENERATED,
+        IPMGR_SERIAL,
+        IPMGR_RUN,
+        BIND_ZONES,
+        BIND_DYNAMIC_ZONES,
+        OPENDKIM,
+    };
+    for(auto const & d : directories)
+    {
+        std::string const dir(resolve(d));
+        if(snapdev::mkdir_p(dir) != 0)
+        {
+            SNAP_LOG_FATAL
+                << "could not create directory \""
+                << dir
+                << "\"."
+                << SNAP_LOG_SEND;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,67 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Resolution of the paths used by ipmgr.
+ *
+ * The paths class prefixes the absolute paths that ipmgr reads and
+ * writes with the `--root-dir` directory. This allows for running the
+ * whole zone pipeline in a sandbox (i.e. without being root and without
+ * touching the live bind9 configuration).
+ */
+
+
+// C++
+//
+#include    <string>
+
+
+
+class paths
+{
+public:
+    static constexpr char const * const IPMGR_GENERATED = "/var/lib/ipmgr/generated";
+    static constexpr char const * const IPMGR_SERIAL = "/var/lib/ipmgr/serial";
+    static constexpr char const * const IPMGR_SERIAL_DB = "/var/lib/ipmgr/serial.db";
+    static constexpr char const * const IPMGR_ZONE_CACHE = "/var/lib/ipmgr/fingerprints.cache";
+    static constexpr char const * const IPMGR_RUN = "/run/ipmgr";
+    static constexpr char const * const IPMGR_BIND9_NEED_RESTART = "/run/ipmgr/bind9-need-restart";
+    static constexpr char const * const IPMGR_OPENDKIM_NEED_RESTART = "/run/ipmgr/opendkim-need-restart";
+    static constexpr char const * const IPMGR_OPENDMARC_NEED_RESTART = "/run/ipmgr/opendmarc-need-restart";
+    static constexpr char const * const BIND_CONF = "/etc/bind";
+    static constexpr char const * const BIND_ZONES = "/etc/bind/zones";
+    static constexpr char const * const BIND_DYNAMIC_ZONES = "/var/lib/bind";
+    static constexpr char const * const BIND_OPTIONS = "/etc/bind/ipmgr-options.conf";
+    static constexpr char const * const OPENDKIM = "/etc/opendkim";
+    static constexpr char const * const OPENDMARC_CONF = "/etc/opendmarc.conf";
+
+                            paths(std::string const & root = std::string());
+
+    std::string const &     root() const;
+    bool                    relocated() const;
+    std::string             resolve(std::string const & path) const;
+    bool                    create_directories() const;
+
+private:
+    std::string             f_root = std::string();
+};
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,493 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the process runner.
+ *
+ * The command is started with posix_spawnp(). Its standard input is
+ * `/dev/null` and its standard output and error are pipes read by
+ * wait() until the command ends or its timeout is reached. On a
+ * timeout, the command receives a SIGTERM and, if it still does not
+ * end, a SIGKILL a few seconds later.
+ *
+ * The end of the command is detected with a pidfd polled along the
+ * pipes, not the end of the pipes, since a process started in the
+ * background by the command may keep them open. Kernels without
+ * pidfd_open() get the command checked with waitpid() every 100ms.
+ */
+
+
+// self
+//
+#include    "process_runner.h"
+
+
+// snapdev
+//
+#include    <snapdev/not_used.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <chrono>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <poll.h>
+#include    <signal.h>
+#include    <spawn.h>
+#include    <sys/ioctl.h>
+#include    <sys/syscall.h>
+#include    <sys/wait.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+extern char ** environ;
+
+
+
+namespace
+{
+
+
+
+/** \brief Time given to a command to exit after a SIGTERM.
+ *
+ * If the command does not exit within this time, it gets killed
+ * with SIGKILL.
+ */
+constexpr int const g_kill_delay = 5000;    // in ms
+
+
+/** \brief Time between two checks of the command without a pidfd.
+ *
+ * When pidfd_open() is not available, the command gets checked with
+ * waitpid() at this interval.
+ */
+constexpr int const g_check_interval = 100;  // in ms
+
+
+int remaining_time(std::chrono::steady_clock::time_point const & deadline)
+{
+    auto const now(std::chrono::steady_clock::now());
+    if(now >= deadline)
+    {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+}
+
+
+int open_pidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+    snapdev::NOT_USED(pid);
+    return -1;
+#endif
+}
+
+
+/** \brief Read the data already buffered in a pipe.
+ *
+ * Once the command exited, only the data it wrote is read. A process
+ * it started in the background may still hold the pipe so reading up
+ * to the end of the pipe could block.
+ *
+ * \param[in] fd  The pipe to read.
+ * \param[in,out] out  The string where the data gets appended.
+ */
+void drain_pipe(int fd, std::string & out)
+{
+    if(fd == -1)
+    {
+        return;
+    }
+
+    int available(0);
+    if(ioctl(fd, FIONREAD, &available) != 0)
+    {
+        return;
+    }
+    while(available > 0)
+    {
+        char buf[4096];
+        ssize_t const size(read(
+                  fd
+                , buf
+                , std::min(sizeof(buf), static_cast<std::size_t>(available))));
+        if(size <= 0)
+        {
+            if(size < 0
+            && errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        out.append(buf, size);
+        available -= size;
+    }
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Initialize a runner.
+ *
+ * The \p command is searched in the PATH.
+ *
+ * \param[in] command  The command to run.
+ * \param[in] args  The arguments of the command.
+ */
+process_runner::process_runner(
+          std::string const & command
+        , args_t const & args)
+    : f_command(command)
+    , f_args(args)
+{
+}
+
+
+/** \brief Clean up.
+ *
+ * If the command was started and not waited on, the destructor waits
+ * for it so it does not become a zombie.
+ */
+process_runner::~process_runner()
+{
+    if(f_pid != -1)
+    {
+        snapdev::NOT_USED(wait());
+    }
+    close_pipes();
+    close_pidfd();
+}
+
+
+/** \brief Change the timeout.
+ *
+ * \param[in] timeout  The maximum time the command can run in
+ * milliseconds.
+ */
+void process_runner::set_timeout(int timeout)
+{
+    f_timeout = timeout;
+}
+
+
+/** \brief Get the command line for messages.
+ *
+ * \return The command followed by its arguments separated by spaces.
+ */
+std::string process_runner::get_command_line() const
+{
+    std::string result(f_command);
+    for(auto const & a : f_args)
+    {
+        result += ' ';
+        result += a;
+    }
+    return result;
+}
+
+
+/** \brief Start the command.
+ *
+ * The function returns as soon as the command was started. Call wait()
+ * to get its exit code.
+ *
+ * \return true if the command was started.
+ */
+bool process_runner::start()
+{
+    if(f_pid != -1)
+    {
+        return false;
+    }
+
+    f_output.clear();
+    f_error.clear();
+    f_timed_out = false;
+
+    int out[2];
+    if(pipe2(out, O_CLOEXEC) != 0)
+    {
+        return false;
+    }
+    int err[2];
+    if(pipe2(err, O_CLOEXEC) != 0)
+    {
+        close(out[0]);
+        close(out[1]);
+        return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out[1], 1);
+    posix_spawn_file_actions_adddup2(&actions, err[1], 2);
+
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(f_command.c_str()));
+    for(auto const & a : f_args)
+    {
+        argv.push_back(const_cast<char *>(a.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    int const r(posix_spawnp(&f_pid, f_command.c_str(), &actions, nullptr, argv.data(), environ));
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(out[1]);
+    close(err[1]);
+    f_output_pipe = out[0];
+    f_error_pipe = err[0];
+
+    if(r != 0)
+    {
+        f_pid = -1;
+        close_pipes();
+        return false;
+    }
+
+    f_pidfd = open_pidfd(f_pid);
+
+    return true;
+}
+
+
+/** \brief Wait for the command to end.
+ *
+ * This function reads the output of the command until it exits. If the
+ * command does not exit before its timeout, it gets killed.
+ *
+ * Once the command exited, the output it left in the pipes is read and
+ * the function returns, even if a process it started in the background
+ * still holds the pipes.
+ *
+ * \return The exit code of the command or -1 if it could not be started,
+ * was killed, or timed out.
+ */
+int process_runner::wait()
+{
+    if(f_pid == -1)
+    {
+        return -1;
+    }
+
+    auto deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(f_timeout));
+    bool killed(false);
+    auto kill_on_timeout = [&]()
+    {
+        if(deadline == std::chrono::steady_clock::time_point::max()
+        || remaining_time(deadline) > 0)
+        {
+            return;
+        }
+        if(!killed)
+        {
+            killed = true;
+            f_timed_out = true;
+            kill(f_pid, SIGTERM);
+            deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(g_kill_delay);
+        }
+        else
+        {
+            kill(f_pid, SIGKILL);
+            deadline = std::chrono::steady_clock::time_point::max();
+        }
+    };
+
+    int status(0);
+    for(;;)
+    {
+        struct pollfd fds[3] = {};
+        fds[0].fd = f_output_pipe;
+        fds[0].events = POLLIN;
+        fds[1].fd = f_error_pipe;
+        fds[1].events = POLLIN;
+        fds[2].fd = f_pidfd;
+        fds[2].events = POLLIN;
+        int timeout(deadline == std::chrono::steady_clock::time_point::max()
+                        ? -1
+                        : remaining_time(deadline));
+        if(f_pidfd == -1
+        && (timeout < 0 || timeout > g_check_interval))
+        {
+            timeout = g_check_interval;
+        }
+        int const r(poll(fds, 3, timeout));
+        if(r < 0)
+        {
+            if(errno != EINTR)
+            {
+                // poll() is not usable; check the command with waitpid()
+                // at intervals, its output is lost
+                //
+                close_pipes();
+                close_pidfd();
+            }
+            continue;
+        }
+        for(int idx(0); idx < 2; ++idx)
+        {
+            if(fds[idx].fd == -1
+            || fds[idx].revents == 0)
+            {
+                continue;
+            }
+            char buf[4096];
+            ssize_t const size(read(fds[idx].fd, buf, sizeof(buf)));
+            if(size > 0)
+            {
+                (idx == 0 ? f_output : f_error).append(buf, size);
+            }
+            else if(size == 0
+                 || errno != EINTR)
+            {
+                close(fds[idx].fd);
+                (idx == 0 ? f_output_pipe : f_error_pipe) = -1;
+            }
+        }
+
+        // reap the command as soon as it exits; the pipes may remain
+        // open if it started a process in the background
+        //
+        if(f_pidfd == -1
+        || fds[2].revents != 0)
+        {
+            pid_t const p(waitpid(f_pid, &status, WNOHANG));
+            if(p == f_pid)
+            {
+                drain_pipe(f_output_pipe, f_output);
+                drain_pipe(f_error_pipe, f_error);
+                break;
+            }
+            if(p < 0
+            && errno != EINTR)
+            {
+                close_pipes();
+                close_pidfd();
+                f_pid = -1;
+                return -1;
+            }
+        }
+
+        kill_on_timeout();
+    }
+    close_pipes();
+    close_pidfd();
+    f_pid = -1;
+
+    if(f_timed_out
+    || !WIFEXITED(status))
+    {
+        return -1;
+    }
+
+    return WEXITSTATUS(status);
+}
+
+
+/** \brief Start the command and wait for it to end.
+ *
+ * \return The exit code of the command or -1 (see wait()).
+ */
+int process_runner::run()
+{
+    if(!start())
+    {
+        return -1;
+    }
+
+    return wait();
+}
+
+
+/** \brief Check whether the command was killed because of its timeout.
+ *
+ * \return true if the command timed out.
+ */
+bool process_runner::timed_out() const
+{
+    return f_timed_out;
+}
+
+
+/** \brief Get the standard output of the command.
+ *
+ * \return What the command wrote to its standard output.
+ */
+std::string const & process_runner::output() const
+{
+    return f_output;
+}
+
+
+/** \brief Get the standard error of the command.
+ *
+ * \return What the command wrote to its standard error.
+ */
+std::string const & process_runner::error() const
+{
+    return f_error;
+}
+
+
+void process_runner::close_pidfd()
+{
+    if(f_pidfd != -1)
+    {
+        close(f_pidfd);
+        f_pidfd = -1;
+    }
+}
+
+
+void process_runner::close_pipes()
+{
+    if(f_output_pipe != -1)
+    {
+        close(f_output_pipe);
+        f_output_pipe = -1;
+    }
+    if(f_error_pipe != -1)
+    {
+        close(f_error_pipe);
+        f_error_pipe = -1;
+    }
+}
+
+
+
+// vim: ts=4 sw=4 et
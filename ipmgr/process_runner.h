@@ -0,0 +1,90 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+/** \file
+ * \brief Run external commands.
+ *
+ * The process_runner class runs one command without a shell. The
+ * arguments are passed as is (no quoting, no expansion), the output is
+ * captured, and the command gets killed if it does not end within its
+ * timeout.
+ *
+ * Contrary to the cppprocess library, which shares one event dispatcher
+ * between all the processes, each runner is independent so several
+ * commands can run at the same time (i.e. start() them all, then wait()
+ * for each one of them).
+ */
+
+
+// C++
+//
+#include    <string>
+#include    <vector>
+
+
+// C
+//
+#include    <sys/types.h>
+
+
+
+class process_runner
+{
+public:
+    typedef std::vector<std::string>        args_t;
+
+    static constexpr int const  DEFAULT_TIMEOUT = 5 * 60 * 1000;    // in ms
+
+                            process_runner(
+                                  std::string const & command
+                                , args_t const & args = args_t());
+                            process_runner(process_runner const &) = delete;
+                            ~process_runner();
+
+    process_runner &        operator = (process_runner const &) = delete;
+
+    void                    set_timeout(int timeout);
+    std::string             get_command_line() const;
+    bool                    start();
+    int                     wait();
+    int                     run();
+    bool                    timed_out() const;
+    std::string const &     output() const;
+    std::string const &     error() const;
+
+private:
+    void                    close_pipes();
+    void                    close_pidfd();
+
+    std::string             f_command = std::string();
+    args_t                  f_args = args_t();
+    int                     f_timeout = DEFAULT_TIMEOUT;
+    pid_t                   f_pid = -1;
+    int                     f_pidfd = -1;
+    int                     f_output_pipe = -1;
+    int                     f_error_pipe = -1;
+    bool                    f_timed_out = false;
+    std::string             f_output = std::string();
+    std::string             f_error = std::string();
+};
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,749 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the serial number store.
+ *
+ * The store is a file with a 64 byte header followed by an array of
+ * fixed size records:
+ *
+ * \code
+ *     header:  magic (8) version (4) record size (4) count (4)
+ *              capacity (4) checksum (8) reserved (32)
+ *     record:  domain (256, NUL terminated) value (8)
+ * \endcode
+ *
+ * The value of a record is the serial number in the lower 32 bits and a
+ * check of the domain and serial number in the upper 32 bits. The value
+ * is 8 byte aligned and written with one store so an update is atomic:
+ * after a crash, a record has either the old or the new serial number.
+ * A record with an invalid check is ignored with a warning.
+ *
+ * New records are written first and counted in the header after. The
+ * header has its own checksum. If it is invalid (i.e. a crash happened
+ * while it was being updated), the header is rebuilt from the records.
+ *
+ * The serial numbers found in the old `<domain>.counter` files get
+ * imported in the store and these files deleted, except in a dry run.
+ */
+
+
+// self
+//
+#include    "serial_store.h"
+#include    "hash.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// snapdev
+//
+#include    <snapdev/glob_to_list.h>
+#include    <snapdev/mkdir_p.h>
+#include    <snapdev/not_used.h>
+#include    <snapdev/pathinfo.h>
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+
+
+// C++
+//
+#include    <cstddef>
+#include    <cstring>
+#include    <fstream>
+#include    <vector>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <sys/file.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+char const g_serial_magic[8] = { 'I', 'P', 'M', 'G', 'R', 'S', 'N', '\0' };
+
+constexpr std::uint32_t const g_serial_version = 1;
+
+constexpr std::uint32_t const g_initial_capacity = 1024;
+
+
+struct header_t
+{
+    char                f_magic[8];
+    std::uint32_t       f_version;
+    std::uint32_t       f_record_size;
+    std::uint32_t       f_count;
+    std::uint32_t       f_capacity;
+    std::uint64_t       f_checksum;
+    std::uint8_t        f_reserved[32];
+};
+static_assert(sizeof(header_t) == 64, "the serial store header must be 64 bytes");
+
+
+struct record_t
+{
+    char                f_domain[256];
+    std::uint64_t       f_value;
+};
+static_assert(sizeof(record_t) == 264, "the serial store records must be 264 bytes");
+
+
+std::uint64_t header_checksum(header_t const * header)
+{
+    return fnv1a_64(header, offsetof(header_t, f_checksum));
+}
+
+
+std::uint64_t pack_value(char const * domain, std::uint32_t serial)
+{
+    std::uint64_t const hash(fnv1a_64(domain, strlen(domain)));
+    std::uint32_t const check(static_cast<std::uint32_t>(fnv1a_64(&serial, sizeof(serial), hash)));
+    return serial | (static_cast<std::uint64_t>(check) << 32);
+}
+
+
+bool unpack_value(char const * domain, std::uint64_t value, std::uint32_t & serial)
+{
+    serial = static_cast<std::uint32_t>(value);
+    return value == pack_value(domain, serial);
+}
+
+
+std::size_t store_size(std::uint32_t capacity)
+{
+    return sizeof(header_t) + static_cast<std::size_t>(capacity) * sizeof(record_t);
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Initialize the store.
+ *
+ * The file is opened the first time a serial number is read or written.
+ *
+ * \param[in] filename  The name of the store file.
+ * \param[in] counters_directory  The directory with the old `.counter`
+ * files to import in the store.
+ * \param[in] dry_run  Whether the `.counter` files must be kept.
+ */
+serial_store::serial_store(
+          std::string const & filename
+        , std::string const & counters_directory
+        , bool dry_run)
+    : f_filename(filename)
+    , f_counters_directory(counters_directory)
+    , f_dry_run(dry_run)
+{
+}
+
+
+/** \brief Close the store.
+ *
+ * The data is not explicitly synced. Call sync() first if the serial
+ * numbers must be on disk when the function returns.
+ */
+serial_store::~serial_store()
+{
+    close();
+}
+
+
+/** \brief Retrieve the serial number of a zone.
+ *
+ * \param[in] domain  The domain name of the zone.
+ * \param[out] serial  The serial number of the zone.
+ *
+ * \return true if the serial number was found.
+ */
+bool serial_store::get(std::string const & domain, std::uint32_t & serial)
+{
+    cppthread::guard lock(f_mutex);
+
+    if(!open())
+    {
+        return false;
+    }
+
+    auto it(f_index.find(domain));
+    if(it == f_index.end())
+    {
+        return false;
+    }
+
+    record_t const * record(reinterpret_cast<record_t const *>(f_data + sizeof(header_t)) + it->second);
+    std::uint64_t const value(__atomic_load_n(&record->f_value, __ATOMIC_ACQUIRE));
+    return unpack_value(record->f_domain, value, serial);
+}
+
+
+/** \brief Save the serial number of a zone.
+ *
+ * The value is written to the memory mapped file. It becomes durable
+ * once sync() was called or the kernel flushed the page on its own.
+ *
+ * \param[in] domain  The domain name of the zone.
+ * \param[in] serial  The new serial number of the zone.
+ *
+ * \return true if the serial number was saved.
+ */
+bool serial_store::set(std::string const & domain, std::uint32_t serial)
+{
+    cppthread::guard lock(f_mutex);
+
+    if(!open())
+    {
+        return false;
+    }
+
+    auto it(f_index.find(domain));
+    if(it == f_index.end())
+    {
+        return add(domain, serial);
+    }
+
+    record_t * record(reinterpret_cast<record_t *>(f_data + sizeof(header_t)) + it->second);
+    __atomic_store_n(&record->f_value, pack_value(record->f_domain, serial), __ATOMIC_RELEASE);
+
+    return true;
+}
+
+
+/** \brief Make sure the serial numbers are on disk.
+ *
+ * \return true if the data was synced.
+ */
+bool serial_store::sync()
+{
+    cppthread::guard lock(f_mutex);
+
+    if(f_data == nullptr)
+    {
+        return true;
+    }
+
+    if(msync(f_data, f_size, MS_SYNC) != 0)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "could not sync the serial store \""
+            << f_filename
+            << "\" (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    return true;
+}
+
+
+/** \brief Close the store file.
+ *
+ * The next access opens it again.
+ */
+void serial_store::close()
+{
+    cppthread::guard lock(f_mutex);
+
+    unmap();
+    f_fd.reset();
+    f_index.clear();
+    f_opened = false;
+}
+
+
+/** \brief Get the number of zones with a valid serial number.
+ *
+ * \return The number of zones in the store.
+ */
+std::size_t serial_store::size()
+{
+    cppthread::guard lock(f_mutex);
+
+    if(!open())
+    {
+        return 0;
+    }
+
+    return f_index.size();
+}
+
+
+bool serial_store::open()
+{
+    if(f_opened)
+    {
+        return f_data != nullptr;
+    }
+    f_opened = true;
+
+    if(!load())
+    {
+        // do not keep the file (and its lock) on errors
+        //
+        unmap();
+        f_fd.reset();
+        f_index.clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+/** \brief Open, lock, and map the store file.
+ *
+ * The file remains locked with flock() until close() gets called so
+ * two ipmgr processes never update the store at the same time. The
+ * daemon closes the store between runs so a run started by hand waits
+ * for the current batch only.
+ *
+ * \return true if the store is ready.
+ */
+bool serial_store::load()
+{
+    if(snapdev::mkdir_p(f_filename, true) != 0)
+    {
+        SNAP_LOG_ERROR
+            << "could not create the directory of the serial store \""
+            << f_filename
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    f_fd.reset(::open(f_filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644));
+    if(!f_fd)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "could not open the serial store \""
+            << f_filename
+            << "\" (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    while(flock(f_fd.get(), LOCK_EX) != 0)
+    {
+        int const e(errno);
+        if(e == EINTR)
+        {
+            continue;
+        }
+        SNAP_LOG_ERROR
+            << "could not lock the serial store \""
+            << f_filename
+            << "\" (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    struct stat st = {};
+    if(fstat(f_fd.get(), &st) != 0)
+    {
+        SNAP_LOG_ERROR
+            << "could not retrieve the size of the serial store \""
+            << f_filename
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    if(st.st_size == 0)
+    {
+        // new store
+        //
+        if(!map(g_initial_capacity))
+        {
+            return false;
+        }
+        header_t * header(reinterpret_cast<header_t *>(f_data));
+        memcpy(header->f_magic, g_serial_magic, sizeof(header->f_magic));
+        header->f_version = g_serial_version;
+        header->f_record_size = sizeof(record_t);
+        header->f_count = 0;
+        header->f_capacity = g_initial_capacity;
+        update_header();
+
+        migrate();
+
+        return true;
+    }
+
+    if(static_cast<std::size_t>(st.st_size) < store_size(0)
+    || (st.st_size - store_size(0)) % sizeof(record_t) != 0)
+    {
+        SNAP_LOG_ERROR
+            << "the serial store \""
+            << f_filename
+            << "\" has an invalid size."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    std::uint32_t const capacity((st.st_size - store_size(0)) / sizeof(record_t));
+    if(!map(capacity))
+    {
+        return false;
+    }
+
+    header_t const * header(reinterpret_cast<header_t const *>(f_data));
+    if(memcmp(header->f_magic, g_serial_magic, sizeof(header->f_magic)) != 0
+    || header->f_version != g_serial_version
+    || header->f_record_size != sizeof(record_t))
+    {
+        SNAP_LOG_ERROR
+            << "\""
+            << f_filename
+            << "\" is not a serial store this version of ipmgr supports."
+            << SNAP_LOG_SEND;
+        unmap();
+        return false;
+    }
+
+    if(header->f_checksum != header_checksum(header)
+    || header->f_capacity != capacity
+    || header->f_count > capacity)
+    {
+        if(!recover())
+        {
+            unmap();
+            return false;
+        }
+    }
+
+    record_t const * records(reinterpret_cast<record_t const *>(f_data + sizeof(header_t)));
+    for(std::uint32_t idx(0); idx < header->f_count; ++idx)
+    {
+        record_t const & r(records[idx]);
+        if(memchr(r.f_domain, '\0', sizeof(r.f_domain)) == nullptr)
+        {
+            SNAP_LOG_WARNING
+                << "serial store record #"
+                << idx
+                << " has an invalid domain name; ignoring."
+                << SNAP_LOG_SEND;
+            continue;
+        }
+        std::uint32_t serial(0);
+        if(!unpack_value(r.f_domain, r.f_value, serial))
+        {
+            SNAP_LOG_WARNING
+                << "the serial number of \""
+                << r.f_domain
+                << "\" is corrupt; ignoring."
+                << SNAP_LOG_SEND;
+            continue;
+        }
+        f_index[r.f_domain] = idx;
+    }
+
+    // a dry run may have created the store without deleting the old files
+    //
+    migrate();
+
+    return true;
+}
+
+
+bool serial_store::map(std::uint32_t capacity)
+{
+    unmap();
+
+    std::size_t const size(store_size(capacity));
+    if(ftruncate(f_fd.get(), size) != 0)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "could not resize the serial store \""
+            << f_filename
+            << "\" (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    void * data(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, f_fd.get(), 0));
+    if(data == MAP_FAILED)
+    {
+        int const e(errno);
+        SNAP_LOG_ERROR
+            << "could not map the serial store \""
+            << f_filename
+            << "\" in memory (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    f_data = reinterpret_cast<std::uint8_t *>(data);
+    f_size = size;
+
+    return true;
+}
+
+
+void serial_store::unmap()
+{
+    if(f_data != nullptr)
+    {
+        munmap(f_data, f_size);
+        f_data = nullptr;
+        f_size = 0;
+    }
+}
+
+
+/** \brief Rebuild the header from the records.
+ *
+ * The records are appended in order so the count is the number of
+ * records up to the last one with a domain name.
+ *
+ * \return true if the header was rebuilt.
+ */
+bool serial_store::recover()
+{
+    header_t * header(reinterpret_cast<header_t *>(f_data));
+    std::uint32_t const capacity((f_size - store_size(0)) / sizeof(record_t));
+    record_t const * records(reinterpret_cast<record_t const *>(f_data + sizeof(header_t)));
+
+    std::uint32_t count(0);
+    for(std::uint32_t idx(0); idx < capacity; ++idx)
+    {
+        if(records[idx].f_domain[0] != '\0')
+        {
+            count = idx + 1;
+        }
+    }
+
+    SNAP_LOG_WARNING
+        << "the header of the serial store \""
+        << f_filename
+        << "\" is invalid; rebuilding it with "
+        << count
+        << " record(s)."
+        << SNAP_LOG_SEND;
+
+    header->f_count = count;
+    header->f_capacity = capacity;
+    update_header();
+
+    return true;
+}
+
+
+/** \brief Import the old counter files.
+ *
+ * Before the store existed, each zone had its serial number saved in
+ * a `<domain>.counter` file (4 bytes in the native byte order). These
+ * get imported in the store and deleted once the store was synced.
+ *
+ * A zone already found in the store keeps its current serial number;
+ * its old file was imported earlier and only needs to be deleted.
+ *
+ * In a dry run, the files are imported so the serial numbers are
+ * correct, but the files are kept. The next run deletes them.
+ */
+void serial_store::migrate()
+{
+    if(f_counters_directory.empty())
+    {
+        return;
+    }
+
+    snapdev::glob_to_list<std::vector<std::string>> glob;
+    if(!glob.read_path<snapdev::glob_to_list_flag_t::GLOB_FLAG_IGNORE_ERRORS>(f_counters_directory + "/*.counter"))
+    {
+        return;
+    }
+
+    std::vector<std::string> imported;
+    bool added(false);
+    for(auto const & g : glob)
+    {
+        std::string const domain(snapdev::pathinfo::basename(g, ".counter"));
+        if(f_index.find(domain) != f_index.end())
+        {
+            imported.push_back(g);
+            continue;
+        }
+
+        std::uint32_t serial(0);
+        std::ifstream in(g);
+        in.read(reinterpret_cast<char *>(&serial), sizeof(serial));
+        if(!in.good()
+        || serial == 0)
+        {
+            SNAP_LOG_WARNING
+                << "could not import serial number file \""
+                << g
+                << "\"; ignoring."
+                << SNAP_LOG_SEND;
+            continue;
+        }
+
+        if(add(domain, serial))
+        {
+            imported.push_back(g);
+            added = true;
+        }
+    }
+
+    if(imported.empty())
+    {
+        return;
+    }
+
+    if(added
+    && msync(f_data, f_size, MS_SYNC) != 0)
+    {
+        // keep the old files, the import happens again next time
+        //
+        SNAP_LOG_ERROR
+            << "could not sync the serial store \""
+            << f_filename
+            << "\" after importing the counter files."
+            << SNAP_LOG_SEND;
+        return;
+    }
+
+    if(f_dry_run)
+    {
+        SNAP_LOG_INFO
+            << "dry run: keeping the "
+            << imported.size()
+            << " serial number file(s) found in \""
+            << f_counters_directory
+            << "\"."
+            << SNAP_LOG_SEND;
+        return;
+    }
+
+    for(auto const & i : imported)
+    {
+        snapdev::NOT_USED(unlink(i.c_str()));
+    }
+
+    SNAP_LOG_INFO
+        << "imported "
+        << imported.size()
+        << " serial number(s) from \""
+        << f_counters_directory
+        << "\" in \""
+        << f_filename
+        << "\"."
+        << SNAP_LOG_SEND;
+}
+
+
+bool serial_store::add(std::string const & domain, std::uint32_t serial)
+{
+    if(domain.empty()
+    || domain.length() >= sizeof(record_t::f_domain))
+    {
+        SNAP_LOG_ERROR
+            << "domain name \""
+            << domain
+            << "\" cannot be saved in the serial store."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    header_t * header(reinterpret_cast<header_t *>(f_data));
+    if(header->f_count >= header->f_capacity)
+    {
+        std::uint32_t const count(header->f_count);
+        std::uint32_t const capacity(header->f_capacity * 2);
+        if(!map(capacity))
+        {
+            return false;
+        }
+        header = reinterpret_cast<header_t *>(f_data);
+        header->f_count = count;
+        header->f_capacity = capacity;
+        update_header();
+    }
+
+    // write the record first and count it after; if we crash in between,
+    // the record is ignored (or recovered if the header gets rebuilt)
+    //
+    std::uint32_t const idx(header->f_count);
+    record_t * record(reinterpret_cast<record_t *>(f_data + sizeof(header_t)) + idx);
+    memset(record->f_domain, 0, sizeof(record->f_domain));
+    memcpy(record->f_domain, domain.c_str(), domain.length());
+    __atomic_store_n(&record->f_value, pack_value(record->f_domain, serial), __ATOMIC_RELEASE);
+
+    header->f_count = idx + 1;
+    update_header();
+
+    f_index[domain] = idx;
+
+    return true;
+}
+
+
+void serial_store::update_header()
+{
+    header_t * header(reinterpret_cast<header_t *>(f_data));
+    header->f_checksum = header_checksum(header);
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,92 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+/** \file
+ * \brief Store of the zone serial numbers.
+ *
+ * The serial_store class keeps the serial number of all the zones in a
+ * single memory mapped file instead of one small file per zone.
+ */
+
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+
+
+// snapdev
+//
+#include    <snapdev/raii_generic_deleter.h>
+
+
+// C++
+//
+#include    <cstdint>
+#include    <memory>
+#include    <string>
+#include    <unordered_map>
+
+
+
+class serial_store
+{
+public:
+    typedef std::shared_ptr<serial_store>       pointer_t;
+
+                            serial_store(
+                                  std::string const & filename
+                                , std::string const & counters_directory = std::string()
+                                , bool dry_run = false);
+                            serial_store(serial_store const &) = delete;
+                            ~serial_store();
+
+    serial_store &          operator = (serial_store const &) = delete;
+
+    bool                    get(std::string const & domain, std::uint32_t & serial);
+    bool                    set(std::string const & domain, std::uint32_t serial);
+    bool                    sync();
+    void                    close();
+    std::size_t             size();
+
+private:
+    typedef std::unordered_map<std::string, std::uint32_t>  index_t;
+
+    bool                    open();
+    bool                    load();
+    bool                    map(std::uint32_t capacity);
+    void                    unmap();
+    bool                    recover();
+    void                    migrate();
+    bool                    add(std::string const & domain, std::uint32_t serial);
+    void                    update_header();
+
+    cppthread::mutex        f_mutex = cppthread::mutex();
+    std::string             f_filename = std::string();
+    std::string             f_counters_directory = std::string();
+    snapdev::raii_fd_t      f_fd = snapdev::raii_fd_t();
+    std::uint8_t *          f_data = nullptr;
+    std::size_t             f_size = 0;
+    bool                    f_opened = false;
+    bool                    f_dry_run = false;
+    index_t                 f_index = index_t();    // domain -> record number
+};
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,133 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the serial number strategies.
+ *
+ * The serial number of a zone must always increase. Whatever the
+ * strategy, the next serial number is at least the last serial number
+ * plus one. This also covers a switch from one strategy to another
+ * as long as the new serial numbers are larger (i.e. counter to date
+ * or to Unix time).
+ */
+
+
+// self
+//
+#include    "serial_strategy.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+/** \brief Convert a serial strategy name to a strategy.
+ *
+ * The supported names are "counter", "date", and "unixtime".
+ *
+ * \param[in] name  The name of the strategy.
+ * \param[out] strategy  The corresponding strategy.
+ *
+ * \return true if \p name is a valid strategy name.
+ */
+bool string_to_serial_strategy(std::string const & name, serial_strategy_t & strategy)
+{
+    if(name == "counter")
+    {
+        strategy = serial_strategy_t::SERIAL_STRATEGY_COUNTER;
+        return true;
+    }
+    if(name == "date")
+    {
+        strategy = serial_strategy_t::SERIAL_STRATEGY_DATE;
+        return true;
+    }
+    if(name == "unixtime")
+    {
+        strategy = serial_strategy_t::SERIAL_STRATEGY_UNIXTIME;
+        return true;
+    }
+
+    return false;
+}
+
+
+/** \brief Compute the next serial number of a zone.
+ *
+ * With the counter strategy, the serial number is \p last plus one.
+ *
+ * With the date strategy, the serial number is the current date (UTC)
+ * followed by a two digit revision starting at 00. If the zone changes
+ * more than 100 times in one day, the revision overflows in the next
+ * day, which remains a valid (increasing) serial number.
+ *
+ * With the Unix time strategy, the serial number is the current time
+ * in seconds.
+ *
+ * In all cases, the result is larger than \p last (0 is skipped when
+ * the counter wraps around).
+ *
+ * \param[in] strategy  The strategy to use.
+ * \param[in] last  The last serial number of the zone or 0 if unknown.
+ * \param[in] now  The current time.
+ *
+ * \return The next serial number.
+ */
+std::uint32_t next_serial(serial_strategy_t strategy, std::uint32_t last, time_t now)
+{
+    std::uint32_t base(0);
+    switch(strategy)
+    {
+    case serial_strategy_t::SERIAL_STRATEGY_COUNTER:
+        break;
+
+    case serial_strategy_t::SERIAL_STRATEGY_DATE:
+        {
+            struct tm t = {};
+            gmtime_r(&now, &t);
+            base = static_cast<std::uint32_t>(
+                      ((t.tm_year + 1900) * 10000
+                     + (t.tm_mon + 1) * 100
+                     + t.tm_mday)) * 100;
+        }
+        break;
+
+    case serial_strategy_t::SERIAL_STRATEGY_UNIXTIME:
+        base = static_cast<std::uint32_t>(now);
+        break;
+
+    }
+
+    std::uint32_t serial(last + 1);
+    if(serial == 0)
+    {
+        serial = 1;
+    }
+    if(base > serial)
+    {
+        serial = base;
+    }
+
+    return serial;
+}
+
+
+
+// vim: ts=4 sw=4 et
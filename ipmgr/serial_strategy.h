@@ -0,0 +1,53 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+/** \file
+ * \brief Strategies used to compute the next serial number of a zone.
+ *
+ * A zone serial number can be a simple counter, a date followed by a
+ * two digit revision (YYYYMMDDnn), or the Unix time. The date and Unix
+ * time strategies only depend on the clock and the last serial number
+ * so a new server generates valid serial numbers without a copy of the
+ * serial store of another server.
+ */
+
+
+// C++
+//
+#include    <cstdint>
+#include    <ctime>
+#include    <string>
+
+
+
+enum class serial_strategy_t
+{
+    SERIAL_STRATEGY_COUNTER,    // 1, 2, 3, ...
+    SERIAL_STRATEGY_DATE,       // YYYYMMDDnn (UTC)
+    SERIAL_STRATEGY_UNIXTIME,   // seconds since the Unix epoch
+};
+
+
+bool                        string_to_serial_strategy(std::string const & name, serial_strategy_t & strategy);
+std::uint32_t               next_serial(serial_strategy_t strategy, std::uint32_t last, time_t now);
+
+
+
+// vim: ts=4 sw=4 et
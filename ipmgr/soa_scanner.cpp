@@ -0,0 +1,326 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+/** \file
+ * \brief Implementation of the SOA serial number scanner.
+ *
+ * Dynamic zones are rewritten by bind9 and can grow large. The serial
+ * number is in the SOA which appears at the start of the file so the
+ * scanner only touches the first few pages of the mapped file.
+ */
+
+
+// self
+//
+#include    "soa_scanner.h"
+
+
+// C++
+//
+#include    <cstring>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+/** \brief Load the serial number from a zone file.
+ *
+ * The file is memory mapped and scanned with scan(). A file that does
+ * not exist is not an error here; the caller falls back to another
+ * source for the serial number.
+ *
+ * \param[in] filename  The name of the zone file.
+ *
+ * \return true if the serial number was found.
+ */
+bool soa_scanner::load(std::string const & filename)
+{
+    f_serial = 0;
+
+    int const fd(open(filename.c_str(), O_RDONLY | O_CLOEXEC));
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st = {};
+    if(fstat(fd, &st) != 0
+    || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    std::size_t const size(st.st_size);
+    void * data(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+    if(data == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    bool const result(scan(reinterpret_cast<char const *>(data), size));
+
+    munmap(data, size);
+
+    return result;
+}
+
+
+/** \brief Search the SOA serial number in a zone.
+ *
+ * The function goes through the zone once, token by token. Comments,
+ * quoted strings, and parenthesis are handled so the SOA fields can
+ * span multiple lines. A token at the very start of a line is the owner
+ * name and is never taken as the record type.
+ *
+ * The scan stops on the first SOA record. Its third field is the serial
+ * number.
+ *
+ * \param[in] data  The zone data.
+ * \param[in] size  The size of \p data in bytes.
+ *
+ * \return true if the serial number was found.
+ */
+bool soa_scanner::scan(char const * data, std::size_t size)
+{
+    f_serial = 0;
+
+    char const * s(data);
+    char const * const end(data + size);
+    bool line_start(true);
+    int parenthesis(0);
+    int soa_field(-1);
+    while(s < end)
+    {
+        char const c(*s);
+        switch(c)
+        {
+        case '\n':
+            ++s;
+            line_start = parenthesis == 0;
+            continue;
+
+        case ' ':
+        case '\t':
+        case '\r':
+            ++s;
+            line_start = false;
+            continue;
+
+        case ';':
+            s = reinterpret_cast<char const *>(memchr(s, '\n', end - s));
+            if(s == nullptr)
+            {
+                return false;
+            }
+            continue;
+
+        case '(':
+            ++s;
+            ++parenthesis;
+            line_start = false;
+            continue;
+
+        case ')':
+            ++s;
+            if(parenthesis > 0)
+            {
+                --parenthesis;
+            }
+            line_start = false;
+            continue;
+
+        default:
+            break;
+
+        }
+
+        bool const owner(line_start);
+        line_start = false;
+
+        char const * const token(s);
+        if(c == '"')
+        {
+            for(++s; s < end && *s != '"'; ++s)
+            {
+                if(*s == '\\')
+                {
+                    ++s;
+                }
+            }
+            if(s < end)
+            {
+                ++s;
+            }
+        }
+        else
+        {
+            for(; s < end; ++s)
+            {
+                if(*s == '\\')
+                {
+                    ++s;
+                    continue;
+                }
+                if(*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n'
+                || *s == ';' || *s == '(' || *s == ')' || *s == '"')
+                {
+                    break;
+                }
+            }
+        }
+        if(s > end)
+        {
+            s = end;
+        }
+        std::size_t const length(s - token);
+
+        if(soa_field >= 0)
+        {
+            // fields: MNAME RNAME SERIAL ...
+            //
+            ++soa_field;
+            if(soa_field == 3)
+            {
+                return convert_serial(token, length, f_serial);
+            }
+        }
+        else if(!owner
+             && length == 3
+             && (token[0] == 'S' || token[0] == 's')
+             && (token[1] == 'O' || token[1] == 'o')
+             && (token[2] == 'A' || token[2] == 'a'))
+        {
+            soa_field = 0;
+        }
+    }
+
+    return false;
+}
+
+
+/** \brief Retrieve the serial number from the output of `rndc zonestatus`.
+ *
+ * The output includes one line with the serial number of the zone as
+ * loaded by bind9:
+ *
+ * \code
+ *     serial: 2025010203
+ * \endcode
+ *
+ * \param[in] output  The output of the `rndc zonestatus` command.
+ *
+ * \return true if the serial number was found.
+ */
+bool soa_scanner::parse_zonestatus(std::string const & output)
+{
+    f_serial = 0;
+
+    std::string::size_type pos(0);
+    while(pos < output.length())
+    {
+        std::string::size_type eol(output.find('\n', pos));
+        if(eol == std::string::npos)
+        {
+            eol = output.length();
+        }
+        if(output.compare(pos, 7, "serial:") == 0)
+        {
+            std::string::size_type start(pos + 7);
+            while(start < eol
+               && (output[start] == ' ' || output[start] == '\t'))
+            {
+                ++start;
+            }
+            std::string::size_type stop(eol);
+            while(stop > start
+               && (output[stop - 1] == ' ' || output[stop - 1] == '\t' || output[stop - 1] == '\r'))
+            {
+                --stop;
+            }
+            return convert_serial(output.c_str() + start, stop - start, f_serial);
+        }
+        pos = eol + 1;
+    }
+
+    return false;
+}
+
+
+/** \brief Get the serial number found by the last scan.
+ *
+ * \return The serial number or 0 if it was not found.
+ */
+std::uint32_t soa_scanner::serial() const
+{
+    return f_serial;
+}
+
+
+/** \brief Convert a serial number.
+ *
+ * A serial number is an unsigned 32 bit decimal number.
+ *
+ * \param[in] s  The string to convert.
+ * \param[in] length  The number of characters in \p s.
+ * \param[out] serial  The resulting serial number.
+ *
+ * \return true if \p s is a valid serial number.
+ */
+bool soa_scanner::convert_serial(char const * s, std::size_t length, std::uint32_t & serial)
+{
+    if(length == 0
+    || length > 10)
+    {
+        return false;
+    }
+
+    std::uint64_t value(0);
+    for(std::size_t i(0); i < length; ++i)
+    {
+        if(s[i] < '0' || s[i] > '9')
+        {
+            return false;
+        }
+        value = value * 10 + s[i] - '0';
+    }
+    if(value > 0xFFFFFFFF)
+    {
+        return false;
+    }
+
+    serial = static_cast<std::uint32_t>(value);
+    return true;
+}
+
+
+
+// vim: ts=4 sw=4 et
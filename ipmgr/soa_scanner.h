@@ -0,0 +1,54 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+/** \file
+ * \brief Extract the serial number from the SOA of a zone.
+ *
+ * The soa_scanner class finds the serial number of a zone without
+ * loading the whole zone file. The file is memory mapped and scanned
+ * once, stopping at the first SOA record. It can also ask bind9 for
+ * the serial number of the zone it has loaded (`rndc zonestatus`).
+ */
+
+
+// C++
+//
+#include    <cstdint>
+#include    <string>
+
+
+
+class soa_scanner
+{
+public:
+    bool                    load(std::string const & filename);
+    bool                    scan(char const * data, std::size_t size);
+    bool                    parse_zonestatus(std::string const & output);
+    std::uint32_t           serial() const;
+
+    static bool             convert_serial(char const * s, std::size_t length, std::uint32_t & serial);
+
+private:
+    std::uint32_t           f_serial = 0;
+};
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,432 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+/** \file
+ * \brief Implementation of the zone fingerprint cache.
+ *
+ * The cache is a simple text file with one entry per line. File entries
+ * describe one zone configuration file:
+ *
+ * \code
+ *     file <mtime sec> <mtime nsec> <size> <hash> <domain> <path>
+ * \endcode
+ *
+ * The path is last since it may include spaces.
+ *
+ * Zone entries describe the last successfully generated zone:
+ *
+ * \code
+ *     zone <domain> <fingerprint> <group> <dynamic> <auth server> <ptr> <mail subdomain>
+ * \endcode
+ *
+ * An empty PTR or mail subdomain is saved as a dash (-).
+ *
+ * Output entries describe the last version of a generated file:
+ *
+ * \code
+ *     output <size> <hash> <serial> <path>
+ * \endcode
+ *
+ * The hash is the FNV-1a 64 bit hash of the entire file and the serial
+ * is the serial number saved in its SOA. This allows for regenerating
+ * the previous header and checking whether the file changed without
+ * reading it.
+ *
+ * If the file is missing, invalid, or was saved with a different version,
+ * it is ignored and all the zones get regenerated.
+ */
+
+
+// self
+//
+#include    "zone_cache.h"
+#include    "output_stage.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// C++
+//
+#include    <fstream>
+#include    <sstream>
+
+
+// snapdev
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+char const * const g_cache_magic = "ipmgr-zone-cache";
+
+constexpr int const g_cache_version = 2;
+
+
+}
+// no name namespace
+
+
+
+/** \brief Initialize the cache.
+ *
+ * The constructor only saves the filename. Call load() to read the
+ * entries of the last run.
+ *
+ * \param[in] filename  The name of the file where the cache is saved.
+ */
+zone_cache::zone_cache(std::string const & filename)
+    : f_filename(filename)
+{
+}
+
+
+/** \brief Load the cache.
+ *
+ * This function loads the entries saved by the last run. If anything is
+ * wrong with the file, the entries loaded so far are cleared and the
+ * function returns false. This means all the zones will be regenerated.
+ *
+ * \return true if the cache was loaded.
+ */
+bool zone_cache::load()
+{
+    f_cached_files.clear();
+    f_cached_zones.clear();
+    f_cached_outputs.clear();
+
+    std::ifstream in(f_filename);
+    if(!in.is_open())
+    {
+        // first run or the file was deleted
+        //
+        return false;
+    }
+
+    bool valid_version(false);
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.empty()
+        || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream ss(line);
+        std::string type;
+        ss >> type;
+        if(type == g_cache_magic)
+        {
+            int version(0);
+            ss >> version;
+            valid_version = version == g_cache_version;
+            if(!valid_version)
+            {
+                break;
+            }
+            continue;
+        }
+        if(!valid_version)
+        {
+            break;
+        }
+
+        if(type == "file")
+        {
+            file_entry entry;
+            std::string filename;
+            ss >> entry.f_mtime_sec
+               >> entry.f_mtime_nsec
+               >> entry.f_size
+               >> std::hex >> entry.f_hash >> std::dec
+               >> entry.f_domain;
+            ss.get();   // skip the space before the path
+            std::getline(ss, filename);
+            if(ss.fail()
+            || filename.empty())
+            {
+                valid_version = false;
+                break;
+            }
+            f_cached_files[filename] = entry;
+        }
+        else if(type == "zone")
+        {
+            zone_entry entry;
+            std::string domain;
+            ss >> domain
+               >> std::hex >> entry.f_fingerprint >> std::dec
+               >> entry.f_group
+               >> entry.f_dynamic
+               >> entry.f_auth_server
+               >> entry.f_ptr
+               >> entry.f_mail_subdomain;
+            if(ss.fail())
+            {
+                valid_version = false;
+                break;
+            }
+            if(entry.f_ptr == "-")
+            {
+                entry.f_ptr.clear();
+            }
+            if(entry.f_mail_subdomain == "-")
+            {
+                entry.f_mail_subdomain.clear();
+            }
+            f_cached_zones[domain] = entry;
+        }
+        else if(type == "output")
+        {
+            output_entry entry;
+            std::string filename;
+            ss >> entry.f_size
+               >> std::hex >> entry.f_hash >> std::dec
+               >> entry.f_serial;
+            ss.get();   // skip the space before the path
+            std::getline(ss, filename);
+            if(ss.fail()
+            || filename.empty())
+            {
+                valid_version = false;
+                break;
+            }
+            f_cached_outputs[filename] = entry;
+        }
+        else
+        {
+            valid_version = false;
+            break;
+        }
+    }
+
+    if(!valid_version)
+    {
+        SNAP_LOG_WARNING
+            << "ignoring invalid zone cache \""
+            << f_filename
+            << "\"; all the zones will be regenerated."
+            << SNAP_LOG_SEND;
+        f_cached_files.clear();
+        f_cached_zones.clear();
+        f_cached_outputs.clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+/** \brief Save the cache.
+ *
+ * This function saves the entries which were set with set_file(),
+ * set_zone(), and set_output() during this run. Entries that were loaded but not set
+ * again are dropped (i.e. the file or zone was removed or failed).
+ *
+ * \return true if the cache was saved successfully.
+ */
+bool zone_cache::save() const
+{
+    std::stringstream ss;
+    ss << "# AUTO-GENERATED FILE, DO NOT EDIT\n"
+       << g_cache_magic
+       << ' '
+       << g_cache_version
+       << '\n';
+
+    for(auto const & f : f_files)
+    {
+        ss << "file "
+           << f.second.f_mtime_sec
+           << ' '
+           << f.second.f_mtime_nsec
+           << ' '
+           << f.second.f_size
+           << ' '
+           << std::hex << f.second.f_hash << std::dec
+           << ' '
+           << f.second.f_domain
+           << ' '
+           << f.first
+           << '\n';
+    }
+
+    for(auto const & z : f_zones)
+    {
+        ss << "zone "
+           << z.first
+           << ' '
+           << std::hex << z.second.f_fingerprint << std::dec
+           << ' '
+           << z.second.f_group
+           << ' '
+           << z.second.f_dynamic
+           << ' '
+           << z.second.f_auth_server
+           << ' '
+           << (z.second.f_ptr.empty() ? "-" : z.second.f_ptr)
+           << ' '
+           << (z.second.f_mail_subdomain.empty() ? "-" : z.second.f_mail_subdomain)
+           << '\n';
+    }
+
+    for(auto const & o : f_outputs)
+    {
+        ss << "output "
+           << o.second.f_size
+           << ' '
+           << std::hex << o.second.f_hash << std::dec
+           << ' '
+           << o.second.f_serial
+           << ' '
+           << o.first
+           << '\n';
+    }
+
+    // a crash while saving must not leave a truncated cache behind
+    //
+    output_stage cache;
+    if(!cache.stage(f_filename, ss.str())
+    || !cache.commit())
+    {
+        SNAP_LOG_ERROR
+            << "could not save zone cache to \""
+            << f_filename
+            << "\"."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    return true;
+}
+
+
+/** \brief Prepare the cache for another run.
+ *
+ * When ipmgr runs as a daemon, the entries of this run become the
+ * entries of the last run without having to save and reload the cache.
+ */
+void zone_cache::rotate()
+{
+    f_cached_files.swap(f_files);
+    f_cached_zones.swap(f_zones);
+    f_cached_outputs.swap(f_outputs);
+    f_files.clear();
+    f_zones.clear();
+    f_outputs.clear();
+}
+
+
+/** \brief Search for a file entry saved by the last run.
+ *
+ * \param[in] filename  The name of the zone configuration file.
+ *
+ * \return A pointer to the entry or nullptr if not found.
+ */
+zone_cache::file_entry const * zone_cache::find_file(std::string const & filename) const
+{
+    auto it(f_cached_files.find(filename));
+    if(it == f_cached_files.end())
+    {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+
+/** \brief Save a file entry for the next run.
+ *
+ * \param[in] filename  The name of the zone configuration file.
+ * \param[in] entry  The information about that file.
+ */
+void zone_cache::set_file(std::string const & filename, file_entry const & entry)
+{
+    f_files[filename] = entry;
+}
+
+
+/** \brief Search for a zone entry saved by the last run.
+ *
+ * \param[in] domain  The domain name of the zone.
+ *
+ * \return A pointer to the entry or nullptr if not found.
+ */
+zone_cache::zone_entry const * zone_cache::find_zone(std::string const & domain) const
+{
+    auto it(f_cached_zones.find(domain));
+    if(it == f_cached_zones.end())
+    {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+
+/** \brief Save a zone entry for the next run.
+ *
+ * \param[in] domain  The domain name of the zone.
+ * \param[in] entry  The information about that zone.
+ */
+void zone_cache::set_zone(std::string const & domain, zone_entry const & entry)
+{
+    f_zones[domain] = entry;
+}
+
+
+/** \brief Search for the index entry of a generated file.
+ *
+ * The entries are only read while the zones are being generated so
+ * this function can be called by several zone workers simultaneously.
+ *
+ * \param[in] filename  The name of the generated file.
+ *
+ * \return A pointer to the entry or nullptr if not found.
+ */
+zone_cache::output_entry const * zone_cache::find_output(std::string const & filename) const
+{
+    auto it(f_cached_outputs.find(filename));
+    if(it == f_cached_outputs.end())
+    {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+
+/** \brief Save the index entry of a generated file for the next run.
+ *
+ * \param[in] filename  The name of the generated file.
+ * \param[in] entry  The size, hash, and serial of that file.
+ */
+void zone_cache::set_output(std::string const & filename, output_entry const & entry)
+{
+    f_outputs[filename] = entry;
+}
+
+
+
+// vim: ts=4 sw=4 et
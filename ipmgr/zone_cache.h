@@ -0,0 +1,105 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+/** \file
+ * \brief Cache of the zone fingerprints.
+ *
+ * The zone_cache class saves information about the zone configuration
+ * files and the zones generated from them between runs so zones which
+ * did not change can be skipped entirely.
+ *
+ * It also keeps an index of the generated files so changes can be
+ * detected without reading the previous version of each file.
+ */
+
+
+// C++
+//
+#include    <cstdint>
+#include    <map>
+#include    <string>
+
+
+
+class zone_cache
+{
+public:
+    struct file_entry
+    {
+        std::int64_t            f_mtime_sec = 0;
+        std::int64_t            f_mtime_nsec = 0;
+        std::int64_t            f_size = 0;
+        std::uint64_t           f_hash = 0;
+        std::string             f_domain = std::string();
+    };
+
+    struct zone_entry
+    {
+        std::uint64_t           f_fingerprint = 0;
+        std::string             f_group = std::string();
+        int                     f_dynamic = 0;
+        bool                    f_auth_server = false;
+        std::string             f_ptr = std::string();
+        std::string             f_mail_subdomain = std::string();
+    };
+
+    struct output_entry
+    {
+        std::uint64_t           f_size = 0;
+        std::uint64_t           f_hash = 0;
+        std::uint32_t           f_serial = 0;
+    };
+
+    typedef std::map<std::string, file_entry>   file_map_t;
+    typedef std::map<std::string, zone_entry>   zone_map_t;
+    typedef std::map<std::string, output_entry> output_map_t;
+
+                            zone_cache(std::string const & filename);
+
+    bool                    load();
+    bool                    save() const;
+    void                    rotate();
+
+    file_entry const *      find_file(std::string const & filename) const;
+    void                    set_file(std::string const & filename, file_entry const & entry);
+    zone_entry const *      find_zone(std::string const & domain) const;
+    void                    set_zone(std::string const & domain, zone_entry const & entry);
+    output_entry const *    find_output(std::string const & filename) const;
+    void                    set_output(std::string const & filename, output_entry const & entry);
+
+private:
+    std::string             f_filename = std::string();
+
+    // what we loaded from the last run
+    //
+    file_map_t              f_cached_files = file_map_t();
+    zone_map_t              f_cached_zones = zone_map_t();
+    output_map_t            f_cached_outputs = output_map_t();
+
+    // what we found valid in this run and save on exit
+    //
+    file_map_t              f_files = file_map_t();
+    zone_map_t              f_zones = zone_map_t();
+    output_map_t            f_outputs = output_map_t();
+};
+
+
+
+// vim: ts=4 sw=4 et
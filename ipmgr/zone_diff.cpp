@@ -0,0 +1,487 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+/** \file
+ * \brief Implementation of the zone differences.
+ *
+ * The parser only supports the subset of the zone file syntax that
+ * ipmgr generates: the `$ORIGIN` and `$TTL` directives, a blank owner
+ * meaning "same owner as the previous record", an optional TTL and
+ * class, and parenthesis to write one record on multiple lines (used
+ * by the OpenDKIM keys).
+ *
+ * The SOA record is ignored. bind9 increments the serial number itself
+ * on each update and the caller is expected to verify that the other
+ * SOA fields did not change.
+ */
+
+
+// self
+//
+#include    "zone_diff.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// C++
+//
+#include    <sstream>
+#include    <vector>
+
+
+// snapdev
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+/** \brief Break the zone in logical lines.
+ *
+ * This function removes the comments and joins the lines written
+ * between parenthesis. Quoted strings are kept as is.
+ *
+ * \param[in] zone  The zone to break in lines.
+ *
+ * \return The list of logical lines, empty lines excluded.
+ */
+std::vector<std::string> logical_lines(std::string const & zone)
+{
+    std::vector<std::string> result;
+    std::string line;
+    bool quoted(false);
+    bool comment(false);
+    int depth(0);
+    for(char const * s(zone.c_str()); *s != '\0'; ++s)
+    {
+        char const c(*s);
+        if(comment)
+        {
+            if(c != '\n')
+            {
+                continue;
+            }
+            comment = false;
+        }
+        if(quoted)
+        {
+            line += c;
+            if(c == '\\'
+            && s[1] != '\0')
+            {
+                ++s;
+                line += *s;
+            }
+            else if(c == '"')
+            {
+                quoted = false;
+            }
+            continue;
+        }
+        switch(c)
+        {
+        case '"':
+            quoted = true;
+            line += c;
+            break;
+
+        case ';':
+            comment = true;
+            break;
+
+        case '(':
+            ++depth;
+            line += ' ';
+            break;
+
+        case ')':
+            --depth;
+            line += ' ';
+            break;
+
+        case '\n':
+            if(depth > 0)
+            {
+                line += ' ';
+                break;
+            }
+            if(line.find_first_not_of(" \t") != std::string::npos)
+            {
+                result.push_back(line);
+            }
+            line.clear();
+            break;
+
+        default:
+            line += c;
+            break;
+
+        }
+    }
+    if(line.find_first_not_of(" \t") != std::string::npos)
+    {
+        result.push_back(line);
+    }
+
+    return result;
+}
+
+
+/** \brief Split a logical line in tokens.
+ *
+ * Tokens are separated by spaces and tabs. A quoted string is one
+ * token and its quotes are kept.
+ *
+ * \param[in] line  The line to split.
+ *
+ * \return The list of tokens.
+ */
+std::vector<std::string> split_tokens(std::string const & line)
+{
+    std::vector<std::string> result;
+    std::string token;
+    bool quoted(false);
+    for(char const * s(line.c_str()); *s != '\0'; ++s)
+    {
+        char const c(*s);
+        if(quoted)
+        {
+            token += c;
+            if(c == '\\'
+            && s[1] != '\0')
+            {
+                ++s;
+                token += *s;
+            }
+            else if(c == '"')
+            {
+                quoted = false;
+            }
+            continue;
+        }
+        if(c == ' '
+        || c == '\t')
+        {
+            if(!token.empty())
+            {
+                result.push_back(token);
+                token.clear();
+            }
+            continue;
+        }
+        if(c == '"')
+        {
+            quoted = true;
+        }
+        token += c;
+    }
+    if(!token.empty())
+    {
+        result.push_back(token);
+    }
+
+    return result;
+}
+
+
+bool is_number(std::string const & s)
+{
+    if(s.empty())
+    {
+        return false;
+    }
+    for(auto const c : s)
+    {
+        if(c < '0' || c > '9')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+std::string absolute_name(std::string const & name, std::string const & origin)
+{
+    if(name == "@")
+    {
+        return origin;
+    }
+    if(name.back() == '.')
+    {
+        return name;
+    }
+    if(origin == ".")
+    {
+        return name + '.';
+    }
+    return name + '.' + origin;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Parse a zone file generated by ipmgr.
+ *
+ * This function parses \p zone and adds its records to \p rrsets. The
+ * owner names are made absolute.
+ *
+ * \param[in] zone  The zone file contents.
+ * \param[out] rrsets  The map where the records get saved.
+ *
+ * \return true if the zone was parsed successfully.
+ */
+bool zone_diff::parse_zone(std::string const & zone, rrset_map_t & rrsets)
+{
+    std::string origin(".");
+    std::int32_t default_ttl(0);
+    std::string owner;
+    for(auto const & l : logical_lines(zone))
+    {
+        std::vector<std::string> const tokens(split_tokens(l));
+        if(tokens.empty())
+        {
+            continue;
+        }
+        if(l[0] == '$')
+        {
+            if(tokens.size() != 2)
+            {
+                SNAP_LOG_ERROR
+                    << "invalid zone directive \""
+                    << l
+                    << "\"."
+                    << SNAP_LOG_SEND;
+                return false;
+            }
+            if(tokens[0] == "$ORIGIN")
+            {
+                origin = absolute_name(tokens[1], ".");
+            }
+            else if(tokens[0] == "$TTL" && is_number(tokens[1]))
+            {
+                default_ttl = std::stol(tokens[1]);
+            }
+            else
+            {
+                SNAP_LOG_ERROR
+                    << "unsupported zone directive \""
+                    << l
+                    << "\"."
+                    << SNAP_LOG_SEND;
+                return false;
+            }
+            continue;
+        }
+
+        std::size_t idx(0);
+        if(l[0] != ' '
+        && l[0] != '\t')
+        {
+            owner = absolute_name(tokens[0], origin);
+            ++idx;
+        }
+        if(owner.empty())
+        {
+            SNAP_LOG_ERROR
+                << "zone record \""
+                << l
+                << "\" has no owner."
+                << SNAP_LOG_SEND;
+            return false;
+        }
+
+        std::int32_t ttl(default_ttl);
+        if(idx < tokens.size()
+        && is_number(tokens[idx]))
+        {
+            ttl = std::stol(tokens[idx]);
+            ++idx;
+        }
+        if(idx < tokens.size()
+        && tokens[idx] == "IN")
+        {
+            ++idx;
+        }
+        if(idx + 1 >= tokens.size())
+        {
+            SNAP_LOG_ERROR
+                << "zone record \""
+                << l
+                << "\" is missing its type or data."
+                << SNAP_LOG_SEND;
+            return false;
+        }
+        std::string const & type(tokens[idx]);
+        ++idx;
+
+        if(type == "SOA")
+        {
+            continue;
+        }
+
+        std::string data(tokens[idx]);
+        for(++idx; idx < tokens.size(); ++idx)
+        {
+            data += ' ';
+            data += tokens[idx];
+        }
+
+        rrsets[rrset_name_t(owner, type)].insert(record_t(ttl, data));
+    }
+
+    return true;
+}
+
+
+/** \brief Load the previous and next versions of the zone.
+ *
+ * \param[in] previous  The zone as it was last generated.
+ * \param[in] next  The zone as just generated.
+ *
+ * \return true if both zones were parsed successfully.
+ */
+bool zone_diff::load(std::string const & previous, std::string const & next)
+{
+    f_previous.clear();
+    f_next.clear();
+
+    return parse_zone(previous, f_previous)
+        && parse_zone(next, f_next);
+}
+
+
+/** \brief Check whether the two zones are equivalent.
+ *
+ * \return true if no RRset changed.
+ */
+bool zone_diff::empty() const
+{
+    return f_previous == f_next;
+}
+
+
+/** \brief Count the number of RRsets which changed.
+ *
+ * \return The number of RRsets added, removed, or modified.
+ */
+std::size_t zone_diff::size() const
+{
+    std::size_t count(0);
+    for(auto const & p : f_previous)
+    {
+        auto const it(f_next.find(p.first));
+        if(it == f_next.end()
+        || it->second != p.second)
+        {
+            ++count;
+        }
+    }
+    for(auto const & n : f_next)
+    {
+        if(f_previous.find(n.first) == f_previous.end())
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+
+/** \brief Generate the nsupdate script applying the differences.
+ *
+ * The records which disappeared are deleted one by one and the new
+ * records get added. Records are not deleted as a whole RRset because
+ * bind9 ignores the deletion of the NS RRset at the apex of a zone.
+ * When only the TTL of a record changed, it is deleted and added back.
+ * All the changes are sent in a single transaction.
+ *
+ * \param[in] zone  The name of the zone being updated.
+ *
+ * \return The nsupdate script.
+ */
+std::string zone_diff::nsupdate_script(std::string const & zone) const
+{
+    std::stringstream script;
+
+    script << "zone " << zone << ".\n";
+
+    rrset_t const no_records;
+    for(auto const & p : f_previous)
+    {
+        auto const it(f_next.find(p.first));
+        rrset_t const & next(it == f_next.end() ? no_records : it->second);
+        for(auto const & r : p.second)
+        {
+            if(next.find(r) != next.end())
+            {
+                continue;
+            }
+            script
+                << "update delete "
+                << p.first.first
+                << ' '
+                << p.first.second
+                << ' '
+                << r.second
+                << '\n';
+        }
+    }
+
+    for(auto const & n : f_next)
+    {
+        auto const it(f_previous.find(n.first));
+        rrset_t const & previous(it == f_previous.end() ? no_records : it->second);
+        for(auto const & r : n.second)
+        {
+            if(previous.find(r) != previous.end())
+            {
+                continue;
+            }
+            script
+                << "update add "
+                << n.first.first
+                << ' '
+                << r.first
+                << ' '
+                << n.first.second
+                << ' '
+                << r.second
+                << '\n';
+        }
+    }
+
+    script << "send\n";
+
+    return script.str();
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,62 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+/** \file
+ * \brief Compute the differences between two versions of a zone.
+ *
+ * The zone_diff class parses two versions of a zone file as generated
+ * by ipmgr and compares them RRset by RRset. The result can be sent to
+ * bind9 as one nsupdate transaction so dynamic zones can be updated
+ * without stopping bind9.
+ */
+
+
+// C++
+//
+#include    <cstdint>
+#include    <map>
+#include    <set>
+#include    <string>
+
+
+
+class zone_diff
+{
+public:
+    typedef std::pair<std::string, std::string>         rrset_name_t;   // owner, type
+    typedef std::pair<std::int32_t, std::string>        record_t;       // ttl, data
+    typedef std::set<record_t>                          rrset_t;
+    typedef std::map<rrset_name_t, rrset_t>             rrset_map_t;
+
+    bool                    load(std::string const & previous, std::string const & next);
+    bool                    empty() const;
+    std::size_t             size() const;
+    std::string             nsupdate_script(std::string const & zone) const;
+
+    static bool             parse_zone(std::string const & zone, rrset_map_t & rrsets);
+
+private:
+    rrset_map_t             f_previous = rrset_map_t();
+    rrset_map_t             f_next = rrset_map_t();
+};
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,348 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+/** \file
+ * \brief Implementation of the zone records.
+ *
+ * Records are rendered as:
+ *
+ * \code
+ *     <owner>\t[<ttl> ]<type><separator><data>
+ * \endcode
+ *
+ * The owner is empty when the record applies to the same owner as the
+ * previous record. The TTL is only written when not zero. The separator
+ * depends on the type, see record_format().
+ */
+
+
+// self
+//
+#include    "zone_records.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <charconv>
+
+
+// snapdev
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+/** \brief Convert a TTL to the way it gets rendered.
+ *
+ * \param[in] ttl  The TTL to convert.
+ * \param[out] buf  The output buffer, large enough for any 32 bit number.
+ *
+ * \return The number of characters written in \p buf.
+ */
+std::size_t ttl_to_chars(std::int32_t ttl, char (&buf)[16])
+{
+    if(ttl == 0)
+    {
+        return 0;
+    }
+    std::to_chars_result const r(std::to_chars(buf, buf + sizeof(buf), ttl));
+    return r.ptr - buf;
+}
+
+
+/** \brief Get the text written between the TTL and the data of a record.
+ *
+ * Most records use a tab between the type and the data. The `NS` records
+ * use a space and the `MX` records have nothing after the type since
+ * their data starts with the optional priority:
+ *
+ * \code
+ *     \tNS ns1.example.com.
+ *     \tMX 10\tmail.example.com.
+ *     \tMX\tmail.example.com.
+ * \endcode
+ *
+ * \param[in] type  The type of record.
+ *
+ * \return The type followed by its separator.
+ */
+char const * record_format(record_type_t type)
+{
+    switch(type)
+    {
+    case record_type_t::RECORD_TYPE_A:
+        return "A\t";
+
+    case record_type_t::RECORD_TYPE_AAAA:
+        return "AAAA\t";
+
+    case record_type_t::RECORD_TYPE_CNAME:
+        return "CNAME\t";
+
+    case record_type_t::RECORD_TYPE_MX:
+        return "MX";
+
+    case record_type_t::RECORD_TYPE_NS:
+        return "NS ";
+
+    case record_type_t::RECORD_TYPE_TXT:
+        return "TXT\t";
+
+    case record_type_t::RECORD_TYPE_ORIGIN:
+    case record_type_t::RECORD_TYPE_RAW:
+        return "";
+
+    }
+
+    return "";
+}
+
+
+
+} // no name namespace
+
+
+
+char const * record_type_to_string(record_type_t type)
+{
+    switch(type)
+    {
+    case record_type_t::RECORD_TYPE_A:
+        return "A";
+
+    case record_type_t::RECORD_TYPE_AAAA:
+        return "AAAA";
+
+    case record_type_t::RECORD_TYPE_CNAME:
+        return "CNAME";
+
+    case record_type_t::RECORD_TYPE_MX:
+        return "MX";
+
+    case record_type_t::RECORD_TYPE_NS:
+        return "NS";
+
+    case record_type_t::RECORD_TYPE_TXT:
+        return "TXT";
+
+    case record_type_t::RECORD_TYPE_ORIGIN:
+        return "$ORIGIN";
+
+    case record_type_t::RECORD_TYPE_RAW:
+        return "";
+
+    }
+
+    return "";
+}
+
+
+/** \brief Compare two records.
+ *
+ * The order is the same as the order of the rendered lines. This way
+ * sorting the records gives the same zone as sorting the lines.
+ *
+ * \param[in] rhs  The right hand side record.
+ *
+ * \return true if this record comes before \p rhs.
+ */
+bool zone_record::operator < (zone_record const & rhs) const
+{
+    // the owner is followed by a tab which is smaller than any character
+    // allowed in a domain name so comparing the owners is enough
+    //
+    int const owner(f_owner.compare(rhs.f_owner));
+    if(owner != 0)
+    {
+        return owner < 0;
+    }
+
+    // the TTL is rendered as a decimal number followed by a space and
+    // it is omitted when zero, in which case the type comes first and
+    // digits are smaller than letters
+    //
+    if(f_ttl != rhs.f_ttl)
+    {
+        if(f_ttl == 0)
+        {
+            return false;
+        }
+        if(rhs.f_ttl == 0)
+        {
+            return true;
+        }
+        char lhs_buf[16];
+        char rhs_buf[16];
+        std::size_t const lhs_len(ttl_to_chars(f_ttl, lhs_buf));
+        std::size_t const rhs_len(ttl_to_chars(rhs.f_ttl, rhs_buf));
+        std::size_t const len(std::min(lhs_len, rhs_len));
+        int const ttl(std::char_traits<char>::compare(lhs_buf, rhs_buf, len));
+        if(ttl != 0)
+        {
+            return ttl < 0;
+        }
+
+        // one number is a prefix of the other, the space that follows
+        // the shorter one is smaller than a digit
+        //
+        return lhs_len < rhs_len;
+    }
+
+    if(f_type != rhs.f_type)
+    {
+        return f_type < rhs.f_type;
+    }
+
+    return f_data < rhs.f_data;
+}
+
+
+bool zone_record::operator == (zone_record const & rhs) const
+{
+    return f_ttl == rhs.f_ttl
+        && f_type == rhs.f_type
+        && f_owner == rhs.f_owner
+        && f_data == rhs.f_data;
+}
+
+
+void zone_records::reserve(std::size_t size)
+{
+    f_records.reserve(size);
+}
+
+
+/** \brief Add a record.
+ *
+ * \param[in] owner  The owner of the record, relative to the current
+ * origin; empty to use the owner of the previous record.
+ * \param[in] ttl  The TTL of the record or 0 to use the default.
+ * \param[in] type  The type of record.
+ * \param[in] data  The data of the record as it appears in the zone file;
+ * for `MX` records, it starts with a space and the priority or with a
+ * tab when there is no priority.
+ */
+void zone_records::add(
+      std::string const & owner
+    , std::int32_t ttl
+    , record_type_t type
+    , std::string const & data)
+{
+    f_records.push_back(zone_record{ owner, ttl, type, data });
+}
+
+
+/** \brief Add an `$ORIGIN` directive.
+ *
+ * \param[in] origin  The new origin, it must end with a period.
+ */
+void zone_records::add_origin(std::string const & origin)
+{
+    f_records.push_back(zone_record{ std::string(), 0, record_type_t::RECORD_TYPE_ORIGIN, origin });
+}
+
+
+void zone_records::append(zone_records const & records)
+{
+    f_records.insert(f_records.end(), records.f_records.begin(), records.f_records.end());
+}
+
+
+/** \brief Sort the records and remove duplicates.
+ *
+ * This function is expected to be used on a set of records which does
+ * not include any `$ORIGIN` directive.
+ */
+void zone_records::sort()
+{
+    std::sort(f_records.begin(), f_records.end());
+    f_records.erase(std::unique(f_records.begin(), f_records.end()), f_records.end());
+}
+
+
+bool zone_records::empty() const
+{
+    return f_records.empty();
+}
+
+
+std::size_t zone_records::size() const
+{
+    return f_records.size();
+}
+
+
+zone_records::list_t const & zone_records::records() const
+{
+    return f_records;
+}
+
+
+/** \brief Render the records to the zone file format.
+ *
+ * The output buffer is grown once to the necessary size and the records
+ * get appended to it.
+ *
+ * \param[in,out] out  The string where the records are appended.
+ */
+void zone_records::render(std::string & out) const
+{
+    // owner + tab + TTL + space + type + separator + data + newline
+    //
+    std::size_t size(out.length());
+    for(auto const & r : f_records)
+    {
+        size += r.f_owner.length() + r.f_data.length() + 11 + 1 + 5 + 2 + 1;
+    }
+    out.reserve(size);
+
+    char buf[16];
+    for(auto const & r : f_records)
+    {
+        if(r.f_type == record_type_t::RECORD_TYPE_ORIGIN)
+        {
+            out += "$ORIGIN ";
+            out += r.f_data;
+            out += '\n';
+            continue;
+        }
+
+        out += r.f_owner;
+        out += '\t';
+        std::size_t const len(ttl_to_chars(r.f_ttl, buf));
+        if(len > 0)
+        {
+            out.append(buf, len);
+            out += ' ';
+        }
+        out += record_format(r.f_type);
+        out += r.f_data;
+        out += '\n';
+    }
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,98 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+/** \file
+ * \brief In memory model of the records of a zone.
+ *
+ * The zone_records class holds the records of a zone as a vector of
+ * small structures. It gets sorted once and rendered to the zone file
+ * format in a single pass.
+ */
+
+
+// C++
+//
+#include    <cstdint>
+#include    <string>
+#include    <vector>
+
+
+
+enum class record_type_t
+{
+    // keep the types in alphabetical order so sorting by type gives
+    // the same result as sorting the rendered lines
+    //
+    RECORD_TYPE_A,
+    RECORD_TYPE_AAAA,
+    RECORD_TYPE_CNAME,
+    RECORD_TYPE_MX,
+    RECORD_TYPE_NS,
+    RECORD_TYPE_TXT,
+
+    // not records
+    //
+    RECORD_TYPE_ORIGIN,         // $ORIGIN directive, origin in f_data
+    RECORD_TYPE_RAW,            // record copied as is, type included in f_data
+};
+
+
+char const *                record_type_to_string(record_type_t type);
+
+
+struct zone_record
+{
+    std::string             f_owner = std::string();    // empty means same as previous
+    std::int32_t            f_ttl = 0;                  // 0 means use $TTL
+    record_type_t           f_type = record_type_t::RECORD_TYPE_A;
+    std::string             f_data = std::string();
+
+    bool                    operator < (zone_record const & rhs) const;
+    bool                    operator == (zone_record const & rhs) const;
+};
+
+
+class zone_records
+{
+public:
+    typedef std::vector<zone_record>    list_t;
+
+    void                    reserve(std::size_t size);
+    void                    add(
+                                  std::string const & owner
+                                , std::int32_t ttl
+                                , record_type_t type
+                                , std::string const & data);
+    void                    add_origin(std::string const & origin);
+    void                    append(zone_records const & records);
+    void                    sort();
+
+    bool                    empty() const;
+    std::size_t             size() const;
+    list_t const &          records() const;
+    void                    render(std::string & out) const;
+
+private:
+    list_t                  f_records = list_t();
+};
+
+
+
+// vim: ts=4 sw=4 et
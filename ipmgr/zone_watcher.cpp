@@ -0,0 +1,734 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+/** \file
+ * \brief Implementation of the zone watcher.
+ *
+ * The watcher makes use of inotify to detect changes to the zone
+ * configuration files (any `.conf` file found in the zone directories
+ * and their sub-directories) and to the ipmgr configuration files.
+ *
+ * Changes are debounced: once a change is detected, the wait() function
+ * continues to read events until nothing happens for the specified
+ * amount of time. This way a package installing many zones or an
+ * editor saving a file in several steps only trigger one regeneration.
+ *
+ * A directory which does not exist yet (or gets deleted) is waited on
+ * by watching its closest existing parent. Once it gets created, it
+ * is watched as expected.
+ */
+
+
+// self
+//
+#include    "zone_watcher.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// C
+//
+#include    <dirent.h>
+#include    <poll.h>
+#include    <string.h>
+#include    <sys/inotify.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// snapdev
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+constexpr std::uint32_t const g_zone_events =
+                                  IN_CLOSE_WRITE
+                                | IN_CREATE
+                                | IN_DELETE
+                                | IN_MOVED_FROM
+                                | IN_MOVED_TO
+                                | IN_DELETE_SELF
+                                | IN_ONLYDIR;
+
+constexpr std::uint32_t const g_configuration_events =
+                                  IN_CLOSE_WRITE
+                                | IN_DELETE
+                                | IN_MOVED_FROM
+                                | IN_MOVED_TO
+                                | IN_ONLYDIR;
+
+constexpr std::uint32_t const g_pending_events =
+                                  IN_CREATE
+                                | IN_MOVED_TO
+                                | IN_ONLYDIR;
+
+
+bool is_conf_file(char const * filename)
+{
+    std::size_t const len(strlen(filename));
+    return len > 5
+        && strcmp(filename + len - 5, ".conf") == 0;
+}
+
+
+bool has_conf_file(std::string const & path)
+{
+    DIR * dir(opendir(path.c_str()));
+    if(dir == nullptr)
+    {
+        return false;
+    }
+
+    bool result(false);
+    for(;;)
+    {
+        struct dirent * ent(readdir(dir));
+        if(ent == nullptr)
+        {
+            break;
+        }
+        if(is_conf_file(ent->d_name))
+        {
+            result = true;
+            break;
+        }
+    }
+    closedir(dir);
+
+    return result;
+}
+
+
+std::string parent_directory(std::string const & path)
+{
+    std::string::size_type const pos(path.rfind('/'));
+    if(pos == std::string::npos)
+    {
+        return ".";
+    }
+    if(pos == 0)
+    {
+        return "/";
+    }
+    return path.substr(0, pos);
+}
+
+
+std::string join_path(std::string const & directory, std::string const & name)
+{
+    if(directory == "/")
+    {
+        return directory + name;
+    }
+    return directory + '/' + name;
+}
+
+
+bool is_directory(std::string const & path)
+{
+    struct stat st = {};
+    return stat(path.c_str(), &st) == 0
+        && S_ISDIR(st.st_mode);
+}
+
+
+}
+// no name namespace
+
+
+
+zone_watcher::zone_watcher()
+{
+}
+
+
+zone_watcher::~zone_watcher()
+{
+    if(f_fd != -1)
+    {
+        close(f_fd);
+    }
+}
+
+
+/** \brief Initialize the inotify object.
+ *
+ * \return true if the initialization succeeded.
+ */
+bool zone_watcher::init()
+{
+    f_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(f_fd == -1)
+    {
+        int const e(errno);
+        SNAP_LOG_FATAL
+            << "could not initialize inotify (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+
+    return true;
+}
+
+
+/** \brief Watch a zone directory.
+ *
+ * The zone directories are searched recursively for `.conf` files so
+ * this function also watches all the existing sub-directories. New
+ * sub-directories get added automatically as they get created.
+ *
+ * If the directory does not exist yet, it gets watched once created.
+ *
+ * \param[in] path  The path to the zone directory.
+ *
+ * \return true if the directory and its sub-directories are watched.
+ */
+bool zone_watcher::watch_zone_directory(std::string const & path)
+{
+    f_targets[path] = watch_t::WATCH_ZONES;
+    return watch_zone_tree(path);
+}
+
+
+/** \brief Watch a configuration directory.
+ *
+ * This function watches the `ipmgr.conf` file found in the specified
+ * directory and the `.conf` files found in its `ipmgr.d` sub-directory.
+ *
+ * If either directory does not exist yet, it gets watched once created.
+ *
+ * \param[in] path  The path to the configuration directory.
+ *
+ * \return true if the directory is watched.
+ */
+bool zone_watcher::watch_configuration_directory(std::string const & path)
+{
+    std::string const sub_directory(path + "/ipmgr.d");
+    f_targets[path] = watch_t::WATCH_CONFIGURATION;
+    f_targets[sub_directory] = watch_t::WATCH_CONFIGURATION_DIRECTORY;
+    return add_watch(path, watch_t::WATCH_CONFIGURATION)
+        && add_watch(sub_directory, watch_t::WATCH_CONFIGURATION_DIRECTORY);
+}
+
+
+bool zone_watcher::watch_zone_tree(std::string const & path)
+{
+    if(!add_watch(path, watch_t::WATCH_ZONES))
+    {
+        return false;
+    }
+
+    DIR * dir(opendir(path.c_str()));
+    if(dir == nullptr)
+    {
+        // it may have been deleted in between, the watch will tell us
+        //
+        return true;
+    }
+
+    bool result(true);
+    for(;;)
+    {
+        struct dirent * ent(readdir(dir));
+        if(ent == nullptr)
+        {
+            break;
+        }
+        if(ent->d_type != DT_DIR
+        || strcmp(ent->d_name, ".") == 0
+        || strcmp(ent->d_name, "..") == 0)
+        {
+            continue;
+        }
+        if(!watch_zone_tree(join_path(path, ent->d_name)))
+        {
+            result = false;
+        }
+    }
+    closedir(dir);
+
+    return result;
+}
+
+
+/** \brief Add a watch on a directory.
+ *
+ * When the directory does not exist, its closest existing parent gets
+ * watched instead and the directory is saved as pending in that watch.
+ * directory_created() then adds the watch once the directory appears.
+ *
+ * The masks get added (IN_MASK_ADD) because the same directory can be
+ * watched for more than one reason, i.e. a configuration directory is
+ * also the parent of a missing `ipmgr.d` sub-directory.
+ *
+ * \param[in] path  The directory to watch.
+ * \param[in] type  The type of watch.
+ *
+ * \return true if the directory or its parent is watched.
+ */
+bool zone_watcher::add_watch(std::string const & path, watch_t type)
+{
+    std::uint32_t mask(g_configuration_events);
+    switch(type)
+    {
+    case watch_t::WATCH_ZONES:
+        mask = g_zone_events;
+        break;
+
+    case watch_t::WATCH_PENDING:
+        mask = g_pending_events;
+        break;
+
+    case watch_t::WATCH_CONFIGURATION:
+    case watch_t::WATCH_CONFIGURATION_DIRECTORY:
+        break;
+
+    }
+
+    for(;;)
+    {
+        int const wd(inotify_add_watch(f_fd, path.c_str(), mask | IN_MASK_ADD));
+        if(wd != -1)
+        {
+            watch & w(f_watches[wd]);
+            if(w.f_type == watch_t::WATCH_PENDING)
+            {
+                w.f_path = path;
+                w.f_type = type;
+            }
+            return true;
+        }
+        int e(errno);
+        if(e == ENOENT
+        || e == ENOTDIR)
+        {
+            // find the closest parent that exists
+            //
+            std::string parent(path);
+            int parent_wd(-1);
+            do
+            {
+                parent = parent_directory(parent);
+                parent_wd = inotify_add_watch(f_fd, parent.c_str(), g_pending_events | IN_MASK_ADD);
+                e = errno;
+            }
+            while(parent_wd == -1
+               && (e == ENOENT || e == ENOTDIR)
+               && parent != "/"
+               && parent != ".");
+            if(parent_wd != -1)
+            {
+                watch & p(f_watches[parent_wd]);
+                if(p.f_path.empty())
+                {
+                    p.f_path = parent;
+                }
+
+                // the next directory may have been created before the
+                // parent was watched, in which case we have to try again
+                //
+                std::string::size_type const start(parent == "/" ? 1 : parent.length() + 1);
+                if(!is_directory(path.substr(0, path.find('/', start))))
+                {
+                    p.f_pending[path] = type;
+                    SNAP_LOG_MINOR
+                        << "directory \""
+                        << path
+                        << "\" does not exist yet; it will be watched once created."
+                        << SNAP_LOG_SEND;
+                    return true;
+                }
+                if(p.f_type == watch_t::WATCH_PENDING
+                && p.f_pending.empty())
+                {
+                    inotify_rm_watch(f_fd, parent_wd);
+                    f_watches.erase(parent_wd);
+                }
+                continue;
+            }
+        }
+        SNAP_LOG_ERROR
+            << "could not watch \""
+            << path
+            << "\" (errno: "
+            << e
+            << ", "
+            << strerror(e)
+            << ")."
+            << SNAP_LOG_SEND;
+        return false;
+    }
+}
+
+
+/** \brief Watch a directory which was just created.
+ *
+ * The directory may already include files (i.e. it was moved in place)
+ * so the function checks for files that matter.
+ *
+ * \param[in] path  The directory to watch.
+ * \param[in] type  The type of watch.
+ *
+ * \return The type of change the new directory represents.
+ */
+zone_watcher::change_t zone_watcher::watch_target(std::string const & path, watch_t type)
+{
+    switch(type)
+    {
+    case watch_t::WATCH_ZONES:
+        if(!watch_zone_tree(path))
+        {
+            return change_t::CHANGE_ERROR;
+        }
+        if(is_directory(path))
+        {
+            return change_t::CHANGE_ZONES;
+        }
+        break;
+
+    case watch_t::WATCH_CONFIGURATION:
+        if(!add_watch(path, type)
+        || !add_watch(path + "/ipmgr.d", watch_t::WATCH_CONFIGURATION_DIRECTORY))
+        {
+            return change_t::CHANGE_ERROR;
+        }
+        if(access((path + "/ipmgr.conf").c_str(), F_OK) == 0
+        || has_conf_file(path + "/ipmgr.d"))
+        {
+            return change_t::CHANGE_CONFIGURATION;
+        }
+        break;
+
+    case watch_t::WATCH_CONFIGURATION_DIRECTORY:
+        if(!add_watch(path, type))
+        {
+            return change_t::CHANGE_ERROR;
+        }
+        if(has_conf_file(path))
+        {
+            return change_t::CHANGE_CONFIGURATION;
+        }
+        break;
+
+    case watch_t::WATCH_PENDING:
+        break;
+
+    }
+
+    return change_t::CHANGE_NONE;
+}
+
+
+/** \brief Handle the creation of a directory in a watched directory.
+ *
+ * If the new directory is one of the pending directories of that watch
+ * or one of their parents, the pending directories get watched again.
+ *
+ * \param[in] wd  The watch in which the directory was created.
+ * \param[in] path  The path of the new directory.
+ *
+ * \return The type of change the new directory represents.
+ */
+zone_watcher::change_t zone_watcher::directory_created(int wd, std::string const & path)
+{
+    auto it(f_watches.find(wd));
+    if(it == f_watches.end())
+    {
+        return change_t::CHANGE_NONE;
+    }
+
+    target_map_t targets;
+    std::string const prefix(path + '/');
+    for(auto p(it->second.f_pending.begin()); p != it->second.f_pending.end(); )
+    {
+        if(p->first == path
+        || p->first.compare(0, prefix.length(), prefix) == 0)
+        {
+            targets.insert(*p);
+            p = it->second.f_pending.erase(p);
+        }
+        else
+        {
+            ++p;
+        }
+    }
+    if(it->second.f_type == watch_t::WATCH_PENDING
+    && it->second.f_pending.empty())
+    {
+        inotify_rm_watch(f_fd, wd);
+        f_watches.erase(it);
+    }
+
+    change_t result(change_t::CHANGE_NONE);
+    for(auto const & t : targets)
+    {
+        change_t const change(watch_target(t.first, t.second));
+        if(change > result)
+        {
+            result = change;
+        }
+    }
+
+    return result;
+}
+
+
+/** \brief Handle the removal of a watch.
+ *
+ * When a watched directory gets deleted, its watch goes away. If that
+ * directory is one of the directories we were asked to watch, or the
+ * parent of pending directories, those get watched again through their
+ * closest existing parent so their re-creation gets noticed.
+ *
+ * \param[in] it  The watch which was removed.
+ *
+ * \return The type of change, CHANGE_ERROR if watching failed.
+ */
+zone_watcher::change_t zone_watcher::watch_removed(watch_map_t::iterator it)
+{
+    target_map_t targets(it->second.f_pending);
+    auto const target(f_targets.find(it->second.f_path));
+    if(target != f_targets.end())
+    {
+        targets.insert(*target);
+    }
+    f_watches.erase(it);
+
+    change_t result(change_t::CHANGE_NONE);
+    for(auto const & t : targets)
+    {
+        change_t const change(watch_target(t.first, t.second));
+        if(change > result)
+        {
+            result = change;
+        }
+    }
+
+    return result;
+}
+
+
+/** \brief Wait for changes.
+ *
+ * This function blocks until a change is detected. Once a change was
+ * detected, it continues to wait for more changes until none occur for
+ * \p debounce milliseconds.
+ *
+ * \param[in] debounce  The number of milliseconds to wait for more changes.
+ *
+ * \return The most important type of change that was detected.
+ */
+zone_watcher::change_t zone_watcher::wait(std::int64_t debounce)
+{
+    change_t result(change_t::CHANGE_NONE);
+    int timeout(-1);
+    for(;;)
+    {
+        struct pollfd fd = {};
+        fd.fd = f_fd;
+        fd.events = POLLIN;
+        int const r(poll(&fd, 1, timeout));
+        if(r < 0)
+        {
+            int const e(errno);
+            if(e == EINTR)
+            {
+                continue;
+            }
+            SNAP_LOG_FATAL
+                << "poll() on the inotify object failed (errno: "
+                << e
+                << ", "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+            return change_t::CHANGE_ERROR;
+        }
+        if(r == 0)
+        {
+            // nothing happened for `debounce` ms
+            //
+            return result;
+        }
+
+        change_t const changes(read_events());
+        if(changes > result)
+        {
+            result = changes;
+            if(result == change_t::CHANGE_ERROR)
+            {
+                return result;
+            }
+        }
+        if(result != change_t::CHANGE_NONE)
+        {
+            timeout = static_cast<int>(debounce);
+        }
+    }
+}
+
+
+zone_watcher::change_t zone_watcher::read_events()
+{
+    change_t result(change_t::CHANGE_NONE);
+
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    for(;;)
+    {
+        ssize_t const size(read(f_fd, buffer, sizeof(buffer)));
+        if(size < 0)
+        {
+            int const e(errno);
+            if(e == EAGAIN
+            || e == EINTR)
+            {
+                return result;
+            }
+            SNAP_LOG_FATAL
+                << "could not read inotify events (errno: "
+                << e
+                << ", "
+                << strerror(e)
+                << ")."
+                << SNAP_LOG_SEND;
+            return change_t::CHANGE_ERROR;
+        }
+
+        for(char const * ptr(buffer); ptr < buffer + size; )
+        {
+            struct inotify_event const * event(reinterpret_cast<struct inotify_event const *>(ptr));
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            change_t change(change_t::CHANGE_NONE);
+            if((event->mask & IN_Q_OVERFLOW) != 0)
+            {
+                // we lost events, assume the zones changed; the zone
+                // files get checked one by one anyway
+                //
+                change = change_t::CHANGE_ZONES;
+            }
+            else
+            {
+                auto it(f_watches.find(event->wd));
+                if(it == f_watches.end())
+                {
+                    continue;
+                }
+                if((event->mask & IN_IGNORED) != 0)
+                {
+                    // the watched directory is gone
+                    //
+                    change = watch_removed(it);
+                    if(change == change_t::CHANGE_ERROR)
+                    {
+                        return change;
+                    }
+                    if(change > result)
+                    {
+                        result = change;
+                    }
+                    continue;
+                }
+
+                // copy the watch details, the map may be modified
+                //
+                char const * name(event->len > 0 ? event->name : "");
+                std::string const path(join_path(it->second.f_path, name));
+                watch_t const type(it->second.f_type);
+                change_t created(change_t::CHANGE_NONE);
+                if((event->mask & IN_ISDIR) != 0
+                && (event->mask & (IN_CREATE | IN_MOVED_TO)) != 0
+                && !it->second.f_pending.empty())
+                {
+                    created = directory_created(event->wd, path);
+                    if(created == change_t::CHANGE_ERROR)
+                    {
+                        return created;
+                    }
+                }
+
+                switch(type)
+                {
+                case watch_t::WATCH_ZONES:
+                    if((event->mask & IN_ISDIR) != 0)
+                    {
+                        if((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0
+                        && !watch_zone_tree(path))
+                        {
+                            return change_t::CHANGE_ERROR;
+                        }
+                        change = change_t::CHANGE_ZONES;
+                    }
+                    else if((event->mask & IN_DELETE_SELF) != 0
+                         || is_conf_file(name))
+                    {
+                        change = change_t::CHANGE_ZONES;
+                    }
+                    break;
+
+                case watch_t::WATCH_CONFIGURATION:
+                    if((event->mask & IN_ISDIR) == 0
+                    && strcmp(name, "ipmgr.conf") == 0)
+                    {
+                        change = change_t::CHANGE_CONFIGURATION;
+                    }
+                    break;
+
+                case watch_t::WATCH_CONFIGURATION_DIRECTORY:
+                    if((event->mask & IN_ISDIR) == 0
+                    && is_conf_file(name))
+                    {
+                        change = change_t::CHANGE_CONFIGURATION;
+                    }
+                    break;
+
+                case watch_t::WATCH_PENDING:
+                    break;
+
+                }
+                if(created > change)
+                {
+                    change = created;
+                }
+            }
+
+            if(change > result)
+            {
+                result = change;
+            }
+        }
+    }
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,97 @@
+// Copyright (c) 2022-2025  Made to Order Software Corp.  All Rights Reserved.
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+#pragma once
+
+/** \file
+ * \brief Watch the zone and configuration files for changes.
+ *
+ * The zone_watcher class is used by the `--daemon` mode to know when
+ * the zones need to be regenerated.
+ */
+
+
+// C++
+//
+#include    <cstdint>
+#include    <map>
+#include    <string>
+
+
+
+class zone_watcher
+{
+public:
+    // the order matters, a larger value has priority
+    //
+    enum class change_t
+    {
+        CHANGE_NONE,
+        CHANGE_ZONES,
+        CHANGE_CONFIGURATION,
+        CHANGE_ERROR,
+    };
+
+                            zone_watcher();
+                            zone_watcher(zone_watcher const &) = delete;
+                            ~zone_watcher();
+
+    zone_watcher &          operator = (zone_watcher const &) = delete;
+
+    bool                    init();
+    bool                    watch_zone_directory(std::string const & path);
+    bool                    watch_configuration_directory(std::string const & path);
+    change_t                wait(std::int64_t debounce);
+
+private:
+    enum class watch_t
+    {
+        WATCH_ZONES,
+        WATCH_CONFIGURATION,
+        WATCH_CONFIGURATION_DIRECTORY,
+        WATCH_PENDING,
+    };
+
+    // directories which do not exist yet, indexed by path
+    //
+    typedef std::map<std::string, watch_t>  target_map_t;
+
+    struct watch
+    {
+        std::string         f_path = std::string();
+        watch_t             f_type = watch_t::WATCH_PENDING;
+        target_map_t        f_pending = target_map_t();
+    };
+
+    typedef std::map<int, watch>    watch_map_t;
+
+    bool                    watch_zone_tree(std::string const & path);
+    bool                    add_watch(std::string const & path, watch_t type);
+    change_t                watch_target(std::string const & path, watch_t type);
+    change_t                directory_created(int wd, std::string const & path);
+    change_t                watch_removed(watch_map_t::iterator it);
+    change_t                read_events();
+
+    int                     f_fd = -1;
+    watch_map_t             f_watches = watch_map_t();
+    target_map_t            f_targets = target_map_t();
+};
+
+
+
+// vim: ts=4 sw=4 et
@@ -23,6 +23,7 @@
 
 // ipmgr
 //
+#include    <ipmgr/dns_options.h>
 #include    <ipmgr/version.h>
 
 
@@ -38,6 +39,7 @@
 // C++
 //
 #include    <list>
+#include    <sstream>
 
 
 
@@ -74,7 +76,7 @@ public:
             cmd += '"';
         }
 
-        cmd += ' ';
+        cmd += " -- ";
         cmd += filename;
         cmd += " >";
         cmd += filename;
@@ -96,6 +98,30 @@ public:
         CATCH_REQUIRE_LONG_STRING(f_output, output);
     }
 
+    void execute_in_process()
+    {
+        dns_options options;
+        for(auto const & e : f_execute)
+        {
+            CATCH_REQUIRE(options.add_expression(e));
+        }
+        CATCH_REQUIRE(options.set_data(f_input));
+        CATCH_REQUIRE(options.execute());
+
+        std::string output;
+        for(auto const & v : options.get_values())
+        {
+            output += v;
+            output += '\n';
+        }
+        if(options.is_modified())
+        {
+            output += options.get_data();
+        }
+
+        CATCH_REQUIRE_LONG_STRING(f_output, output);
+    }
+
 private:
     enum class state_t {
         STATE_START,    // nothing found just yet
@@ -285,6 +311,54 @@ CATCH_TEST_CASE("dns_options", "[options]")
         }
     }
     CATCH_END_SECTION()
+
+    CATCH_START_SECTION("verify dns_options class editing")
+    {
+        std::string const test_files(SNAP_CATCH2_NAMESPACE::g_source_dir() + "/tests/scripts");
+
+        snapdev::glob_to_list<std::vector<std::string>> glob;
+        bool const list_success(glob.read_path<
+                 snapdev::glob_to_list_flag_t::GLOB_FLAG_IGNORE_ERRORS,
+                 snapdev::glob_to_list_flag_t::GLOB_FLAG_PERIOD>(test_files + "/*.conf"));
+        CATCH_REQUIRE(list_success);
+
+        for(auto tf : glob)
+        {
+            std::cout << "--- working on \"" << tf << "\" in process...\n";
+            test_data data(tf);
+            data.execute_in_process();
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("verify dns_options class errors")
+    {
+        std::stringstream errors;
+        dns_options options;
+        options.set_error_stream(errors);
+
+        // nothing loaded yet
+        //
+        CATCH_REQUIRE_FALSE(options.execute("options.version"));
+        CATCH_REQUIRE(errors.str() == "dns_options:error: no options were loaded.\n");
+        errors.str(std::string());
+
+        // invalid expression
+        //
+        CATCH_REQUIRE(options.set_data("options {\n  version 1.3;\n};\n"));
+        CATCH_REQUIRE_FALSE(options.add_expression("options..version"));
+        CATCH_REQUIRE_FALSE(errors.str().empty());
+        errors.str(std::string());
+
+        // the invalid expression was not queued
+        //
+        CATCH_REQUIRE(options.execute("options.version"));
+        CATCH_REQUIRE(errors.str().empty());
+        CATCH_REQUIRE(options.get_values().size() == 1);
+        CATCH_REQUIRE(options.get_values()[0] == "1.3");
+        CATCH_REQUIRE_FALSE(options.is_modified());
+    }
+    CATCH_END_SECTION()
 }
 
 
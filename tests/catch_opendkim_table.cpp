@@ -0,0 +1,156 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// ipmgr
+//
+#include    <ipmgr/opendkim_table.h>
+
+
+
+CATCH_TEST_CASE("opendkim_table", "[opendkim]")
+{
+    CATCH_START_SECTION("opendkim_table: exact match")
+    {
+        opendkim_table table;
+        CATCH_REQUIRE(table.parse(
+                  "# WARNING: AUTO-GENERATED FILE, SEE ipmgr(1) FOR DETAILS\n"
+                  "myexample.com mail._domainkey.myexample.com\n"
+                  "example.com.au\tmail._domainkey.example.com.au\n"));
+        CATCH_REQUIRE_FALSE(table.modified());
+        CATCH_REQUIRE(table.size() == 2);
+        CATCH_REQUIRE(table.find("example.com").empty());
+        CATCH_REQUIRE(table.find("example.com.au") == "mail._domainkey.example.com.au");
+
+        // adding example.com must not touch the other domains
+        //
+        table.set("example.com", "mail._domainkey.example.com");
+        CATCH_REQUIRE(table.modified());
+        CATCH_REQUIRE(table.to_string() ==
+                  "# WARNING: AUTO-GENERATED FILE, SEE ipmgr(1) FOR DETAILS\n"
+                  "myexample.com mail._domainkey.myexample.com\n"
+                  "example.com.au\tmail._domainkey.example.com.au\n"
+                  "example.com mail._domainkey.example.com\n");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("opendkim_table: unchanged entries")
+    {
+        opendkim_table table;
+        CATCH_REQUIRE(table.parse("mail._domainkey.example.com example.com:mail:/etc/opendkim/example.com.key/mail.private\n"));
+        table.set("mail._domainkey.example.com", "example.com:mail:/etc/opendkim/example.com.key/mail.private");
+        CATCH_REQUIRE_FALSE(table.modified());
+
+        table.set("mail._domainkey.example.com", "example.com:mail:/etc/opendkim/keys/mail.private");
+        CATCH_REQUIRE(table.modified());
+        CATCH_REQUIRE(table.find("mail._domainkey.example.com") == "example.com:mail:/etc/opendkim/keys/mail.private");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("opendkim_table: erase and empty tables")
+    {
+        opendkim_table table;
+        CATCH_REQUIRE(table.parse(std::string()));
+        CATCH_REQUIRE_FALSE(table.erase("example.com"));
+        CATCH_REQUIRE_FALSE(table.modified());
+
+        table.set("example.com", "mail._domainkey.example.com");
+        CATCH_REQUIRE(table.erase("example.com"));
+        CATCH_REQUIRE(table.modified());
+        CATCH_REQUIRE(table.to_string() == "# WARNING: AUTO-GENERATED FILE, SEE ipmgr(1) FOR DETAILS\n");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("opendkim_table: invalid lines")
+    {
+        opendkim_table table;
+        CATCH_REQUIRE_FALSE(table.parse("example.com\n\n  example.net   mail._domainkey.example.net  \n"));
+        CATCH_REQUIRE(table.size() == 1);
+        CATCH_REQUIRE(table.find("example.net") == "mail._domainkey.example.net");
+
+        // invalid lines are kept as is
+        //
+        table.set("example.org", "mail._domainkey.example.org");
+        CATCH_REQUIRE(table.to_string() ==
+                  "example.com\n"
+                  "\n"
+                  "  example.net   mail._domainkey.example.net  \n"
+                  "example.org mail._domainkey.example.org\n");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("opendkim_table: hand maintained lines are kept verbatim")
+    {
+        std::string const signing_table(
+                  "# signing table maintained by hand\n"
+                  "*@example.com\tmail._domainkey.example.com\n"
+                  "\n"
+                  "# second selector for the newsletters\n"
+                  "news@example.com news._domainkey.example.com\n"
+                  "example.com   old._domainkey.example.com\n"
+                  "example.com other._domainkey.example.com\n"
+                  "*@example.net mail._domainkey.example.net\n");
+
+        opendkim_table table;
+        CATCH_REQUIRE(table.parse(signing_table));
+        CATCH_REQUIRE(table.size() == 5);
+        CATCH_REQUIRE(table.to_string() == signing_table);
+
+        // a value found on any line of the key is not a change
+        //
+        table.set("example.com", "other._domainkey.example.com");
+        CATCH_REQUIRE_FALSE(table.modified());
+        CATCH_REQUIRE(table.find("example.com") == "old._domainkey.example.com");
+
+        // only the first line of the key gets replaced, in place
+        //
+        table.set("example.com", "mail._domainkey.example.com");
+        CATCH_REQUIRE(table.modified());
+        CATCH_REQUIRE(table.to_string() ==
+                  "# signing table maintained by hand\n"
+                  "*@example.com\tmail._domainkey.example.com\n"
+                  "\n"
+                  "# second selector for the newsletters\n"
+                  "news@example.com news._domainkey.example.com\n"
+                  "example.com mail._domainkey.example.com\n"
+                  "example.com other._domainkey.example.com\n"
+                  "*@example.net mail._domainkey.example.net\n");
+
+        // erase removes all the lines of that key only
+        //
+        CATCH_REQUIRE(table.erase("example.com"));
+        CATCH_REQUIRE(table.size() == 3);
+        CATCH_REQUIRE(table.find("*@example.net") == "mail._domainkey.example.net");
+        CATCH_REQUIRE(table.to_string() ==
+                  "# signing table maintained by hand\n"
+                  "*@example.com\tmail._domainkey.example.com\n"
+                  "\n"
+                  "# second selector for the newsletters\n"
+                  "news@example.com news._domainkey.example.com\n"
+                  "*@example.net mail._domainkey.example.net\n");
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,214 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// ipmgr
+//
+#include    <ipmgr/output_stage.h>
+
+
+// snapdev
+//
+#include    <snapdev/mkdir_p.h>
+
+
+// C++
+//
+#include    <fstream>
+#include    <sstream>
+
+
+// C
+//
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+std::string read_file(std::string const & filename)
+{
+    std::ifstream in(filename);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+
+bool file_exists(std::string const & filename)
+{
+    return access(filename.c_str(), F_OK) == 0;
+}
+
+
+ino_t file_inode(std::string const & filename)
+{
+    struct stat st = {};
+    if(stat(filename.c_str(), &st) != 0)
+    {
+        return 0;
+    }
+    return st.st_ino;
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("output_stage", "[output]")
+{
+    CATCH_START_SECTION("output_stage: commit staged files")
+    {
+        std::string const root(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/output_stage/commit");
+        CATCH_REQUIRE(snapdev::mkdir_p(root) == 0);
+
+        std::string const zone(root + "/zones/example.com.zone");
+        std::string const conf(root + "/ipmgr-options.conf");
+
+        {
+            std::ofstream out(conf);
+            out << "old\n";
+        }
+
+        output_stage stage;
+        CATCH_REQUIRE(stage.empty());
+        CATCH_REQUIRE(stage.stage(zone, "zone\n"));
+        CATCH_REQUIRE(stage.stage(conf, "first\n"));
+        CATCH_REQUIRE(stage.stage(conf, "new\n"));
+        CATCH_REQUIRE(stage.size() == 2);
+
+        // nothing visible until the commit
+        //
+        CATCH_REQUIRE_FALSE(file_exists(zone));
+        CATCH_REQUIRE(read_file(conf) == "old\n");
+        CATCH_REQUIRE(file_exists(output_stage::temporary_filename(zone)));
+
+        CATCH_REQUIRE(stage.commit());
+        CATCH_REQUIRE(stage.empty());
+        CATCH_REQUIRE(read_file(zone) == "zone\n");
+        CATCH_REQUIRE(read_file(conf) == "new\n");
+        CATCH_REQUIRE_FALSE(file_exists(output_stage::temporary_filename(zone)));
+        CATCH_REQUIRE_FALSE(file_exists(output_stage::temporary_filename(conf)));
+
+        // removals happen on commit
+        //
+        stage.remove(zone);
+        CATCH_REQUIRE(file_exists(zone));
+        CATCH_REQUIRE(stage.commit());
+        CATCH_REQUIRE_FALSE(file_exists(zone));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("output_stage: copy modes")
+    {
+        std::string const root(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/output_stage/copy-modes");
+        CATCH_REQUIRE(snapdev::mkdir_p(root) == 0);
+
+        copy_mode_t mode(copy_mode_t::COPY_MODE_WRITE);
+        CATCH_REQUIRE(string_to_copy_mode("link", mode));
+        CATCH_REQUIRE(mode == copy_mode_t::COPY_MODE_LINK);
+        CATCH_REQUIRE(string_to_copy_mode("reflink", mode));
+        CATCH_REQUIRE(mode == copy_mode_t::COPY_MODE_REFLINK);
+        CATCH_REQUIRE(string_to_copy_mode("write", mode));
+        CATCH_REQUIRE(mode == copy_mode_t::COPY_MODE_WRITE);
+        CATCH_REQUIRE_FALSE(string_to_copy_mode("symlink", mode));
+        CATCH_REQUIRE(mode == copy_mode_t::COPY_MODE_WRITE);
+
+        char const * const names[] = { "write", "reflink", "link" };
+        for(auto const & n : names)
+        {
+            CATCH_REQUIRE(string_to_copy_mode(n, mode));
+
+            std::string const generated(root + "/" + n + "/generated/example.com.zone");
+            std::string const bind(root + "/" + n + "/bind/example.com.zone");
+
+            output_stage stage;
+            stage.set_copy_mode(mode);
+            CATCH_REQUIRE(stage.get_copy_mode() == mode);
+            CATCH_REQUIRE(stage.stage(generated, "zone data\n"));
+            CATCH_REQUIRE(stage.stage_copy(bind, generated, "zone data\n"));
+            CATCH_REQUIRE(stage.size() == 2);
+            CATCH_REQUIRE(stage.commit());
+
+            CATCH_REQUIRE(read_file(generated) == "zone data\n");
+            CATCH_REQUIRE(read_file(bind) == "zone data\n");
+            if(mode == copy_mode_t::COPY_MODE_LINK)
+            {
+                CATCH_REQUIRE(file_inode(generated) == file_inode(bind));
+            }
+            else
+            {
+                CATCH_REQUIRE(file_inode(generated) != file_inode(bind));
+            }
+
+            // a new version breaks the link
+            //
+            CATCH_REQUIRE(stage.stage(generated, "new zone data\n"));
+            CATCH_REQUIRE(stage.commit());
+            CATCH_REQUIRE(read_file(generated) == "new zone data\n");
+            CATCH_REQUIRE(read_file(bind) == "zone data\n");
+        }
+
+        // copying a file which was not staged writes the contents
+        //
+        std::string const other(root + "/other.zone");
+        output_stage stage;
+        stage.set_copy_mode(copy_mode_t::COPY_MODE_LINK);
+        CATCH_REQUIRE(stage.stage_copy(other, root + "/not-staged.zone", "other\n"));
+        CATCH_REQUIRE(stage.commit());
+        CATCH_REQUIRE(read_file(other) == "other\n");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("output_stage: rollback")
+    {
+        std::string const root(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/output_stage/rollback");
+        CATCH_REQUIRE(snapdev::mkdir_p(root) == 0);
+
+        std::string const zone(root + "/rollback.zone");
+
+        {
+            output_stage stage;
+            CATCH_REQUIRE(stage.stage(zone, "zone\n"));
+            CATCH_REQUIRE(file_exists(output_stage::temporary_filename(zone)));
+            stage.rollback();
+            CATCH_REQUIRE(stage.empty());
+            CATCH_REQUIRE_FALSE(file_exists(output_stage::temporary_filename(zone)));
+
+            // the destructor also rolls back
+            //
+            CATCH_REQUIRE(stage.stage(zone, "zone\n"));
+        }
+        CATCH_REQUIRE_FALSE(file_exists(zone));
+        CATCH_REQUIRE_FALSE(file_exists(output_stage::temporary_filename(zone)));
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
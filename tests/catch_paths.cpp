@@ -0,0 +1,86 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// ipmgr
+//
+#include    <ipmgr/paths.h>
+
+
+// snapdev
+//
+#include    <snapdev/mkdir_p.h>
+
+
+// C
+//
+#include    <sys/stat.h>
+
+
+
+CATCH_TEST_CASE("paths", "[paths]")
+{
+    CATCH_START_SECTION("paths: default root")
+    {
+        paths p;
+        CATCH_REQUIRE_FALSE(p.relocated());
+        CATCH_REQUIRE(p.root().empty());
+        CATCH_REQUIRE(p.resolve(paths::BIND_ZONES) == "/etc/bind/zones");
+
+        paths slash("/");
+        CATCH_REQUIRE_FALSE(slash.relocated());
+        CATCH_REQUIRE(slash.resolve(paths::IPMGR_SERIAL) == "/var/lib/ipmgr/serial");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("paths: relocated root")
+    {
+        paths p("/tmp/sandbox//");
+        CATCH_REQUIRE(p.relocated());
+        CATCH_REQUIRE(p.root() == "/tmp/sandbox");
+        CATCH_REQUIRE(p.resolve(paths::BIND_OPTIONS) == "/tmp/sandbox/etc/bind/ipmgr-options.conf");
+        CATCH_REQUIRE(p.resolve(std::string(paths::BIND_DYNAMIC_ZONES) + "/example.com.zone") == "/tmp/sandbox/var/lib/bind/example.com.zone");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("paths: create the directories of a relocated tree")
+    {
+        std::string const root(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/paths/create");
+        CATCH_REQUIRE(snapdev::mkdir_p(root) == 0);
+
+        paths p(root);
+        CATCH_REQUIRE(p.create_directories());
+
+        struct stat st = {};
+        CATCH_REQUIRE(stat(p.resolve(paths::IPMGR_GENERATED).c_str(), &st) == 0);
+        CATCH_REQUIRE(S_ISDIR(st.st_mode));
+        CATCH_REQUIRE(stat(p.resolve(paths::BIND_ZONES).c_str(), &st) == 0);
+        CATCH_REQUIRE(S_ISDIR(st.st_mode));
+        CATCH_REQUIRE(stat(p.resolve(paths::IPMGR_RUN).c_str(), &st) == 0);
+        CATCH_REQUIRE(S_ISDIR(st.st_mode));
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
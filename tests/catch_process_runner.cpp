@@ -0,0 +1,105 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// ipmgr
+//
+#include    <ipmgr/process_runner.h>
+
+
+// C++
+//
+#include    <chrono>
+
+
+
+CATCH_TEST_CASE("process_runner", "[process]")
+{
+    CATCH_START_SECTION("process_runner: output and exit code")
+    {
+        process_runner echo("echo", { "hello", "*", "$HOME" });
+        CATCH_REQUIRE(echo.get_command_line() == "echo hello * $HOME");
+        CATCH_REQUIRE(echo.run() == 0);
+
+        // no shell, so no expansion
+        //
+        CATCH_REQUIRE(echo.output() == "hello * $HOME\n");
+        CATCH_REQUIRE(echo.error().empty());
+
+        process_runner fail("sh", { "-c", "echo oops >&2; exit 3" });
+        CATCH_REQUIRE(fail.run() == 3);
+        CATCH_REQUIRE(fail.output().empty());
+        CATCH_REQUIRE(fail.error() == "oops\n");
+        CATCH_REQUIRE_FALSE(fail.timed_out());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("process_runner: unknown command")
+    {
+        process_runner unknown("ipmgr-this-command-does-not-exist");
+        CATCH_REQUIRE_FALSE(unknown.start());
+        CATCH_REQUIRE(unknown.wait() == -1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("process_runner: timeout")
+    {
+        process_runner sleep("sleep", { "10" });
+        sleep.set_timeout(100);
+        std::chrono::steady_clock::time_point const start(std::chrono::steady_clock::now());
+        CATCH_REQUIRE(sleep.run() == -1);
+        CATCH_REQUIRE(sleep.timed_out());
+        CATCH_REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("process_runner: background process holding the pipes")
+    {
+        // the background sleep keeps the pipes open after sh exits
+        //
+        process_runner detach("sh", { "-c", "echo started; sleep 3 & exit 0" });
+        detach.set_timeout(2000);
+        std::chrono::steady_clock::time_point const start(std::chrono::steady_clock::now());
+        CATCH_REQUIRE(detach.run() == 0);
+        CATCH_REQUIRE_FALSE(detach.timed_out());
+        CATCH_REQUIRE(detach.output() == "started\n");
+        CATCH_REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("process_runner: concurrent commands")
+    {
+        std::chrono::steady_clock::time_point const start(std::chrono::steady_clock::now());
+        process_runner a("sleep", { "0.5" });
+        process_runner b("sleep", { "0.5" });
+        CATCH_REQUIRE(a.start());
+        CATCH_REQUIRE(b.start());
+        CATCH_REQUIRE(a.wait() == 0);
+        CATCH_REQUIRE(b.wait() == 0);
+        CATCH_REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(900));
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
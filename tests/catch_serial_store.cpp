@@ -0,0 +1,196 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// ipmgr
+//
+#include    <ipmgr/serial_store.h>
+
+
+// snapdev
+//
+#include    <snapdev/mkdir_p.h>
+
+
+// C++
+//
+#include    <fstream>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <sys/file.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+
+CATCH_TEST_CASE("serial_store", "[serial]")
+{
+    std::string const root(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/serial_store");
+
+    CATCH_START_SECTION("serial_store: set, get and reopen")
+    {
+        std::string const filename(root + "/basic/serial.db");
+
+        {
+            serial_store store(filename);
+            std::uint32_t serial(0);
+            CATCH_REQUIRE_FALSE(store.get("example.com", serial));
+            CATCH_REQUIRE(store.set("example.com", 5));
+            CATCH_REQUIRE(store.set("example.net", 17));
+            CATCH_REQUIRE(store.set("example.com", 6));
+            CATCH_REQUIRE(store.get("example.com", serial));
+            CATCH_REQUIRE(serial == 6);
+            CATCH_REQUIRE(store.size() == 2);
+            CATCH_REQUIRE(store.sync());
+        }
+
+        serial_store store(filename);
+        std::uint32_t serial(0);
+        CATCH_REQUIRE(store.get("example.com", serial));
+        CATCH_REQUIRE(serial == 6);
+        CATCH_REQUIRE(store.get("example.net", serial));
+        CATCH_REQUIRE(serial == 17);
+        CATCH_REQUIRE_FALSE(store.get("example.org", serial));
+        CATCH_REQUIRE_FALSE(store.set(std::string(256, 'a'), 1));
+
+        // the file is locked while opened
+        //
+        int const fd(open(filename.c_str(), O_RDONLY | O_CLOEXEC));
+        CATCH_REQUIRE(fd >= 0);
+        CATCH_REQUIRE(flock(fd, LOCK_EX | LOCK_NB) != 0);
+        CATCH_REQUIRE(errno == EWOULDBLOCK);
+
+        store.close();
+        CATCH_REQUIRE(flock(fd, LOCK_EX | LOCK_NB) == 0);
+        close(fd);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("serial_store: grow")
+    {
+        std::string const filename(root + "/grow/serial.db");
+
+        {
+            serial_store store(filename);
+            for(std::uint32_t idx(1); idx <= 3000; ++idx)
+            {
+                CATCH_REQUIRE(store.set("zone" + std::to_string(idx) + ".example.com", idx));
+            }
+            CATCH_REQUIRE(store.size() == 3000);
+        }
+
+        serial_store store(filename);
+        CATCH_REQUIRE(store.size() == 3000);
+        std::uint32_t serial(0);
+        CATCH_REQUIRE(store.get("zone1.example.com", serial));
+        CATCH_REQUIRE(serial == 1);
+        CATCH_REQUIRE(store.get("zone3000.example.com", serial));
+        CATCH_REQUIRE(serial == 3000);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("serial_store: corrupt header and record")
+    {
+        std::string const filename(root + "/corrupt/serial.db");
+
+        {
+            serial_store store(filename);
+            CATCH_REQUIRE(store.set("example.com", 5));
+            CATCH_REQUIRE(store.set("example.net", 7));
+        }
+
+        // break the header count and the value of the second record
+        //
+        {
+            std::fstream f(filename, std::ios::in | std::ios::out | std::ios::binary);
+            std::uint32_t const count(0);
+            f.seekp(16);
+            f.write(reinterpret_cast<char const *>(&count), sizeof(count));
+            std::uint32_t const serial(8);
+            f.seekp(64 + 264 + 256);
+            f.write(reinterpret_cast<char const *>(&serial), sizeof(serial));
+        }
+
+        serial_store store(filename);
+        std::uint32_t serial(0);
+        CATCH_REQUIRE(store.get("example.com", serial));
+        CATCH_REQUIRE(serial == 5);
+        CATCH_REQUIRE_FALSE(store.get("example.net", serial));
+        CATCH_REQUIRE(store.size() == 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("serial_store: import counter files")
+    {
+        std::string const counters(root + "/import/serial");
+        CATCH_REQUIRE(snapdev::mkdir_p(counters) == 0);
+        {
+            std::uint32_t const serial(42);
+            std::ofstream out(counters + "/example.com.counter");
+            out.write(reinterpret_cast<char const *>(&serial), sizeof(serial));
+        }
+
+        serial_store store(root + "/import/serial.db", counters);
+        std::uint32_t serial(0);
+        CATCH_REQUIRE(store.get("example.com", serial));
+        CATCH_REQUIRE(serial == 42);
+        CATCH_REQUIRE(access((counters + "/example.com.counter").c_str(), F_OK) != 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("serial_store: dry run keeps the counter files")
+    {
+        std::string const counters(root + "/dry-run/serial");
+        std::string const filename(root + "/dry-run/serial.db");
+        CATCH_REQUIRE(snapdev::mkdir_p(counters) == 0);
+        {
+            std::uint32_t const serial(42);
+            std::ofstream out(counters + "/example.com.counter");
+            out.write(reinterpret_cast<char const *>(&serial), sizeof(serial));
+        }
+
+        {
+            serial_store store(filename, counters, true);
+            std::uint32_t serial(0);
+            CATCH_REQUIRE(store.get("example.com", serial));
+            CATCH_REQUIRE(serial == 42);
+            CATCH_REQUIRE(store.set("example.com", 43));
+        }
+        CATCH_REQUIRE(access((counters + "/example.com.counter").c_str(), F_OK) == 0);
+
+        // the next run deletes the file and keeps the newer serial number
+        //
+        serial_store store(filename, counters);
+        std::uint32_t serial(0);
+        CATCH_REQUIRE(store.get("example.com", serial));
+        CATCH_REQUIRE(serial == 43);
+        CATCH_REQUIRE(access((counters + "/example.com.counter").c_str(), F_OK) != 0);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,106 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// ipmgr
+//
+#include    <ipmgr/serial_strategy.h>
+
+
+
+namespace
+{
+
+
+time_t utc(int year, int month, int day, int hour = 12)
+{
+    struct tm t = {};
+    t.tm_year = year - 1900;
+    t.tm_mon = month - 1;
+    t.tm_mday = day;
+    t.tm_hour = hour;
+    return timegm(&t);
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("serial_strategy", "[serial]")
+{
+    CATCH_START_SECTION("serial_strategy: names")
+    {
+        serial_strategy_t strategy(serial_strategy_t::SERIAL_STRATEGY_COUNTER);
+        CATCH_REQUIRE(string_to_serial_strategy("date", strategy));
+        CATCH_REQUIRE(strategy == serial_strategy_t::SERIAL_STRATEGY_DATE);
+        CATCH_REQUIRE(string_to_serial_strategy("unixtime", strategy));
+        CATCH_REQUIRE(strategy == serial_strategy_t::SERIAL_STRATEGY_UNIXTIME);
+        CATCH_REQUIRE(string_to_serial_strategy("counter", strategy));
+        CATCH_REQUIRE(strategy == serial_strategy_t::SERIAL_STRATEGY_COUNTER);
+        CATCH_REQUIRE_FALSE(string_to_serial_strategy("epoch", strategy));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("serial_strategy: counter")
+    {
+        time_t const now(utc(2025, 3, 14));
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_COUNTER, 0, now) == 1);
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_COUNTER, 1, now) == 2);
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_COUNTER, 0xFFFFFFFF, now) == 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("serial_strategy: date")
+    {
+        time_t const now(utc(2025, 3, 14));
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_DATE, 0, now) == 2025031400);
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_DATE, 57, now) == 2025031400);
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_DATE, 2025031400, now) == 2025031401);
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_DATE, 2025031399, now) == 2025031400);
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_DATE, 2025031320, now) == 2025031400);
+
+        // a clock going backward does not make the serial go backward
+        //
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_DATE, 2025031500, now) == 2025031501);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("serial_strategy: unixtime")
+    {
+        time_t const now(utc(2025, 3, 14));
+        std::uint32_t const seconds(static_cast<std::uint32_t>(now));
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_UNIXTIME, 0, now) == seconds);
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_UNIXTIME, 1000, now) == seconds);
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_UNIXTIME, seconds, now) == seconds + 1);
+
+        // date serials are larger than the current Unix time
+        //
+        CATCH_REQUIRE(next_serial(serial_strategy_t::SERIAL_STRATEGY_UNIXTIME, 2025031400, now) == 2025031401);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
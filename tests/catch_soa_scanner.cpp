@@ -0,0 +1,130 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// ipmgr
+//
+#include    <ipmgr/soa_scanner.h>
+
+
+// snapdev
+//
+#include    <snapdev/mkdir_p.h>
+
+
+// C++
+//
+#include    <fstream>
+
+
+// C
+//
+#include    <unistd.h>
+
+
+
+CATCH_TEST_CASE("soa_scanner", "[soa]")
+{
+    CATCH_START_SECTION("soa_scanner: bind9 dynamic zone")
+    {
+        std::string const zone(
+                "$ORIGIN .\n"
+                "$TTL 300\t; 5 minutes\n"
+                "example.com\t\tIN SOA\tns1.example.com. hostmaster.example.com. (\n"
+                "\t\t\t\t2025120345 ; serial\n"
+                "\t\t\t\t10800      ; refresh (3 hours)\n"
+                "\t\t\t\t)\n"
+                "\t\t\tNS\tns1.example.com.\n"
+                "$ORIGIN example.com.\n"
+                "soa\t\t\tA\t10.0.0.1\n");
+
+        soa_scanner scanner;
+        CATCH_REQUIRE(scanner.scan(zone.c_str(), zone.length()));
+        CATCH_REQUIRE(scanner.serial() == 2025120345);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("soa_scanner: owner, comments, and strings are not the SOA")
+    {
+        std::string const zone(
+                "soa IN TXT \"not the SOA\" ; SOA a b 5\n"
+                "@ IN soa ns1 host 4294967295 1 2 3 4\n");
+
+        soa_scanner scanner;
+        CATCH_REQUIRE(scanner.scan(zone.c_str(), zone.length()));
+        CATCH_REQUIRE(scanner.serial() == 4294967295);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("soa_scanner: invalid serials")
+    {
+        std::string const overflow("@ IN SOA ns1 host 4294967296 1 2 3 4\n");
+        std::string const letters("@ IN SOA ns1 host 12a4 1 2 3 4\n");
+        std::string const missing("@ IN SOA ns1 host");
+        std::string const none("@ IN A 10.0.0.1\n");
+
+        soa_scanner scanner;
+        CATCH_REQUIRE_FALSE(scanner.scan(overflow.c_str(), overflow.length()));
+        CATCH_REQUIRE_FALSE(scanner.scan(letters.c_str(), letters.length()));
+        CATCH_REQUIRE_FALSE(scanner.scan(missing.c_str(), missing.length()));
+        CATCH_REQUIRE_FALSE(scanner.scan(none.c_str(), none.length()));
+        CATCH_REQUIRE(scanner.serial() == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("soa_scanner: load a file")
+    {
+        std::string const root(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/soa_scanner/load");
+        CATCH_REQUIRE(snapdev::mkdir_p(root) == 0);
+        std::string const filename(root + "/example.com.zone");
+        {
+            std::ofstream out(filename);
+            out << "@ 3600 IN SOA ns1 host (\n 70000 1 2 3 4 )\n";
+        }
+
+        soa_scanner scanner;
+        CATCH_REQUIRE(scanner.load(filename));
+        CATCH_REQUIRE(scanner.serial() == 70000);
+        unlink(filename.c_str());
+
+        CATCH_REQUIRE_FALSE(scanner.load(filename));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("soa_scanner: rndc zonestatus output")
+    {
+        soa_scanner scanner;
+        CATCH_REQUIRE(scanner.parse_zonestatus(
+                  "name: example.com\n"
+                  "type: primary\n"
+                  "files: /var/lib/bind/example.com.zone\n"
+                  "serial: 2025010203\n"
+                  "nodes: 12\n"));
+        CATCH_REQUIRE(scanner.serial() == 2025010203);
+        CATCH_REQUIRE_FALSE(scanner.parse_zonestatus("name: example.com\n"));
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
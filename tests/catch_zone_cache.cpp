@@ -0,0 +1,92 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// ipmgr
+//
+#include    <ipmgr/zone_cache.h>
+
+
+// snapdev
+//
+#include    <snapdev/mkdir_p.h>
+
+
+
+CATCH_TEST_CASE("zone_cache", "[cache]")
+{
+    CATCH_START_SECTION("zone_cache: save and load the output index")
+    {
+        std::string const root(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/zone_cache/output-index");
+        CATCH_REQUIRE(snapdev::mkdir_p(root) == 0);
+        std::string const filename(root + "/fingerprints.cache");
+
+        {
+            zone_cache cache(filename);
+            CATCH_REQUIRE_FALSE(cache.load());
+
+            zone_cache::zone_entry zone;
+            zone.f_fingerprint = 0x1234;
+            zone.f_group = "company";
+            cache.set_zone("example.com", zone);
+
+            zone_cache::output_entry output;
+            output.f_size = 1024;
+            output.f_hash = 0xfedcba9876543210ULL;
+            output.f_serial = 17;
+            cache.set_output("/var/lib/ipmgr/generated/company/example.com.zone", output);
+
+            // entries set in this run are not visible until the next run
+            //
+            CATCH_REQUIRE(cache.find_output("/var/lib/ipmgr/generated/company/example.com.zone") == nullptr);
+
+            CATCH_REQUIRE(cache.save());
+        }
+
+        zone_cache cache(filename);
+        CATCH_REQUIRE(cache.load());
+
+        zone_cache::zone_entry const * zone(cache.find_zone("example.com"));
+        CATCH_REQUIRE(zone != nullptr);
+        CATCH_REQUIRE(zone->f_fingerprint == 0x1234);
+        CATCH_REQUIRE(zone->f_group == "company");
+
+        zone_cache::output_entry const * output(cache.find_output("/var/lib/ipmgr/generated/company/example.com.zone"));
+        CATCH_REQUIRE(output != nullptr);
+        CATCH_REQUIRE(output->f_size == 1024);
+        CATCH_REQUIRE(output->f_hash == 0xfedcba9876543210ULL);
+        CATCH_REQUIRE(output->f_serial == 17);
+        CATCH_REQUIRE(cache.find_output("/var/lib/ipmgr/generated/company/other.com.zone") == nullptr);
+
+        // in daemon mode, the entries of this run become the cached entries
+        //
+        cache.set_output("/var/lib/ipmgr/generated/10.0.0.ptr", *output);
+        cache.rotate();
+        CATCH_REQUIRE(cache.find_output("/var/lib/ipmgr/generated/10.0.0.ptr") != nullptr);
+        CATCH_REQUIRE(cache.find_output("/var/lib/ipmgr/generated/company/example.com.zone") == nullptr);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,127 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// ipmgr
+//
+#include    <ipmgr/zone_diff.h>
+
+
+
+namespace
+{
+
+
+
+char const * const g_zone_v1 =
+    "; WARNING -- auto-generated file; see `man ipmgr` for details.\n"
+    "$ORIGIN .\n"
+    "$TTL 300\n"
+    "example.com IN SOA ns1.example.com. hostmaster.example.com. (101 3h 15m 7d 1h)\n"
+    "\tNS ns1.example.com.\n"
+    "\tNS ns2.example.com.\n"
+    "\tA\t10.0.0.1\n"
+    "\t3600 TXT\t\"v=spf1 a:mail.example.com -all\"\n"
+    "$ORIGIN example.com.\n"
+    "mail._domainkey\t3600 TXT\t( \"v=DKIM1; k=rsa; \"\n"
+    "\t  \"p=ABCDEF\" )  ; ----- DKIM key mail for example.com\n"
+    "ns1\tA\t10.0.0.2\n"
+    "www\tA\t10.0.0.1\n"
+    "; vim: ts=25\n";
+
+char const * const g_zone_v2 =
+    "; WARNING -- auto-generated file; see `man ipmgr` for details.\n"
+    "$ORIGIN .\n"
+    "$TTL 300\n"
+    "example.com IN SOA ns1.example.com. hostmaster.example.com. (102 3h 15m 7d 1h)\n"
+    "\tNS ns1.example.com.\n"
+    "\tA\t10.0.0.1\n"
+    "\t3600 TXT\t\"v=spf1 a:mail.example.com -all\"\n"
+    "$ORIGIN example.com.\n"
+    "mail._domainkey\t3600 TXT\t( \"v=DKIM1; k=rsa; \"\n"
+    "\t  \"p=ABCDEF\" )  ; ----- DKIM key mail for example.com\n"
+    "ns1\tA\t10.0.0.2\n"
+    "www\t60 A\t10.0.0.1\n"
+    "api\tA\t10.0.0.3\n"
+    "; vim: ts=25\n";
+
+
+
+} // no name namespace
+
+
+CATCH_TEST_CASE("zone_diff", "[zone]")
+{
+    CATCH_START_SECTION("zone_diff: parse a generated zone")
+    {
+        zone_diff::rrset_map_t rrsets;
+        CATCH_REQUIRE(zone_diff::parse_zone(g_zone_v1, rrsets));
+        CATCH_REQUIRE(rrsets.size() == 6);
+
+        auto const ns(rrsets.find(zone_diff::rrset_name_t("example.com.", "NS")));
+        CATCH_REQUIRE(ns != rrsets.end());
+        CATCH_REQUIRE(ns->second.size() == 2);
+        CATCH_REQUIRE(ns->second.begin()->first == 300);
+        CATCH_REQUIRE(ns->second.begin()->second == "ns1.example.com.");
+
+        auto const dkim(rrsets.find(zone_diff::rrset_name_t("mail._domainkey.example.com.", "TXT")));
+        CATCH_REQUIRE(dkim != rrsets.end());
+        CATCH_REQUIRE(dkim->second.size() == 1);
+        CATCH_REQUIRE(dkim->second.begin()->first == 3600);
+        CATCH_REQUIRE(dkim->second.begin()->second == "\"v=DKIM1; k=rsa; \" \"p=ABCDEF\"");
+
+        CATCH_REQUIRE(rrsets.find(zone_diff::rrset_name_t("example.com.", "SOA")) == rrsets.end());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("zone_diff: same zone with a different serial")
+    {
+        std::string v1_new_serial(g_zone_v1);
+        v1_new_serial.replace(v1_new_serial.find("(101"), 4, "(999");
+
+        zone_diff diff;
+        CATCH_REQUIRE(diff.load(g_zone_v1, v1_new_serial));
+        CATCH_REQUIRE(diff.empty());
+        CATCH_REQUIRE(diff.size() == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("zone_diff: generate an nsupdate script")
+    {
+        zone_diff diff;
+        CATCH_REQUIRE(diff.load(g_zone_v1, g_zone_v2));
+        CATCH_REQUIRE_FALSE(diff.empty());
+        CATCH_REQUIRE(diff.size() == 3);
+        CATCH_REQUIRE(diff.nsupdate_script("example.com") ==
+                  "zone example.com.\n"
+                  "update delete example.com. NS ns2.example.com.\n"
+                  "update delete www.example.com. A 10.0.0.1\n"
+                  "update add api.example.com. 300 A 10.0.0.3\n"
+                  "update add www.example.com. 60 A 10.0.0.1\n"
+                  "send\n");
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
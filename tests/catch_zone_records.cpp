@@ -0,0 +1,168 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// ipmgr
+//
+#include    <ipmgr/zone_records.h>
+
+
+
+CATCH_TEST_CASE("zone_records", "[zone]")
+{
+    CATCH_START_SECTION("zone_records: render records")
+    {
+        zone_records records;
+        records.add(std::string(), 0, record_type_t::RECORD_TYPE_NS, "ns1.example.com.");
+        records.add(std::string(), 300, record_type_t::RECORD_TYPE_MX, " 10\tmail.example.com.");
+        records.add_origin("example.com.");
+        records.add("mail._domainkey", 3600, record_type_t::RECORD_TYPE_RAW, "TXT\t( \"v=DKIM1; k=rsa; \"\n\t  \"p=ABC\" )");
+        records.add("www", 0, record_type_t::RECORD_TYPE_CNAME, "example.com.");
+        CATCH_REQUIRE(records.size() == 5);
+
+        std::string zone("; header\n");
+        records.render(zone);
+        CATCH_REQUIRE(zone ==
+                  "; header\n"
+                  "\tNS ns1.example.com.\n"
+                  "\t300 MX 10\tmail.example.com.\n"
+                  "$ORIGIN example.com.\n"
+                  "mail._domainkey\t3600 TXT\t( \"v=DKIM1; k=rsa; \"\n\t  \"p=ABC\" )\n"
+                  "www\tCNAME\texample.com.\n");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("zone_records: render each type with and without TTL")
+    {
+        zone_records records;
+        records.add(std::string(), 0, record_type_t::RECORD_TYPE_NS, "ns1.example.com.");
+        records.add(std::string(), 3600, record_type_t::RECORD_TYPE_NS, "ns2.example.com.");
+        records.add(std::string(), 0, record_type_t::RECORD_TYPE_MX, " 10\tmail.example.com.");
+        records.add(std::string(), 300, record_type_t::RECORD_TYPE_MX, " 20\tmx2.example.com.");
+        records.add(std::string(), 0, record_type_t::RECORD_TYPE_MX, "\tmx3.example.com.");
+        records.add(std::string(), 60, record_type_t::RECORD_TYPE_MX, "\tmx4.example.com.");
+        records.add(std::string(), 0, record_type_t::RECORD_TYPE_A, "10.0.0.1");
+        records.add(std::string(), 120, record_type_t::RECORD_TYPE_A, "10.0.0.2");
+        records.add(std::string(), 0, record_type_t::RECORD_TYPE_AAAA, "2001:db8::1");
+        records.add(std::string(), 120, record_type_t::RECORD_TYPE_AAAA, "2001:db8::2");
+        records.add(std::string(), 0, record_type_t::RECORD_TYPE_TXT, "\"v=spf1 -all\"");
+        records.add(std::string(), 86400, record_type_t::RECORD_TYPE_TXT, "\"hello\"");
+        records.add("www", 0, record_type_t::RECORD_TYPE_CNAME, "example.com.");
+        records.add("api", 900, record_type_t::RECORD_TYPE_CNAME, "example.com.");
+        records.add("raw", 0, record_type_t::RECORD_TYPE_RAW, "TXT\t\"raw\"");
+        records.add("raw", 30, record_type_t::RECORD_TYPE_RAW, "TXT\t\"timed\"");
+
+        std::string zone;
+        records.render(zone);
+        CATCH_REQUIRE_LONG_STRING(zone,
+                  "\tNS ns1.example.com.\n"
+                  "\t3600 NS ns2.example.com.\n"
+                  "\tMX 10\tmail.example.com.\n"
+                  "\t300 MX 20\tmx2.example.com.\n"
+                  "\tMX\tmx3.example.com.\n"
+                  "\t60 MX\tmx4.example.com.\n"
+                  "\tA\t10.0.0.1\n"
+                  "\t120 A\t10.0.0.2\n"
+                  "\tAAAA\t2001:db8::1\n"
+                  "\t120 AAAA\t2001:db8::2\n"
+                  "\tTXT\t\"v=spf1 -all\"\n"
+                  "\t86400 TXT\t\"hello\"\n"
+                  "www\tCNAME\texample.com.\n"
+                  "api\t900 CNAME\texample.com.\n"
+                  "raw\tTXT\t\"raw\"\n"
+                  "raw\t30 TXT\t\"timed\"\n");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("zone_records: relative and absolute names")
+    {
+        zone_records records;
+        records.add_origin("example.com.");
+        records.add("www", 0, record_type_t::RECORD_TYPE_CNAME, "example.com.");
+        records.add("blog", 0, record_type_t::RECORD_TYPE_CNAME, "www");
+        records.add("mail", 0, record_type_t::RECORD_TYPE_A, "10.0.0.3");
+        records.add_origin(".");
+        records.add("ftp.example.com.", 0, record_type_t::RECORD_TYPE_CNAME, "files.example.net.");
+        records.add("example.com.", 0, record_type_t::RECORD_TYPE_NS, "ns1");
+        records.add("example.com.", 0, record_type_t::RECORD_TYPE_MX, " 5\tmail.example.com.");
+        records.add(std::string(), 0, record_type_t::RECORD_TYPE_MX, " 10\tmail");
+
+        std::string zone;
+        records.render(zone);
+        CATCH_REQUIRE_LONG_STRING(zone,
+                  "$ORIGIN example.com.\n"
+                  "www\tCNAME\texample.com.\n"
+                  "blog\tCNAME\twww\n"
+                  "mail\tA\t10.0.0.3\n"
+                  "$ORIGIN .\n"
+                  "ftp.example.com.\tCNAME\tfiles.example.net.\n"
+                  "example.com.\tNS ns1\n"
+                  "example.com.\tMX 5\tmail.example.com.\n"
+                  "\tMX 10\tmail\n");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("zone_records: record type names")
+    {
+        CATCH_REQUIRE(std::string(record_type_to_string(record_type_t::RECORD_TYPE_A)) == "A");
+        CATCH_REQUIRE(std::string(record_type_to_string(record_type_t::RECORD_TYPE_AAAA)) == "AAAA");
+        CATCH_REQUIRE(std::string(record_type_to_string(record_type_t::RECORD_TYPE_CNAME)) == "CNAME");
+        CATCH_REQUIRE(std::string(record_type_to_string(record_type_t::RECORD_TYPE_MX)) == "MX");
+        CATCH_REQUIRE(std::string(record_type_to_string(record_type_t::RECORD_TYPE_NS)) == "NS");
+        CATCH_REQUIRE(std::string(record_type_to_string(record_type_t::RECORD_TYPE_TXT)) == "TXT");
+        CATCH_REQUIRE(std::string(record_type_to_string(record_type_t::RECORD_TYPE_ORIGIN)) == "$ORIGIN");
+        CATCH_REQUIRE(std::string(record_type_to_string(record_type_t::RECORD_TYPE_RAW)).empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("zone_records: sort like the rendered lines")
+    {
+        zone_records records;
+        records.add("www", 0, record_type_t::RECORD_TYPE_AAAA, "::1");
+        records.add("www", 0, record_type_t::RECORD_TYPE_A, "10.0.0.2");
+        records.add("www", 600, record_type_t::RECORD_TYPE_A, "10.0.0.1");
+        records.add("www", 60, record_type_t::RECORD_TYPE_A, "10.0.0.1");
+        records.add("www-2", 0, record_type_t::RECORD_TYPE_A, "10.0.0.1");
+        records.add("api", 0, record_type_t::RECORD_TYPE_TXT, "\"hello\"");
+        records.add("www", 0, record_type_t::RECORD_TYPE_A, "10.0.0.2");
+        records.sort();
+        CATCH_REQUIRE(records.size() == 6);
+
+        std::string zone;
+        records.render(zone);
+
+        // the result must match sorting the lines themselves
+        //
+        CATCH_REQUIRE(zone ==
+                  "api\tTXT\t\"hello\"\n"
+                  "www\t60 A\t10.0.0.1\n"
+                  "www\t600 A\t10.0.0.1\n"
+                  "www\tA\t10.0.0.2\n"
+                  "www\tAAAA\t::1\n"
+                  "www-2\tA\t10.0.0.1\n");
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,216 @@
+// Copyright (c) 2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/ipmgr
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// ipmgr
+//
+#include    <ipmgr/zone_watcher.h>
+
+
+// snapdev
+//
+#include    <snapdev/mkdir_p.h>
+
+
+// C++
+//
+#include    <chrono>
+#include    <fstream>
+#include    <thread>
+
+
+// C
+//
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+
+namespace
+{
+
+
+void write_file(std::string const & filename)
+{
+    std::ofstream out(filename);
+    out << "zone \"example.com\" {};\n";
+}
+
+
+std::int64_t elapsed_ms(std::chrono::steady_clock::time_point const & start)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - start).count();
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("zone_watcher", "[watcher]")
+{
+    CATCH_START_SECTION("zone_watcher: a burst of changes is reported once")
+    {
+        std::string const root(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/zone_watcher/debounce");
+        CATCH_REQUIRE(snapdev::mkdir_p(root) == 0);
+
+        zone_watcher watcher;
+        CATCH_REQUIRE(watcher.init());
+        CATCH_REQUIRE(watcher.watch_zone_directory(root));
+
+        // a second change arrives while the first is being debounced
+        //
+        write_file(root + "/a.conf");
+        std::thread late([root]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                write_file(root + "/b.conf");
+            });
+
+        auto const start(std::chrono::steady_clock::now());
+        CATCH_REQUIRE(watcher.wait(300) == zone_watcher::change_t::CHANGE_ZONES);
+        late.join();
+
+        // the late change restarted the debounce timer
+        //
+        CATCH_REQUIRE(elapsed_ms(start) >= 400);
+
+        // both changes were consumed by the first wait(); a file which is
+        // not a .conf is ignored so only the last write wakes us up
+        //
+        std::thread writer([root]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                write_file(root + "/notes.txt");
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                write_file(root + "/c.conf");
+            });
+
+        auto const restart(std::chrono::steady_clock::now());
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_ZONES);
+        writer.join();
+        CATCH_REQUIRE(elapsed_ms(restart) >= 200);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("zone_watcher: new sub-directories get watched")
+    {
+        std::string const root(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/zone_watcher/sub-directory");
+        CATCH_REQUIRE(snapdev::mkdir_p(root) == 0);
+
+        zone_watcher watcher;
+        CATCH_REQUIRE(watcher.init());
+        CATCH_REQUIRE(watcher.watch_zone_directory(root));
+
+        std::string const group(root + "/group");
+        CATCH_REQUIRE(mkdir(group.c_str(), 0755) == 0);
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_ZONES);
+
+        // a zone created in the new sub-directory must be seen
+        //
+        write_file(group + "/example.com.conf");
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_ZONES);
+
+        // and so are deeper levels created after the fact
+        //
+        std::string const deeper(group + "/deeper");
+        CATCH_REQUIRE(mkdir(deeper.c_str(), 0755) == 0);
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_ZONES);
+
+        write_file(deeper + "/example.net.conf");
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_ZONES);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("zone_watcher: configuration changes win over zone changes")
+    {
+        std::string const root(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/zone_watcher/configuration");
+        std::string const zones(root + "/zones");
+        std::string const config(root + "/config");
+        CATCH_REQUIRE(snapdev::mkdir_p(zones) == 0);
+        CATCH_REQUIRE(snapdev::mkdir_p(config + "/ipmgr.d") == 0);
+
+        zone_watcher watcher;
+        CATCH_REQUIRE(watcher.init());
+        CATCH_REQUIRE(watcher.watch_zone_directory(zones));
+        CATCH_REQUIRE(watcher.watch_configuration_directory(config));
+
+        write_file(zones + "/example.com.conf");
+        write_file(config + "/ipmgr.d/50-ipmgr.conf");
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_CONFIGURATION);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("zone_watcher: directories created later get watched")
+    {
+        std::string const root(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/zone_watcher/created-later");
+        std::string const zones(root + "/zones/packages");
+        std::string const config(root + "/config");
+        CATCH_REQUIRE(snapdev::mkdir_p(config) == 0);
+
+        zone_watcher watcher;
+        CATCH_REQUIRE(watcher.init());
+        CATCH_REQUIRE(watcher.watch_zone_directory(zones));
+        CATCH_REQUIRE(watcher.watch_configuration_directory(config));
+
+        // the zone directory and its parent get created
+        //
+        CATCH_REQUIRE(snapdev::mkdir_p(zones) == 0);
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_ZONES);
+
+        write_file(zones + "/example.com.conf");
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_ZONES);
+
+        // an empty ipmgr.d is not a change, its first .conf file is
+        //
+        std::string const sub_directory(config + "/ipmgr.d");
+        CATCH_REQUIRE(mkdir(sub_directory.c_str(), 0755) == 0);
+        std::thread writer([sub_directory]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                write_file(sub_directory + "/50-ipmgr.conf");
+            });
+        auto const start(std::chrono::steady_clock::now());
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_CONFIGURATION);
+        writer.join();
+        CATCH_REQUIRE(elapsed_ms(start) >= 100);
+
+        // a directory deleted and created again is watched again
+        //
+        CATCH_REQUIRE(unlink((zones + "/example.com.conf").c_str()) == 0);
+        CATCH_REQUIRE(rmdir(zones.c_str()) == 0);
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_ZONES);
+
+        CATCH_REQUIRE(mkdir(zones.c_str(), 0755) == 0);
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_ZONES);
+
+        write_file(zones + "/example.net.conf");
+        CATCH_REQUIRE(watcher.wait(50) == zone_watcher::change_t::CHANGE_ZONES);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et